@@ -2,10 +2,13 @@
 #ifndef APP_H
 #define APP_H
 
+#include <cstdint>
 #include <memory>
 #include "Scene.h"
 #include "Window.h"
 #include "Renderer.h"
+#include "RenderThread.h"
+#include "FramePacer.h"
 
 namespace Klein {
     // Global app configuration
@@ -13,6 +16,19 @@ namespace Klein {
     inline int appWindowX = 1280;
     inline int appWindowY = 640;
     inline const char* appDefaultName = "Klein Application";
+    // Submit GL from a dedicated thread; OnUI then runs on that thread too
+    inline bool appRenderThread = false;
+    // Linked program binaries are cached here between runs; nullptr disables it
+    inline const char* appShaderCacheDirectory = "shader_cache";
+    // Frame rate cap for the main loop, on top of vsync; 0 = uncapped. Negative picks
+    // appHeadlessFrameRate without a display (no vsync there, so uncapped would spin)
+    // and uncapped with one
+    inline double appTargetFrameRate = -1.0;
+    inline double appHeadlessFrameRate = 60.0;
+    // Servers and CI: no display needed (see HeadlessMode); Simulation has no renderer
+    inline HeadlessMode appHeadless = HeadlessMode::Off;
+    // Run() returns after this many frames; 0 = until the window closes
+    inline uint64_t appFrameCount = 0;
 
     class App {
     public:
@@ -27,7 +43,7 @@ namespace Klein {
         virtual void OnStart() {}
         virtual void OnUpdate(float deltaTime) {}
         virtual void OnUI() {}
-        virtual void OnShutdown() {}
+        virtual void OnShutdown() {}    // Once, when Run() returns; the context is still current
 
         // Scene management
         std::shared_ptr<Scene> GetActiveScene() { return m_activeScene; }
@@ -35,7 +51,8 @@ namespace Klein {
 
         // Access to subsystems
         Window* GetWindow() { return m_window.get(); }
-        Renderer* GetRenderer() { return m_renderer.get(); }
+        Renderer* GetRenderer() { return m_renderer.get(); }  // Null in HeadlessMode::Simulation
+        FramePacer& GetFramePacer() { return m_framePacer; }
 
         static float GetDeltaTime() { return s_deltaTime; }
 
@@ -45,11 +62,13 @@ namespace Klein {
 
         std::unique_ptr<Window> m_window;
         std::unique_ptr<Renderer> m_renderer;
+        std::unique_ptr<RenderThread> m_renderThread;
         std::shared_ptr<Scene> m_activeScene;
+        FramePacer m_framePacer;
 
         bool m_running = true;
+        uint64_t m_frameIndex = 0;
         static inline float s_deltaTime = 0.0f;
-        static inline float s_lastFrame = 0.0f;
         static App* m_AppInstance;
     };
     // Implemented by User
@@ -0,0 +1,101 @@
+#ifndef CLUSTEREDLIGHTING_H
+#define CLUSTEREDLIGHTING_H
+
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "UniformBuffer.h"
+
+namespace Klein {
+
+    // Clustered forward lighting. The view frustum is split into a 3D grid (screen
+    // tiles x exponential depth slices); every frame point lights are assigned to the
+    // clusters their bounding sphere touches, in parallel on the job system. Lights,
+    // per-cluster (offset, count) pairs and the flattened index list are uploaded as
+    // texture buffers, which are available on GL 4.1, so fragments only loop over the
+    // lights that can reach them.
+    class ClusteredLighting {
+    public:
+        static constexpr uint32_t kClustersX = 16;
+        static constexpr uint32_t kClustersY = 9;
+        static constexpr uint32_t kClustersZ = 24;
+        static constexpr uint32_t kClusterCount = kClustersX * kClustersY * kClustersZ;
+
+        struct DirectionalLight {
+            glm::vec3 direction;
+            glm::vec3 color;
+            float intensity;
+        };
+
+        struct PointLight {
+            glm::vec3 position;
+            float range;
+            glm::vec3 color;
+            float intensity;
+        };
+
+        ClusteredLighting();
+        ~ClusteredLighting();
+
+        ClusteredLighting(const ClusteredLighting&) = delete;
+        ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+        // Assigns lights to clusters for this view and uploads the light buffers
+        void Update(const std::vector<DirectionalLight>& dirLights,
+                    const std::vector<PointLight>& pointLights,
+                    const glm::mat4& view, const glm::mat4& projection,
+                    float nearClip, float farClip,
+                    int viewportWidth, int viewportHeight);
+
+        // Binds the light, grid and index buffers to their TextureSlot units
+        void Bind() const;
+
+        // Cluster dimensions and light counts for the Lights uniform block
+        void FillBlock(LightsBlock& block) const;
+
+        uint32_t GetLightIndexCount() const { return (uint32_t)m_indices.size(); }
+
+    private:
+        struct TexelBuffer {
+            GLuint buffer = 0;
+            GLuint texture = 0;
+            GLsizeiptr capacity = 0;
+
+            void Create(GLenum format);
+            void Destroy();
+            void Upload(const void* data, GLsizeiptr size);
+        };
+
+        // Screen tile / depth slice range touched by a light, inclusive
+        struct LightBounds {
+            uint32_t minX, maxX, minY, maxY, minZ, maxZ;
+            bool visible;
+        };
+
+        uint32_t DepthSlice(float viewDepth) const;
+
+        // Smallest near plane for exponential slicing; log() of anything closer diverges
+        static constexpr float kMinSliceDepth = 1e-3f;
+
+        TexelBuffer m_lightData;    // RGBA32F, 2 texels per light (directional first)
+        TexelBuffer m_clusterGrid;  // RG32UI, (offset, count) per cluster
+        TexelBuffer m_lightIndices; // R32UI
+
+        std::vector<glm::vec4> m_lightTexels;
+        std::vector<LightBounds> m_bounds;
+        std::vector<glm::uvec2> m_grid;
+        std::vector<uint32_t> m_indices;
+        std::vector<std::vector<uint32_t>> m_sliceIndices;
+
+        uint32_t m_dirLightCount = 0;
+        uint32_t m_pointLightCount = 0;
+        glm::vec2 m_tileSize{1.0f};
+        float m_sliceScale = 0.0f;
+        float m_sliceBias = 0.0f;
+        bool m_linearSlices = false;  // Orthographic view
+    };
+
+} // namespace Klein
+
+#endif // CLUSTEREDLIGHTING_H
@@ -63,6 +63,13 @@ namespace Klein {
         std::shared_ptr<Material> material;
         bool castShadows = true;
         bool receiveShadows = true;
+        bool isStatic = false;  // Never moves; lets cached shadow cascades be reused.
+                                // Call Scene::RefreshRenderable after changing it later
+
+        // Level of detail
+        int lod = 0;            // Active LOD, picked by the renderer each frame when autoLOD is set
+        bool autoLOD = true;
+        float lodBias = 1.0f;   // > 1 keeps higher detail for longer
 
         MeshRendererComponent() = default;
         MeshRendererComponent(std::shared_ptr<Mesh> m, std::shared_ptr<Material> mat)
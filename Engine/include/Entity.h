@@ -9,6 +9,11 @@
 namespace Klein {
 
     class Scene;
+    class Entity;
+
+    // Keep the owning scene's component index up to date (Scene.cpp)
+    void NotifyComponentAdded(const Entity& entity, std::type_index type, bool replaced);
+    void NotifyComponentRemoved(const Entity& entity, std::type_index type);
 
     // Component storage per entity
     struct EntityData {
@@ -42,7 +47,8 @@ namespace Klein {
         }
     };
 
-    // Entity is a lightweight wrapper around EntityData
+    // Entity is a lightweight wrapper around EntityData. Add and remove components
+    // through it rather than through EntityData, so the scene sees the change
     class Entity {
     public:
         Entity() = default;
@@ -51,7 +57,10 @@ namespace Klein {
 
         template<typename T, typename... Args>
         T& AddComponent(Args&&... args) {
-            return m_data->AddComponent<T>(std::forward<Args>(args)...);
+            bool replaced = m_data->HasComponent<T>();
+            T& component = m_data->AddComponent<T>(std::forward<Args>(args)...);
+            if (m_scene) NotifyComponentAdded(*this, typeid(T), replaced);
+            return component;
         }
 
         template<typename T>
@@ -71,7 +80,9 @@ namespace Klein {
 
         template<typename T>
         void RemoveComponent() {
+            if (!m_data->HasComponent<T>()) return;
             m_data->RemoveComponent<T>();
+            if (m_scene) NotifyComponentRemoved(*this, typeid(T));
         }
 
         uint32_t GetID() const { return m_data->id; }
@@ -93,6 +104,8 @@ namespace Klein {
         Scene* m_scene = nullptr;
 
         friend class Scene;
+        friend void NotifyComponentAdded(const Entity&, std::type_index, bool);
+        friend void NotifyComponentRemoved(const Entity&, std::type_index);
     };
 
 } // namespace Klein
@@ -5,9 +5,29 @@
 #pragma once
 #include "App.h"
 #include "Logger.h"
+#include "Profiler.h"
+#include <cstdlib>
+#include <cstring>
 
 
 int main(int argc, char** argv){
+    // --headless (simulation only), --offscreen (render without a display), --frames N,
+    // --fps N (frame rate cap, 0 = uncapped), --profile N (Chrome trace of the first
+    // N frames, written to klein_trace.json)
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            Klein::appHeadless = Klein::HeadlessMode::Simulation;
+        } else if (std::strcmp(argv[i], "--offscreen") == 0) {
+            Klein::appHeadless = Klein::HeadlessMode::Offscreen;
+        } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            Klein::appFrameCount = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            Klein::appTargetFrameRate = std::strtod(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            Klein::Profiler::Get().RequestCapture((uint32_t)std::strtoul(argv[++i], nullptr, 10), "klein_trace.json");
+        }
+    }
+
     auto app = Klein::CreateApp();
     if (Klein::appWindowName){
         KleinLogger::Logger::EngineLog("Successfully Initialised Application | [%s]", (Klein::appWindowName ));
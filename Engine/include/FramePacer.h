@@ -0,0 +1,98 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace Klein {
+
+    // Frame timing for the main loop: frame rate cap, smoothed delta time and
+    // frame-time statistics.
+    //
+    // The cap waits with a hybrid of sleeping and spinning: short sleeps are used
+    // while the time left is comfortably more than a sleep usually takes, and the
+    // last stretch is spun, so frames land within microseconds of the target
+    // without burning a core for the whole wait.
+    //
+    // With a refresh rate set (vsync on), a frame taking noticeably longer than one
+    // refresh interval is counted as a missed vsync; without one the cap's interval
+    // is the deadline instead.
+    class FramePacer {
+    public:
+        struct Stats {
+            static constexpr int kBucketCount = 100;       // Bucket i = [i, i + 1) * kBucketWidth ms
+            static constexpr double kBucketWidth = 0.5;    // Last bucket also holds everything slower
+
+            uint64_t frameCount = 0;
+            uint64_t missedFrames = 0;
+            double minMs = 0.0;
+            double maxMs = 0.0;
+            double totalMs = 0.0;
+            std::array<uint32_t, kBucketCount> buckets{};
+
+            double GetAverageMs() const { return frameCount ? totalMs / (double)frameCount : 0.0; }
+            // Upper edge of the bucket holding the given fraction (0.99 = p99) of frames
+            double GetPercentileMs(double fraction) const;
+        };
+
+        FramePacer();
+
+        // 0 = uncapped
+        void SetTargetFrameRate(double framesPerSecond);
+        double GetTargetFrameRate() const { return m_targetFrameRate; }
+
+        // Display refresh rate while vsync is on, 0 otherwise
+        void SetRefreshRate(double hertz) { m_refreshRate = hertz; }
+
+        // Frames averaged into the smoothed delta; 1 turns smoothing off
+        void SetSmoothingWindow(int frames);
+
+        // Call once at the top of every frame. Waits out the rest of the cap,
+        // then returns the smoothed time since the previous call in seconds
+        float Tick();
+
+        float GetRawDeltaTime() const { return m_rawDelta; }
+        float GetDeltaTime() const { return m_smoothedDelta; }
+
+        const Stats& GetStats() const { return m_stats; }
+        void ResetStats() { m_stats = Stats(); }
+        // Frame count, average, p50/p95/p99 and a coarse histogram through the logger
+        void LogReport() const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        void WaitUntil(Clock::time_point deadline);
+        void Record(double frameSeconds);
+
+        static constexpr int kMaxSmoothing = 16;
+        static constexpr uint64_t kMaxSleepSamples = 1000;
+        // A single long frame (a load, a breakpoint) isn't fed to the simulation whole
+        static constexpr double kMaxDelta = 0.25;
+
+        double m_targetFrameRate = 0.0;
+        double m_refreshRate = 0.0;
+
+        Clock::time_point m_lastFrame;
+        bool m_firstFrame = true;
+
+        // How long a 1 ms sleep really takes (Welford); sleeping stops once less than
+        // mean + 2 sigma is left
+        double m_sleepMean = 0.002;
+        double m_sleepM2 = 0.0;
+        uint64_t m_sleepCount = 1;
+
+        std::array<double, kMaxSmoothing> m_history{};
+        int m_smoothing = 4;
+        int m_historyNext = 0;
+        int m_historyCount = 0;
+
+        float m_rawDelta = 0.0f;
+        float m_smoothedDelta = 0.0f;
+        Stats m_stats;
+    };
+
+} // namespace Klein
+
+#endif // FRAMEPACER_H
@@ -0,0 +1,21 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+namespace Klein {
+
+    // View frustum as six inward-facing planes, extracted from a view-projection matrix
+    struct Frustum {
+        glm::vec4 planes[6]; // xyz = normal, w = distance
+
+        Frustum() = default;
+        explicit Frustum(const glm::mat4& viewProj);
+
+        bool IntersectsSphere(const glm::vec3& center, float radius) const;
+        bool IntersectsAABB(const glm::vec3& min, const glm::vec3& max) const;
+    };
+
+} // namespace Klein
+
+#endif // FRUSTUM_H
@@ -0,0 +1,168 @@
+#ifndef GPUSCENE_H
+#define GPUSCENE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "UniformBuffer.h"
+
+namespace Klein {
+
+    class Mesh;
+
+    // SSBO binding points used by the GPU-driven shaders (layout(binding = N) in GLSL 4.3)
+    namespace StorageBinding {
+        constexpr GLuint Objects = 0;
+        constexpr GLuint Meshes = 1;
+        constexpr GLuint DrawCommands = 2;
+        constexpr GLuint Materials = 3;            // MaterialTable
+    }
+
+    // GPU-driven renderer for large numbers of objects (GL 4.3+).
+    //
+    // Geometry of every mesh in use, including its LODs, is copied into one shared
+    // vertex/index buffer pair. A mesh is registered by its first object and released
+    // with its last; the ranges it held are reused by later meshes. Objects live persistently in an SSBO and are only
+    // re-uploaded when they change. Each frame a compute shader frustum-culls every
+    // object, picks its LOD and writes one DrawElementsIndirectCommand per object slot
+    // (zero instances when culled). The whole set is then drawn with a single
+    // glMultiDrawElementsIndirect, so CPU cost doesn't depend on the object count.
+    class GPUScene {
+    public:
+        enum ObjectFlags : uint32_t {
+            CastShadows = 1 << 0,
+            ReceiveShadows = 1 << 1,
+        };
+
+        // Mirrors of the std430 structs in the GPU-driven shaders
+        struct ObjectData {
+            glm::mat4 model;
+            glm::vec4 boundsSphere;    // World space center, radius
+            glm::vec4 albedoMetallic;
+            glm::vec4 roughnessAo;     // x = roughness, y = ao
+            glm::uvec4 info;           // x = mesh, y = flags, z = LOD bias (float bits), w = alive
+        };
+
+        struct MeshEntry {
+            glm::uvec4 lods[4];        // index count, first index, base vertex, unused
+            glm::vec4 lodScreenSizes;
+            glm::uvec4 info;           // x = LOD count
+        };
+
+        struct DrawElementsIndirectCommand {
+            GLuint count;
+            GLuint instanceCount;
+            GLuint firstIndex;
+            GLint baseVertex;
+            GLuint baseInstance;
+        };
+
+        static_assert(sizeof(ObjectData) == 128, "ObjectData must match std430 layout");
+        static_assert(sizeof(MeshEntry) == 96, "MeshEntry must match std430 layout");
+        static_assert(sizeof(DrawElementsIndirectCommand) == 20, "Indirect command layout is fixed by GL");
+
+        static constexpr uint32_t kInvalidObject = UINT32_MAX;
+        static constexpr GLuint kObjectIDAttribLocation = 9;
+
+        GPUScene();
+        ~GPUScene();
+
+        GPUScene(const GPUScene&) = delete;
+        GPUScene& operator=(const GPUScene&) = delete;
+
+        // Requires compute shaders, SSBOs and multi-draw indirect
+        static bool IsSupported();
+
+        // Material properties are copied; textured materials need the regular path
+        uint32_t AddObject(const std::shared_ptr<Mesh>& mesh, const MaterialBlock& material, const glm::mat4& model,
+                           uint32_t flags = CastShadows | ReceiveShadows, float lodBias = 1.0f);
+        void UpdateObject(uint32_t object, const glm::mat4& model);
+        void RemoveObject(uint32_t object);
+
+        uint32_t GetObjectCount() const { return m_liveObjects; }
+        // Changes whenever an object is added, moved or removed
+        uint64_t GetVersion() const { return m_version; }
+
+        // Sends modified objects to the GPU. Call once per frame before culling
+        void Upload();
+
+        // Writes the draw commands for this view. Only objects with all of requiredFlags are kept
+        void Cull(const glm::mat4& viewProj, const glm::vec3& lodOrigin, float lodProjScale,
+                  bool perspective, uint32_t requiredFlags = 0);
+
+        // Draws the last culled set with the currently bound GPU-driven program
+        void Draw() const;
+
+    private:
+        // Byte range in the shared vertex or index buffer
+        struct GeometryRange {
+            GLsizeiptr offset = 0;
+            GLsizeiptr size = 0;
+        };
+
+        struct MeshSlot {
+            std::shared_ptr<Mesh> mesh;            // Kept alive while registered, null when free
+            uint32_t objectCount = 0;
+            int lodCount = 0;
+            GeometryRange vertices[4];
+            GeometryRange indices[4];
+        };
+
+        uint32_t RegisterMesh(const std::shared_ptr<Mesh>& mesh);
+        void ReleaseMesh(uint32_t meshIndex);
+        // First fit among the freed ranges; -1 when none is large enough
+        static GLsizeiptr TakeFreeRange(std::vector<GeometryRange>& freeRanges, GLsizeiptr size);
+        // Merges with free neighbours; a range ending at 'used' shrinks it instead
+        static void FreeGeometry(std::vector<GeometryRange>& freeRanges, GLsizeiptr& used, GeometryRange range);
+        void ReserveObjects(uint32_t capacity);
+        void ReserveGeometry(GLsizeiptr vertexBytes, GLsizeiptr indexBytes);
+        void SetupVertexArray();
+        void MarkDirty(uint32_t object);
+
+        GLuint m_cullProgram = 0;
+        GLint m_planesLocation = -1;
+        GLint m_lodOriginLocation = -1;
+        GLint m_lodProjScaleLocation = -1;
+        GLint m_lodPerspectiveLocation = -1;
+        GLint m_objectCountLocation = -1;
+        GLint m_requiredFlagsLocation = -1;
+
+        // Shared geometry
+        GLuint m_vao = 0;
+        GLuint m_vertexBuffer = 0;
+        GLuint m_indexBuffer = 0;
+        GLsizeiptr m_vertexCapacity = 0;   // Bytes
+        GLsizeiptr m_indexCapacity = 0;
+        GLsizeiptr m_vertexBytes = 0;     // End of the last allocation
+        GLsizeiptr m_indexBytes = 0;
+        std::vector<GeometryRange> m_freeVertexRanges;     // Sorted by offset, never adjacent
+        std::vector<GeometryRange> m_freeIndexRanges;
+
+        // Per-object data
+        GLuint m_objectBuffer = 0;
+        GLuint m_objectIDBuffer = 0;       // 0..N-1, instanced so baseInstance selects the object
+        GLuint m_commandBuffer = 0;
+        GLuint m_meshBuffer = 0;
+        uint32_t m_objectCapacity = 0;
+        uint32_t m_meshCapacity = 0;
+
+        std::vector<ObjectData> m_objects;
+        std::vector<uint32_t> m_freeSlots;
+        uint32_t m_liveObjects = 0;
+        uint32_t m_dirtyBegin = UINT32_MAX;
+        uint32_t m_dirtyEnd = 0;
+        bool m_meshesDirty = false;
+        uint64_t m_version = 0;
+
+        std::vector<MeshEntry> m_meshEntries;
+        std::vector<MeshSlot> m_meshSlots;             // Parallel to m_meshEntries
+        std::vector<uint32_t> m_freeMeshSlots;
+        std::unordered_map<const Mesh*, uint32_t> m_meshIndices;
+    };
+
+} // namespace Klein
+
+#endif // GPUSCENE_H
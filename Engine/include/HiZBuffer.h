@@ -0,0 +1,71 @@
+#ifndef HIZBUFFER_H
+#define HIZBUFFER_H
+
+#include <memory>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+namespace Klein {
+
+    class Shader;
+
+    // Hierarchical depth buffer for occlusion culling.
+    //
+    // After the main pass the frame's depth is copied and max-reduced on the GPU into
+    // a mip pyramid. One small level is read back through a PBO without stalling and,
+    // once its fence has signalled, rebuilt into a CPU pyramid together with the
+    // view-projection it was rendered with. Object bounds are then tested against
+    // that (one or more frames old) depth before submission.
+    class HiZBuffer {
+    public:
+        HiZBuffer();
+        ~HiZBuffer();
+
+        HiZBuffer(const HiZBuffer&) = delete;
+        HiZBuffer& operator=(const HiZBuffer&) = delete;
+
+        // Picks up a finished readback, if any. Call once per frame before testing
+        void FetchReadback();
+
+        // Builds the pyramid from the bound framebuffer's depth and starts a readback.
+        // Skipped while the previous readback is still in flight
+        void Build(const glm::mat4& viewProj, int width, int height);
+
+        // True when the sphere is certainly hidden behind the last read back depth
+        bool IsOccluded(const glm::vec3& center, float radius) const;
+
+        bool HasData() const { return m_hasData; }
+
+    private:
+        void Resize(int width, int height);
+        void Release();
+
+        static constexpr int kReadbackMaxWidth = 128;
+
+        std::shared_ptr<Shader> m_reduceShader;
+        GLuint m_vao = 0;
+        GLuint m_fbo = 0;
+        GLuint m_depthCopy = 0;    // Full resolution depth
+        GLuint m_pyramid = 0;      // R32F, level 0 is half resolution
+        GLuint m_readbackPBO = 0;
+        GLsync m_readbackFence = nullptr;
+
+        int m_width = 0;
+        int m_height = 0;
+        int m_readbackLevel = 0;   // Pyramid level copied to the CPU
+        glm::ivec2 m_readbackSize{0};
+        glm::mat4 m_pendingViewProj{1.0f};
+
+        // CPU pyramid, m_levels[0] is pyramid level m_readbackLevel
+        std::vector<std::vector<float>> m_levels;
+        std::vector<glm::ivec2> m_levelSizes;
+        glm::mat4 m_viewProj{1.0f};
+        int m_sourceWidth = 0;
+        int m_sourceHeight = 0;
+        bool m_hasData = false;
+    };
+
+} // namespace Klein
+
+#endif // HIZBUFFER_H
@@ -0,0 +1,79 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <blockingconcurrentqueue.h>
+
+namespace Klein {
+
+    struct JobCounter;
+
+    // A submitted job. Queued for the workers and, with a counter, on that counter
+    // as well; whichever thread claims it first runs it
+    struct JobTask {
+        std::function<void()> job;
+        JobCounter* counter = nullptr;
+        std::atomic<bool> claimed{false};
+    };
+
+    // Tracks a group of submitted jobs; Wait() returns once all of them finished
+    struct JobCounter {
+        std::atomic<uint32_t> pending{0};
+
+        bool IsDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+        // The group's jobs, for threads waiting on it (JobSystem only)
+        std::mutex laneMutex;
+        std::deque<std::shared_ptr<JobTask>> lane;
+    };
+
+    // Fixed pool of worker threads fed from a lock-free queue. Threads that wait on a
+    // counter run that counter's queued jobs instead of blocking, so jobs may spawn and
+    // wait on other jobs without deadlocking. They never pick up unrelated jobs, so a
+    // frame-critical ParallelFor doesn't end up running a long meshing or decode job.
+    class JobSystem {
+    public:
+        using Job = std::function<void()>;
+        using RangeJob = std::function<void(size_t begin, size_t end)>;
+
+        static JobSystem& Get();
+
+        void Submit(Job job, JobCounter* counter = nullptr);
+        void Wait(JobCounter& counter);
+
+        // Splits [0, count) into chunks of at least grainSize and runs them across the
+        // workers and the calling thread; returns when every chunk has completed
+        void ParallelFor(size_t count, size_t grainSize, const RangeJob& job);
+
+        uint32_t GetWorkerCount() const { return (uint32_t)m_workers.size(); }
+
+        // Number of distinct values GetThreadIndex() can return (workers + non-worker threads)
+        uint32_t GetThreadSlotCount() const { return GetWorkerCount() + 1; }
+        // 0 for any non-worker thread, 1..N for workers. Non-worker threads all share 0
+        // and may run jobs while waiting, so this can't key scratch data written by
+        // jobs; index such data by chunk instead
+        static uint32_t GetThreadIndex();
+
+    private:
+        JobSystem();
+        ~JobSystem();
+
+        void WorkerLoop(uint32_t index);
+        // Runs the task unless another thread claimed it first
+        static void Execute(JobTask& task);
+
+        moodycamel::BlockingConcurrentQueue<std::shared_ptr<JobTask>> m_queue;
+        std::vector<std::thread> m_workers;
+        std::atomic<bool> m_running{true};
+    };
+
+} // namespace Klein
+
+#endif // JOBSYSTEM_H
@@ -0,0 +1,117 @@
+#ifndef MATERIALTABLE_H
+#define MATERIALTABLE_H
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "UniformBuffer.h"
+#include "SamplerCache.h"
+
+namespace Klein {
+
+    class Material;
+    class Texture;
+
+    // Per-frame table of material properties and texture references in an SSBO (GL 4.3+),
+    // so objects with different materials can share one instanced draw. Each instance
+    // carries its material's index.
+    //
+    // Textures are referenced through ARB_bindless_texture handles where available.
+    // Elsewhere they are copied into GL_TEXTURE_2D_ARRAYs, one per format, size, mip
+    // count and sampler, bound to kMaxArrays fixed units. A texture that fits no array makes Add()
+    // fail, and the caller draws that material the regular way.
+    class MaterialTable {
+    public:
+        // Mirror of the std430 struct in the batched shader
+        struct MaterialData {
+            glm::vec4 albedoMetallic;
+            glm::vec4 roughnessAo;     // x = roughness, y = ao
+            glm::uvec4 albedoMap;      // w = present; bindless: xy = handle, else x = array, y = layer
+            glm::uvec4 normalMap;
+        };
+        static_assert(sizeof(MaterialData) == 64, "MaterialData must match std430 layout");
+
+        static constexpr uint32_t kInvalidIndex = UINT32_MAX;
+        static constexpr GLuint kMaxArrays = 8;    // Matches u_MaterialArrays in the shader
+
+        MaterialTable();
+        ~MaterialTable();
+
+        MaterialTable(const MaterialTable&) = delete;
+        MaterialTable& operator=(const MaterialTable&) = delete;
+
+        static bool IsSupported();
+        static bool HasBindless();
+
+        // Starts a new frame's table
+        void BeginFrame();
+
+        // Index of the material in this frame's table, adding it on first use. Textures
+        // may be null (absent or not resident yet)
+        uint32_t Add(const Material* material, const MaterialBlock& block,
+                     const Texture* albedoMap, const Texture* normalMap, const SamplerDesc& sampler);
+
+        // Uploads the table and binds it along with the texture arrays
+        void Bind();
+
+        uint32_t GetMaterialCount() const { return (uint32_t)m_materials.size(); }
+
+    private:
+        struct TextureArray {
+            GLuint texture = 0;
+            GLenum internalFormat = 0;
+            int width = 0;
+            int height = 0;
+            int levels = 0;
+            GLuint sampler = 0;            // From SamplerCache, bound with the array
+            int capacity = 0;              // Layers
+            int used = 0;                  // High-water mark
+            std::vector<int> freeLayers;
+        };
+
+        struct Placement {
+            uint32_t array;
+            uint32_t layer;
+            uint64_t lastUsed;
+        };
+
+        // A texture is placed once per sampler it's used with
+        struct PlacementKey {
+            uint64_t contentID;            // Texture::GetContentID()
+            GLuint sampler;
+
+            bool operator==(const PlacementKey& other) const = default;
+        };
+        struct PlacementKeyHash {
+            size_t operator()(const PlacementKey& key) const {
+                return std::hash<uint64_t>()(key.contentID ^ ((uint64_t)key.sampler << 40));
+            }
+        };
+
+        bool Reference(const Texture* texture, GLuint sampler, glm::uvec4& out);
+        bool Place(const Texture& texture, GLuint sampler, Placement& out);
+        void Grow(TextureArray& array, int capacity);
+        void ReleaseStale();
+
+        GLuint m_buffer = 0;
+        size_t m_capacity = 0;             // Entries
+        std::vector<MaterialData> m_materials;
+        std::unordered_map<const Material*, uint32_t> m_indices;
+
+        bool m_bindless = false;
+        std::vector<TextureArray> m_arrays;
+        std::unordered_map<PlacementKey, Placement, PlacementKeyHash> m_placements;
+        GLint m_maxLayers = 256;
+        bool m_reportedFull = false;
+        uint64_t m_frame = 0;
+
+        // Layers of textures unseen this long are reused; also covers deleted textures
+        static constexpr uint64_t kRetainFrames = 120;
+    };
+
+} // namespace Klein
+
+#endif // MATERIALTABLE_H
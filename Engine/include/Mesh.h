@@ -1,11 +1,17 @@
 #ifndef MESH_H
 #define MESH_H
 
+#include <atomic>
 #include <vector>
 #include <memory>
 #include <string>
+#include <cstdint>
+#include <utility>
 #include <glm/glm.hpp>
 #include <glad/glad.h>
+#include "UniformBuffer.h"
+#include "TextureLoader.h"
+#include "SamplerCache.h"
 
 namespace Klein {
 
@@ -27,16 +33,38 @@ namespace Klein {
             Ambient
         };
 
-        Texture(const std::string& path, Type type);
         ~Texture();
 
-        void Bind(unsigned int slot = 0) const;
+        // Samples through 'sampler', or the default SamplerDesc when 0
+        void Bind(unsigned int slot = 0, GLuint sampler = 0) const;
         void Unbind() const;
 
+        // Uploads data kept back for lack of a GL context; Bind() does this implicitly
+        void EnsureUploaded() const;
+
         GLuint GetID() const { return m_textureID; }
         Type GetType() const { return m_type; }
         const std::string& GetPath() const { return m_path; }
 
+        // Loads an image file: decodes on a job worker and streams mips in over the next
+        // frames (see TextureStreamer). Not drawn until IsReady()
+        static std::shared_ptr<Texture> Stream(const std::string& path, Type type = Type::Diffuse);
+
+        // Render thread: false while a streamed texture has nothing resident yet
+        bool IsReady() const { return m_textureID != 0 || m_pending != nullptr; }
+
+        // Reports the on-screen size, in pixels, of something using this texture. Any
+        // thread; the streamer keeps the largest value per frame
+        void RequestResolution(float pixels) const;
+
+        // Unique for every GL texture object this texture has held; streaming swaps
+        // objects, so caches keyed on the texture check this
+        uint64_t GetContentID() const { return m_contentID; }
+
+        // Resident ARB_bindless_texture handle for the current texture object sampled
+        // through 'sampler'. Render thread, and only where the extension is supported
+        GLuint64 GetBindlessHandle(GLuint sampler) const;
+
         // Create texture from raw data
         static std::shared_ptr<Texture> CreateFromData(
             unsigned char* data, 
@@ -47,10 +75,25 @@ namespace Klein {
         );
 
     private:
-        GLuint m_textureID;
+        friend class TextureStreamer;
+        struct DeferredLoad {};
+        Texture(const std::string& path, Type type, DeferredLoad);
+
+        // Without a current GL context (update thread) the data is kept and uploaded on
+        // first Bind (CreateFromData). Unsupported compressed formats are decoded in place
+        void Upload(TextureData& data) const;
+        // Releases the bindless handles of the previous object, so call it before deleting that
+        void SetTextureID(GLuint texture) const;
+
+        mutable GLuint m_textureID = 0;
         Type m_type;
         std::string m_path;
-        int m_width, m_height, m_channels;
+        int m_width = 0, m_height = 0, m_channels = 0;
+        mutable std::unique_ptr<TextureData> m_pending;
+        mutable std::atomic<uint32_t> m_requestedSize{0};
+        mutable uint64_t m_contentID = 0;
+        // By sampler, for the current object; made non-resident when it's replaced or deleted
+        mutable std::vector<std::pair<GLuint, GLuint64>> m_bindlessHandles;
     };
 
     class Material {
@@ -71,20 +114,83 @@ namespace Klein {
         std::shared_ptr<Texture> roughnessMap;
         std::shared_ptr<Texture> aoMap;
 
+        // Filtering shared by all of the maps above
+        SamplerDesc sampler;
+
         // Shader to use (we'll implement a simple shader manager)
         std::string shaderName = "default";
+
+        // Properties as laid out in the Material uniform block
+        MaterialBlock GetBlock() const;
+
+        // Binds the material's uniform block, re-uploading it only when a property changed.
+        // The render thread passes the block captured in the frame snapshot
+        void BindUniforms() const { BindUniforms(GetBlock()); }
+        void BindUniforms(const MaterialBlock& block) const;
+
+    private:
+        // GPU copy of the properties above; deliberately not shared between copies
+        struct GPUState {
+            std::unique_ptr<UniformBuffer> buffer;
+            MaterialBlock uploaded;
+
+            GPUState() = default;
+            GPUState(const GPUState&) {}
+            GPUState& operator=(const GPUState&) { return *this; }
+        };
+        mutable GPUState m_gpu;
     };
 
     class Mesh {
     public:
+        // CPU copies of the geometry. Empty after upload unless the mesh was created
+        // with keepCPUData (physics, picking) - use the counts below instead.
         std::vector<Vertex> vertices;
         std::vector<unsigned int> indices;
 
-        Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
+        // Uploads immediately when the calling thread has a GL context; otherwise the
+        // geometry is kept and uploaded on first use by the render thread
+        Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+             bool keepCPUData = false);
         ~Mesh();
 
+        void EnsureUploaded() const;
+        bool IsUploaded() const { return m_uploaded; }
+
         void Draw() const;
 
+        // Instanced drawing: per-instance model matrices (mat4, attribute locations
+        // 5-8) are sourced from 'buffer' starting at 'offset'. With 'withInfo' each
+        // instance is followed by a uvec2 (location 9) and 'stride' covers both
+        static constexpr GLuint kInstanceAttribLocation = 5;
+        static constexpr GLuint kInstanceInfoAttribLocation = 9;
+        void BindInstanceBuffer(GLuint buffer, GLintptr offset, GLsizei stride = sizeof(glm::mat4),
+                                bool withInfo = false) const;
+        void DrawInstanced(GLsizei instanceCount) const;
+
+        // Geometry sizes, valid whether or not the CPU copies are still resident
+        uint32_t GetVertexCount() const { return m_vertexCount; }
+        uint32_t GetIndexCount() const { return m_indexCount; }
+
+        bool HasCPUData() const { return !indices.empty(); }
+        void ReleaseCPUData();
+
+        // Level of detail. LOD 0 is this mesh; coarser levels are generated with
+        // MeshSimplifier, each keeping roughly 'reduction' of the previous level's triangles.
+        void GenerateLODs(int levelCount = 3, float reduction = 0.5f);
+        int GetLODCount() const { return (int)m_lods.size() + 1; }
+        const Mesh* GetLOD(int level) const;
+
+        // Projected size (fraction of viewport height) below which LOD 'level' (>= 1) is used
+        float GetLODScreenSize(int level) const;
+        void SetLODScreenSize(int level, float screenSize);
+
+        // Object space bounds
+        const glm::vec3& GetBoundsMin() const { return m_boundsMin; }
+        const glm::vec3& GetBoundsMax() const { return m_boundsMax; }
+        glm::vec3 GetBoundsCenter() const { return (m_boundsMin + m_boundsMax) * 0.5f; }
+        float GetBoundsRadius() const { return m_boundsRadius; }
+
         // Primitive mesh generators
         static std::shared_ptr<Mesh> CreateCube();
         static std::shared_ptr<Mesh> CreateSphere(int segments = 32);
@@ -92,11 +198,28 @@ namespace Klein {
         static std::shared_ptr<Mesh> CreateQuad();
 
         GLuint GetVAO() const { return m_VAO; }
+        GLuint GetVertexBuffer() const { return m_VBO; }
+        GLuint GetIndexBuffer() const { return m_EBO; }
 
     private:
         void SetupMesh();
+        void ComputeBounds();
+
+        GLuint m_VAO = 0, m_VBO = 0, m_EBO = 0;
+        bool m_uploaded = false;
+        bool m_keepCPUData;
+        uint32_t m_vertexCount = 0;
+        uint32_t m_indexCount = 0;
 
-        GLuint m_VAO, m_VBO, m_EBO;
+        glm::vec3 m_boundsMin{0.0f};
+        glm::vec3 m_boundsMax{0.0f};
+        float m_boundsRadius = 0.0f;
+
+        struct LODLevel {
+            std::shared_ptr<Mesh> mesh;
+            float screenSize;
+        };
+        std::vector<LODLevel> m_lods;
     };
 
 } // namespace Klein
@@ -0,0 +1,29 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <vector>
+#include <cstddef>
+#include "Mesh.h"
+
+namespace Klein {
+
+    // Quadric error metric simplification (Garland & Heckbert edge collapse).
+    // Vertices are only ever collapsed onto existing vertices, so every surviving
+    // vertex keeps its original normal/UV/tangent data. Open borders (plane edges,
+    // UV seams) are weighted heavily so silhouettes and seams survive.
+    class MeshSimplifier {
+    public:
+        // Reduces an indexed triangle list to at most targetIndexCount indices (or as
+        // close as the topology allows). Returns false if nothing could be collapsed.
+        static bool Simplify(
+            const std::vector<Vertex>& vertices,
+            const std::vector<unsigned int>& indices,
+            size_t targetIndexCount,
+            std::vector<Vertex>& outVertices,
+            std::vector<unsigned int>& outIndices
+        );
+    };
+
+} // namespace Klein
+
+#endif // MESHSIMPLIFIER_H
@@ -0,0 +1,117 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Klein {
+
+    // CPU instrumentation exported as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+    //
+    // KLEIN_PROFILE_SCOPE("Name") times the enclosing scope. Zones are appended to a
+    // fixed-size buffer owned by the recording thread, so recording never takes a
+    // lock; outside a capture a zone costs one relaxed load. Without
+    // KLEIN_PROFILER_ENABLED the macros compile to nothing.
+    //
+    // Captures cover whole frames: RequestCapture() starts at the next frame boundary
+    // (KLEIN_PROFILE_FRAME, called by App::Run) and writes the trace once the
+    // requested number of frames has passed.
+    class Profiler {
+    public:
+        static Profiler& Get();
+
+        void RequestCapture(uint32_t frames, const std::string& path);
+        static bool IsCapturing() { return s_capturing.load(std::memory_order_relaxed); }
+
+        // Frame boundary; update thread
+        void NewFrame();
+        // Writes a capture still in progress now instead of at its last frame
+        void FinishCapture();
+
+        // Label for the calling thread in exported traces
+        static void SetThreadName(const std::string& name);
+
+        // Used by ProfileScope. Names must outlive the capture (string literals)
+        static uint64_t Now();
+        void Record(const char* name, uint64_t start, uint64_t end);
+
+    private:
+        struct Zone {
+            const char* name;
+            uint64_t start;                // Now() ticks (ns)
+            uint64_t end;
+        };
+
+        // Written only by its thread; the exporter reads zones [0, count)
+        struct ThreadBuffer {
+            std::unique_ptr<Zone[]> zones;
+            std::atomic<uint32_t> count{0};
+            std::atomic<uint32_t> generation{0};   // Capture the zones belong to
+            std::atomic<uint32_t> dropped{0};
+            uint32_t id = 0;
+            std::string name;
+        };
+
+        Profiler() = default;
+
+        ThreadBuffer* RegisterThread();
+        void WriteTrace();
+
+        // Zones per thread per capture; later ones are dropped (24 bytes each)
+        static constexpr uint32_t kZonesPerThread = 1 << 16;
+
+        static inline std::atomic<bool> s_capturing{false};
+        static inline thread_local ThreadBuffer* s_threadBuffer = nullptr;
+        static inline thread_local std::string s_threadName;
+
+        std::mutex m_mutex;                // Thread list and capture requests
+        std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+        std::atomic<uint32_t> m_generation{0};
+
+        uint32_t m_requestedFrames = 0;
+        std::string m_requestedPath;
+        uint32_t m_captureFrames = 0;
+        uint32_t m_capturedFrames = 0;
+        std::string m_capturePath;
+        uint64_t m_captureStart = 0;
+    };
+
+    class ProfileScope {
+    public:
+        explicit ProfileScope(const char* name)
+            : m_name(name), m_active(Profiler::IsCapturing()), m_start(m_active ? Profiler::Now() : 0) {}
+        ~ProfileScope() {
+            if (m_active) {
+                Profiler::Get().Record(m_name, m_start, Profiler::Now());
+            }
+        }
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+        const char* m_name;
+        bool m_active;
+        uint64_t m_start;
+    };
+
+} // namespace Klein
+
+#define KLEIN_PROFILE_CONCAT_INNER(a, b) a##b
+#define KLEIN_PROFILE_CONCAT(a, b) KLEIN_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef KLEIN_PROFILER_ENABLED
+    #define KLEIN_PROFILE_SCOPE(name) ::Klein::ProfileScope KLEIN_PROFILE_CONCAT(kleinProfileScope, __LINE__)(name)
+    #define KLEIN_PROFILE_FRAME() ::Klein::Profiler::Get().NewFrame()
+    #define KLEIN_PROFILE_THREAD(name) ::Klein::Profiler::SetThreadName(name)
+#else
+    #define KLEIN_PROFILE_SCOPE(name) ((void)0)
+    #define KLEIN_PROFILE_FRAME() ((void)0)
+    #define KLEIN_PROFILE_THREAD(name) ((void)0)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,44 @@
+#ifndef PROGRAMBINARYCACHE_H
+#define PROGRAMBINARYCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <glad/glad.h>
+
+namespace Klein {
+
+    // On-disk cache of linked program binaries (glGetProgramBinary / glProgramBinary).
+    //
+    // Entries are keyed by a hash of the shader sources and of the GL vendor, renderer
+    // and version strings, so a driver update simply misses instead of loading a stale
+    // binary. Drivers may still reject a binary; callers then compile from source and
+    // store the fresh result.
+    class ProgramBinaryCache {
+    public:
+        static ProgramBinaryCache& Get();
+
+        // Empty disables the cache. Needs a current context for the driver strings
+        void SetDirectory(const std::string& directory);
+        bool IsEnabled() const { return m_enabled; }
+
+        uint64_t MakeKey(const std::string& vertexSrc, const std::string& fragmentSrc) const;
+
+        // Loads the cached binary into 'program'; false if missing or rejected
+        bool Load(uint64_t key, GLuint program);
+        // Saves a successfully linked program. Link it with
+        // GL_PROGRAM_BINARY_RETRIEVABLE_HINT set so the driver keeps the binary around
+        void Store(uint64_t key, GLuint program);
+
+    private:
+        ProgramBinaryCache() = default;
+
+        std::string GetPath(uint64_t key) const;
+
+        std::string m_directory;
+        uint64_t m_driverHash = 0;
+        bool m_enabled = false;
+    };
+
+} // namespace Klein
+
+#endif // PROGRAMBINARYCACHE_H
@@ -0,0 +1,104 @@
+#ifndef REGIONFILE_H
+#define REGIONFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Klein {
+
+    // One file holding a 32x32 grid of chunk payloads.
+    //
+    // A header with an offset table is followed by 4 KB sectors. Each payload is
+    // LZ4-compressed on its own and occupies a run of whole sectors, so one chunk
+    // can be rewritten without touching the rest of the file. Not thread-safe;
+    // RegionStore serialises access.
+    //
+    // Writes never overwrite live data: a payload always goes to a free run, and the
+    // header entries pointing at new runs are only written by Flush(), after the
+    // payloads have reached the disk. The runs they replace are freed after that, so
+    // a crash at any point leaves every chunk at its old or its new version.
+    class RegionFile {
+    public:
+        static constexpr int kSize = 32;
+        static constexpr int kEntryCount = kSize * kSize;
+        static constexpr size_t kSectorSize = 4096;
+        // Largest uncompressed payload; sizes read from disk above it are rejected
+        static constexpr size_t kMaxPayloadSize = 1 << 20;
+
+        enum class Compression : uint16_t { None = 0, LZ4 = 1 };
+
+        // Null if the file can't be opened (or doesn't exist and 'create' is false)
+        static std::unique_ptr<RegionFile> Open(const std::string& path, bool create);
+        ~RegionFile();                     // Flushes
+
+        RegionFile(const RegionFile&) = delete;
+        RegionFile& operator=(const RegionFile&) = delete;
+
+        bool Has(int x, int z) const { return m_entries[Slot(x, z)].sectorCount != 0; }
+
+        // Uncompressed payload of chunk (x, z), 0 <= x, z < kSize. Reads see writes
+        // that haven't been flushed yet
+        bool Read(int x, int z, std::vector<uint8_t>& out);
+        bool Write(int x, int z, const uint8_t* data, size_t size);   // False above kMaxPayloadSize
+
+        // Syncs written payloads to disk, then commits their header entries (synced
+        // as well) and frees the runs they replaced. False if any step failed; the
+        // writes stay pending and are retried by the next Flush
+        bool Flush();
+
+        size_t GetFileSize() const { return (size_t)m_sectorCount * kSectorSize; }
+
+    private:
+        struct Header {
+            char magic[4];
+            uint32_t version;
+            uint32_t entryCount;
+            uint32_t reserved;
+        };
+
+        struct Entry {
+            uint32_t sector;               // First sector of the payload
+            uint16_t sectorCount;          // 0 = never written
+            Compression compression;
+            uint32_t storedSize;           // Bytes on disk
+            uint32_t rawSize;              // Bytes after decompression
+        };
+        static_assert(sizeof(Entry) == 16, "Entry is part of the file format");
+
+        static constexpr uint32_t kVersion = 1;
+        static constexpr uint32_t kHeaderSectors =
+            (uint32_t)((sizeof(Header) + sizeof(Entry) * kEntryCount + kSectorSize - 1) / kSectorSize);
+
+        static int Slot(int x, int z) { return x + z * kSize; }
+
+        // A run a flushed header entry no longer points at
+        struct FreedRun {
+            uint32_t sector;
+            uint32_t count;
+        };
+
+        RegionFile() = default;
+
+        bool Load();
+        bool Sync();
+        uint32_t Allocate(uint32_t sectors);
+        void MarkSectors(uint32_t first, uint32_t count, bool used);
+
+        std::FILE* m_file = nullptr;
+        Entry m_entries[kEntryCount] = {};
+        std::vector<bool> m_usedSectors;
+        uint32_t m_sectorCount = kHeaderSectors;
+        std::vector<char> m_compressed;
+
+        // Written since the last successful Flush
+        std::vector<int> m_dirtySlots;
+        std::vector<FreedRun> m_replacedRuns;
+    };
+
+} // namespace Klein
+
+#endif // REGIONFILE_H
@@ -0,0 +1,92 @@
+#ifndef REGIONSTORE_H
+#define REGIONSTORE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include "RegionFile.h"
+#include "VoxelChunk.h"
+
+namespace Klein {
+
+    // Chunk persistence in a directory of RegionFiles, written by a background thread.
+    //
+    // Each file covers 32x32 chunks at one chunk height (r.<x>.<y>.<z>.kreg).
+    // SaveChunks only queues shared snapshots and returns; VoxelWorld's chunks are
+    // copy-on-write, so snapshotting costs a reference count and the game keeps
+    // editing. Loads check queued snapshots first, so they always see the latest save.
+    // Each snapshot's outcome is reported back through TakeSaveResults.
+    class RegionStore {
+    public:
+        using ChunkSnapshot = std::pair<glm::ivec3, std::shared_ptr<const VoxelChunk>>;
+
+        struct SaveResult {
+            glm::ivec3 coord;
+            const VoxelChunk* chunk;       // Identifies the snapshot; not kept alive
+            bool saved;                    // Written and synced; false if it failed
+        };
+
+        explicit RegionStore(const std::string& directory);
+        ~RegionStore();                    // Writes everything still queued
+
+        RegionStore(const RegionStore&) = delete;
+        RegionStore& operator=(const RegionStore&) = delete;
+
+        // False when the chunk was never saved (or its data is damaged)
+        bool LoadChunk(const glm::ivec3& chunkCoord, VoxelChunk& out);
+
+        void SaveChunks(std::vector<ChunkSnapshot> chunks);
+        // Appends the outcomes since the last call. Snapshots superseded by a newer
+        // one of the same chunk before being written aren't reported
+        void TakeSaveResults(std::vector<SaveResult>& out);
+
+        // Blocks until everything queued so far is on disk
+        void Flush();
+
+        size_t GetQueuedCount();
+        uint64_t GetSavedCount() const { return m_savedCount; }
+
+    private:
+        struct CoordHash {
+            size_t operator()(const glm::ivec3& c) const {
+                return ((size_t)(uint32_t)c.x * 73856093u) ^ ((size_t)(uint32_t)c.y * 19349663u) ^
+                       ((size_t)(uint32_t)c.z * 83492791u);
+            }
+        };
+
+        void ThreadMain();
+        // Caller holds m_fileMutex
+        RegionFile* GetRegion(const glm::ivec3& regionCoord, bool create);
+
+        static glm::ivec3 ToRegionCoord(const glm::ivec3& chunkCoord);
+
+        std::string m_directory;
+
+        // Save queue; m_pending holds the newest queued snapshot per chunk
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        std::condition_variable m_idle;
+        std::vector<ChunkSnapshot> m_queue;
+        std::unordered_map<glm::ivec3, std::shared_ptr<const VoxelChunk>, CoordHash> m_pending;
+        std::vector<SaveResult> m_results;
+        bool m_writing = false;
+        bool m_stopRequested = false;
+        std::thread m_thread;
+
+        std::mutex m_fileMutex;
+        std::unordered_map<glm::ivec3, std::unique_ptr<RegionFile>, CoordHash> m_regions;
+        std::vector<uint8_t> m_loadBuffer;
+        std::atomic<uint64_t> m_savedCount{0};
+    };
+
+} // namespace Klein
+
+#endif // REGIONSTORE_H
@@ -0,0 +1,85 @@
+#ifndef RENDERSNAPSHOT_H
+#define RENDERSNAPSHOT_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Components.h"
+#include "UniformBuffer.h"
+#include "ClusteredLighting.h"
+
+namespace Klein {
+
+    class Mesh;
+    class Material;
+    class Texture;
+
+    // One renderable, fully resolved by the update stage
+    struct DrawPacket {
+        const Mesh* mesh;              // LOD already selected
+        Material* material;            // Batching identity and owner of the uniform buffer
+        const Texture* albedoMap;
+        const Texture* normalMap;
+        MaterialBlock materialBlock;   // Material properties at extraction time
+        glm::mat4 model;
+        glm::vec3 center;              // World space bounding sphere
+        float radius;
+        bool castShadows;
+        bool receiveShadows;
+        bool isStatic;
+        bool visible;                  // Inside the camera frustum
+        bool batched;                  // Drawn through the material table when it can place it
+        uint64_t sortKey;              // Orders packets so batchable ones are adjacent
+    };
+
+    // Static entity entering the GPU-driven scene
+    struct GPUObjectPacket {
+        uint32_t entityID;
+        std::shared_ptr<Mesh> mesh;
+        MaterialBlock materialBlock;
+        glm::mat4 model;
+        uint32_t flags;
+        float lodBias;
+    };
+
+    // Everything the renderer needs for one frame. Built on the update thread, then
+    // read-only until the render thread is done with it
+    struct FrameSnapshot {
+        bool hasCamera = false;
+        CameraComponent camera;
+        glm::mat4 view{1.0f};
+        glm::mat4 projection{1.0f};
+        glm::vec3 cameraPosition{0.0f};
+        float aspectRatio = 1.0f;
+        int viewportWidth = 0;
+        int viewportHeight = 0;
+
+        // LOD metric parameters, shared with GPU-side LOD selection
+        float lodProjScale = 1.0f;
+        bool lodPerspective = true;
+
+        std::vector<ClusteredLighting::DirectionalLight> dirLights;
+        std::vector<ClusteredLighting::PointLight> pointLights;
+        std::vector<DrawPacket> packets;
+
+        std::vector<GPUObjectPacket> gpuAdded;
+        std::vector<uint32_t> gpuRemoved;  // Entity IDs
+
+        // Keeps meshes, materials and textures referenced above alive until rendered
+        std::vector<std::shared_ptr<const void>> resources;
+
+        void Clear() {
+            hasCamera = false;
+            dirLights.clear();
+            pointLights.clear();
+            packets.clear();
+            gpuAdded.clear();
+            gpuRemoved.clear();
+            resources.clear();
+        }
+    };
+
+} // namespace Klein
+
+#endif // RENDERSNAPSHOT_H
@@ -0,0 +1,74 @@
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "RenderSnapshot.h"
+
+namespace Klein {
+
+    class Window;
+    class Renderer;
+
+    // Dedicated GL submission thread.
+    //
+    // The render thread owns the window's GL context while it runs. The update stage
+    // fills one of two FrameSnapshots and hands it over with SubmitFrame, then goes on
+    // to simulate the next frame while this one is drawn and presented. Handing over
+    // waits for the previous frame to finish, so the pipeline is one frame deep and
+    // frame time becomes max(update, render) rather than their sum.
+    class RenderThread {
+    public:
+        RenderThread(Window* window, Renderer* renderer);
+        ~RenderThread();
+
+        RenderThread(const RenderThread&) = delete;
+        RenderThread& operator=(const RenderThread&) = delete;
+
+        // Moves the calling thread's GL context to the render thread / back again
+        void Start();
+        void Stop();
+
+        // Snapshot to fill for the next frame; never the one being rendered
+        FrameSnapshot& BeginFrame();
+        void SubmitFrame();
+
+        // Runs on the render thread after each frame, before the swap (UI rendering)
+        void SetUICallback(std::function<void()> callback) { m_uiCallback = std::move(callback); }
+
+        // Runs 'task' now if this thread has a current GL context, otherwise queues it
+        // for whichever thread next owns one. Used for GL object deletion from any thread
+        static void RunOnContext(std::function<void()> task);
+        static bool HasContext();
+
+        // Runs everything queued by RunOnContext; requires a current context.
+        // Renderer::RenderFrame calls it every frame
+        static void ExecutePendingTasks();
+
+    private:
+        void ThreadMain();
+
+        Window* m_window;
+        Renderer* m_renderer;
+        std::thread m_thread;
+        std::function<void()> m_uiCallback;
+
+        FrameSnapshot m_snapshots[2];
+        int m_writeIndex = 0;
+
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        FrameSnapshot* m_pending = nullptr;  // Handed over, not yet finished
+        bool m_stopRequested = false;
+        bool m_running = false;
+
+        static inline std::mutex s_taskMutex;
+        static inline std::vector<std::function<void()>> s_tasks;
+    };
+
+} // namespace Klein
+
+#endif // RENDERTHREAD_H
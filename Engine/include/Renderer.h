@@ -3,21 +3,54 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
+#include <unordered_map>
 #include "Scene.h"
 #include "Components.h"
 #include "Mesh.h"
 #include "Shader.h"
+#include "RingBuffer.h"
+#include "UniformBuffer.h"
+#include "ClusteredLighting.h"
+#include "ShadowMapper.h"
+#include "Frustum.h"
+#include "HiZBuffer.h"
+#include "GPUScene.h"
+#include "MaterialTable.h"
+#include "RenderSnapshot.h"
 #include <glm/glm.hpp>
 
 namespace Klein {
 
+    struct ShaderUniformStats {
+        std::string shader;
+        uint32_t writes = 0;
+        uint32_t redundantWrites = 0;      // Skipped because the value was unchanged
+    };
+
     struct RenderStats {
         uint32_t drawCalls = 0;
         uint32_t triangles = 0;
         uint32_t vertices = 0;
-        float frameTime = 0.0f;
+        uint32_t culledObjects = 0;        // Rejected by the view frustum
+        uint32_t shadowDrawCalls = 0;
+        uint32_t shadowCascadeUpdates = 0; // Cascades re-rendered this frame
+        uint32_t occludedObjects = 0;      // Rejected by the Hi-Z test
+        uint32_t depthPrepassDrawCalls = 0;
+        uint64_t shadedSamples = 0;        // Samples passing the depth test in the lit pass
+        float overdraw = 0.0f;             // shadedSamples per viewport pixel (1.0 = none)
+        uint32_t gpuDrivenObjects = 0;     // Culled and drawn on the GPU
+        uint32_t batchedMaterials = 0;     // Materials drawn through the material table
+        uint32_t uniformWrites = 0;
+        uint32_t redundantUniformWrites = 0;
+        std::vector<ShaderUniformStats> shaderUniforms;  // Shaders that were written this frame
+        uint64_t streamedTextureBytes = 0; // Resident and in-flight streamed texture memory
+        uint64_t textureUploadBytes = 0;   // Streamed this frame
+        float frameTime = 0.0f;            // CPU ms spent in RenderFrame
     };
 
     class Renderer {
@@ -28,32 +61,154 @@ namespace Klein {
         void Init();
         void Shutdown();
 
-        // Main render function
+        // Main render function: ExtractFrame followed by RenderFrame on the calling thread
         void RenderScene(Scene* scene, float aspectRatio);
 
-        // Render individual entity
-        void RenderEntity(Entity entity, const glm::mat4& viewProj, const glm::vec3& cameraPos);
+        // Update stage: reads the scene into 'out' without touching GL
+        void ExtractFrame(Scene* scene, float aspectRatio, int viewportWidth, int viewportHeight,
+                          FrameSnapshot& out);
+
+        // Render stage: issues all GL work for a snapshot. Only reads the snapshot, so it
+        // can run on the render thread while the next frame is extracted
+        void RenderFrame(const FrameSnapshot& snapshot);
 
         // Clear screen
         void Clear(const glm::vec4& color = glm::vec4(0.1f, 0.1f, 0.1f, 1.0f));
         
-        // Stats
-        const RenderStats& GetStats() const { return m_stats; }
+        // Stats of the last finished frame; safe to call from any thread
+        RenderStats GetStats() const;
         void ResetStats();
 
-        // Settings
+        // Settings; change them between frames on the thread that renders (UI callback)
         void SetWireframe(bool enabled);
         bool IsWireframe() const { return m_wireframe; }
+        void SetShadowsEnabled(bool enabled) { m_shadowsEnabled = enabled; }
+        bool AreShadowsEnabled() const { return m_shadowsEnabled; }
+        ShadowMapper* GetShadowMapper() { return m_shadowMapper.get(); }
+        void SetDepthPrepass(bool enabled) { m_depthPrepass = enabled; }
+        bool IsDepthPrepassEnabled() const { return m_depthPrepass; }
+        void SetOcclusionCulling(bool enabled) { m_occlusionCulling = enabled; }
+        bool IsOcclusionCullingEnabled() const { return m_occlusionCulling; }
+
+        // Static, untextured default-shader renderables move to the GPU-driven path
+        // (GL 4.3+). Ignored when unsupported
+        void SetGPUDriven(bool enabled);
+        bool IsGPUDriven() const { return m_gpuDriven; }
+        GPUScene* GetGPUScene() { return m_gpuScene.get(); }
+
+        // Default-shader objects share one instanced draw per mesh whatever their
+        // material, through a material table (GL 4.3+). Ignored when unsupported
+        void SetMaterialBatching(bool enabled);
+        bool IsMaterialBatching() const { return m_materialBatching; }
+
+        // Per-frame upload allocator (instance data, debug lines, particles, ...)
+        RingBuffer* GetDynamicBuffer() { return m_dynamicBuffer.get(); }
 
     private:
-        void SetupLighting(Scene* scene, std::shared_ptr<Shader> shader, const glm::vec3& cameraPos);
+        // Output of one block of kExtractGrainSize entities, merged in block order
+        struct ExtractScratch {
+            std::vector<DrawPacket> packets;
+            std::vector<std::shared_ptr<const void>> resources;
+        };
+
+        // Update stage
+        void CollectLights(Scene* scene, FrameSnapshot& out);
+        void SyncRenderables(Scene* scene, FrameSnapshot& out);
+        void AddRenderable(Entity& entity, FrameSnapshot& out);
+        void RemoveRenderable(uint32_t entityID, FrameSnapshot& out);
+        void CollectEntity(Entity& entity, const glm::vec3& cameraPos, const Frustum& frustum,
+                           ExtractScratch& scratch) const;
+        int SelectLOD(const Mesh& mesh, const MeshRendererComponent& meshRenderer,
+                      const glm::vec3& center, float radius, const glm::vec3& cameraPos) const;
 
-        RenderStats m_stats;
+        // Render stage
+        void ApplyGPUChanges(const FrameSnapshot& snapshot);
+        bool HasGPUObjects() const { return m_gpuScene && m_gpuScene->GetObjectCount() > 0; }
+        void DrawGPUScene(const char* shaderName, uint32_t& drawCalls);
+        void SubmitDrawItems();
+        void SubmitBatchedItems();
+        void DrawMaterialGroups(const std::vector<DrawPacket>& items);
+        void RenderShadows(const FrameSnapshot& snapshot);
+        void DrawDepthOnly(std::vector<DrawPacket>& items, uint32_t& drawCalls);
+        void RenderDepthPrepass();
+        void BeginOverdrawQuery();
+        void EndOverdrawQuery(const GLint viewport[4]);
+        bool DrawInstances(const std::vector<DrawPacket>& items, size_t first, size_t last, uint32_t& drawCalls,
+                           const uint32_t* materialIndices = nullptr);
+        bool UploadUniformBlock(GLuint binding, const void* data, GLsizeiptr size);
+        void SetupLighting(const FrameSnapshot& snapshot);
+        void CollectShaderStats();
+
+        RenderStats m_stats;               // Accumulated by the frame being rendered
+        RenderStats m_publishedStats;      // Last finished frame
+        mutable std::mutex m_statsMutex;
         bool m_wireframe = false;
+
+        // LOD selection: projected size = radius * m_lodProjScale / distance (perspective).
+        // Set during extraction and copied into the snapshot for the GPU-driven path
+        float m_lodProjScale = 1.0f;
+        float m_lodViewportHeight = 1.0f;  // Turns projected sizes into pixels for texture streaming
+        bool m_lodPerspective = true;
+        static constexpr float kLODHysteresis = 0.15f;
         
         // Default resources
         std::shared_ptr<Mesh> m_defaultCubeMesh;
         std::shared_ptr<Material> m_defaultMaterial;
+
+        std::unique_ptr<RingBuffer> m_dynamicBuffer;
+        std::vector<DrawPacket> m_drawItems;   // Visible to the camera
+        std::vector<ExtractScratch> m_extractScratch;  // One per entity block
+        static constexpr size_t kExtractGrainSize = 256;
+        FrameSnapshot m_immediateSnapshot;     // Used by RenderScene
+        GLint m_uniformBufferAlignment = 256;
+
+        std::unique_ptr<ClusteredLighting> m_clusteredLighting;
+
+        std::unique_ptr<ShadowMapper> m_shadowMapper;
+        std::vector<DrawPacket> m_staticCasters;
+        std::vector<DrawPacket> m_dynamicCasters;
+        bool m_shadowsEnabled = true;
+        bool m_shadowsRendered = false;
+
+        // Occlusion culling against the previous frames' depth
+        std::unique_ptr<HiZBuffer> m_hiZ;
+        bool m_depthPrepass = false;
+        bool m_occlusionCulling = false;
+
+        // GL_SAMPLES_PASSED results are read a couple of frames late to avoid stalls
+        static constexpr int kOverdrawQueryCount = 3;
+        GLuint m_overdrawQueries[kOverdrawQueryCount] = {};
+        bool m_overdrawQueryPending[kOverdrawQueryCount] = {};
+        int m_overdrawQueryIndex = 0;
+        uint64_t m_lastShadedSamples = 0;
+        float m_lastOverdraw = 0.0f;
+
+        // Renderables, followed through the scene's change log instead of a scan per
+        // frame. CPU-path entities are collected every frame; GPU-driven ones are only
+        // touched when they enter or leave, so their count doesn't cost CPU time
+        Scene* m_trackedScene = nullptr;
+        std::atomic<bool> m_renderablesDirty{true};    // Rescan on the next extraction
+        std::vector<Scene::RenderableChange> m_renderableChanges;
+        std::vector<Entity> m_cpuRenderables;
+        std::unordered_map<uint32_t, size_t> m_cpuRenderableIndices;  // Entity ID -> slot
+
+        // GPU-driven objects, keyed by entity ID. The update stage decides which entities
+        // are on the GPU path and sends additions/removals through the snapshot; the
+        // render stage owns the GPUScene and the object handles
+        std::unique_ptr<GPUScene> m_gpuScene;
+        std::unordered_map<uint32_t, uint64_t> m_gpuEntities;   // Entity ID -> frame it was added
+        std::unordered_map<uint32_t, uint32_t> m_gpuObjects;
+        bool m_gpuSupported = false;
+        std::atomic<bool> m_gpuDriven{false};          // Set from the render thread's UI
+
+        // Material batching; the item lists are rebuilt by every SubmitDrawItems
+        std::unique_ptr<MaterialTable> m_materialTable;
+        std::vector<DrawPacket> m_batchedItems;
+        std::vector<uint32_t> m_batchedMaterials;  // Table index per batched item
+        std::vector<DrawPacket> m_unbatchedItems;
+        std::atomic<bool> m_materialBatching{false};   // Set from the render thread's UI
+        uint64_t m_frameIndex = 0;
+        static constexpr GLsizeiptr kDynamicBufferFrameSize = 4 * 1024 * 1024;
     };
 
 } // namespace Klein
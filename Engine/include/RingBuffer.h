@@ -0,0 +1,65 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+
+namespace Klein {
+
+    // Dynamic upload allocator for data that changes every frame (instance data,
+    // per-frame uniforms, debug lines, particles, streamed geometry).
+    //
+    // One large buffer is split into frameCount regions. On GL 4.4+ it is created
+    // with immutable storage and mapped persistently once; otherwise writes go to a
+    // CPU staging copy and Flush() pushes them with glBufferSubData. Each region is
+    // fenced when its frame ends and only reused once the GPU has passed the fence,
+    // so the buffer is never reallocated or orphaned.
+    class RingBuffer {
+    public:
+        struct Allocation {
+            void* data = nullptr;   // Write pointer, valid until EndFrame()
+            GLintptr offset = 0;    // Offset into GetBuffer()
+            GLsizeiptr size = 0;
+
+            explicit operator bool() const { return data != nullptr; }
+        };
+
+        RingBuffer(GLsizeiptr frameSize, int frameCount = 3);
+        ~RingBuffer();
+
+        RingBuffer(const RingBuffer&) = delete;
+        RingBuffer& operator=(const RingBuffer&) = delete;
+
+        // Waits for the GPU to release this frame's region and rewinds into it
+        void BeginFrame();
+        // Fences everything allocated since BeginFrame()
+        void EndFrame();
+
+        // Returns an empty allocation when the frame's region is exhausted
+        Allocation Allocate(GLsizeiptr size, GLsizeiptr alignment = 16);
+
+        // Makes the written bytes visible to the GPU (no-op when persistently mapped)
+        void Flush(const Allocation& allocation);
+
+        GLuint GetBuffer() const { return m_buffer; }
+        GLsizeiptr GetFrameSize() const { return m_frameSize; }
+        GLsizeiptr GetFrameRemaining() const { return m_frameSize - m_head; }
+        bool IsPersistent() const { return m_persistent; }
+
+    private:
+        GLuint m_buffer = 0;
+        uint8_t* m_mapped = nullptr;
+        std::vector<uint8_t> m_staging; // Fallback when persistent mapping is unavailable
+        bool m_persistent = false;
+
+        GLsizeiptr m_frameSize;
+        int m_frameCount;
+        int m_frameIndex = 0;
+        GLsizeiptr m_head = 0;
+        std::vector<GLsync> m_fences;
+    };
+
+} // namespace Klein
+
+#endif // RINGBUFFER_H
@@ -0,0 +1,51 @@
+#ifndef SAMPLERCACHE_H
+#define SAMPLERCACHE_H
+
+#include <cstddef>
+#include <unordered_map>
+#include <glad/glad.h>
+
+namespace Klein {
+
+    // Filtering and addressing, kept apart from texture storage so materials can change
+    // it without touching the texture
+    struct SamplerDesc {
+        GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR;
+        GLenum magFilter = GL_LINEAR;
+        GLenum wrapS = GL_REPEAT;
+        GLenum wrapT = GL_REPEAT;
+        float anisotropy = 1.0f;       // 1 = off; clamped to what the driver allows
+
+        bool operator==(const SamplerDesc& other) const = default;
+    };
+
+    // Shared sampler objects, one per distinct SamplerDesc. Render thread only
+    class SamplerCache {
+    public:
+        static SamplerCache& Get();
+
+        GLuint GetSampler(const SamplerDesc& desc);
+        GLuint GetDefaultSampler() { return GetSampler(SamplerDesc{}); }
+
+        // 1 when anisotropic filtering is unavailable
+        float GetMaxAnisotropy();
+
+        size_t GetCount() const { return m_samplers.size(); }
+
+        // Deletes every sampler; needs the context they were made in
+        void Clear();
+
+    private:
+        struct DescHash {
+            size_t operator()(const SamplerDesc& desc) const;
+        };
+
+        SamplerCache() = default;
+
+        std::unordered_map<SamplerDesc, GLuint, DescHash> m_samplers;
+        float m_maxAnisotropy = 0.0f;  // 0 until queried
+    };
+
+} // namespace Klein
+
+#endif // SAMPLERCACHE_H
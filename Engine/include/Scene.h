@@ -13,6 +13,12 @@ namespace Klein {
 
     class Scene {
     public:
+        // A MeshRendererComponent added to or removed from an entity
+        struct RenderableChange {
+            Entity entity;
+            bool added;
+        };
+
         Scene(const std::string& name = "Untitled Scene");
         ~Scene();
 
@@ -20,7 +26,8 @@ namespace Klein {
         Entity CreateEntity(const std::string& name = "Entity");
         void DestroyEntity(Entity entity);
 
-        // Queries
+        // Queries. Component queries read a per-type index, so they cost the number of
+        // matches rather than the number of entities
         std::vector<Entity> GetAllEntities();
         template<typename T>
         std::vector<Entity> GetEntitiesWithComponent() {
@@ -28,6 +35,14 @@ namespace Klein {
                 }
         std::vector<Entity> GetEntitiesWithComponent(std::type_index componentType);
 
+        // Renderable changes since the previous call, oldest first, moved into 'out'.
+        // Recording starts with the first call; it returns false then, and the caller
+        // takes the current renderables from GetEntitiesWithComponent instead
+        bool TakeRenderableChanges(std::vector<RenderableChange>& out);
+        // Reports the renderable as removed and added again, for edits the scene can't
+        // see (isStatic, mesh or material changed in place)
+        void RefreshRenderable(Entity entity);
+
         Entity GetPrimaryCamera();
         std::vector<Entity> GetLights();
 
@@ -42,9 +57,26 @@ namespace Klein {
         const std::string& GetName() const { return m_name; }
 
     private:
+        struct ComponentIndex {
+            std::vector<std::shared_ptr<EntityData>> entities;
+            std::unordered_map<uint32_t, size_t> positions;    // Entity ID -> slot in 'entities'
+        };
+
+        void IndexComponent(const std::shared_ptr<EntityData>& data, std::type_index type);
+        void UnindexComponent(uint32_t entityID, std::type_index type);
+        void RecordRenderableChange(const Entity& entity, bool added);
+
         std::string m_name;
         std::vector<std::shared_ptr<EntityData>> m_entities;
+        std::unordered_map<uint32_t, size_t> m_entityPositions;
+        std::unordered_map<std::type_index, ComponentIndex> m_componentIndex;
         unsigned int m_nextEntityID = 1;
+
+        std::vector<RenderableChange> m_renderableChanges;
+        bool m_recordRenderables = false;
+
+        friend void NotifyComponentAdded(const Entity&, std::type_index, bool);
+        friend void NotifyComponentRemoved(const Entity&, std::type_index);
     };
 
 } // namespace Klein
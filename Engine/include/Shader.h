@@ -1,32 +1,100 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <memory>
+#include <vector>
 #include <unordered_map>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 namespace Klein {
 
+    // 32-bit FNV-1a, usable at compile time
+    constexpr uint32_t HashUniformName(std::string_view name) {
+        uint32_t hash = 2166136261u;
+        for (char c : name) {
+            hash = (hash ^ (uint8_t)c) * 16777619u;
+        }
+        return hash;
+    }
+
+    // Uniform name hashed at compile time, so setters never build or hash a string.
+    // Literals convert implicitly; runtime names need the explicit constructor
+    struct UniformID {
+        uint32_t hash;
+
+        template<size_t N>
+        consteval UniformID(const char (&name)[N]) : hash(HashUniformName(std::string_view(name, N - 1))) {}
+        explicit constexpr UniformID(std::string_view name) : hash(HashUniformName(name)) {}
+    };
+
     class Shader {
     public:
-        Shader(const std::string& vertexSrc, const std::string& fragmentSrc);
+        // Reflected at link time
+        struct UniformInfo {
+            std::string name;
+            GLint location;
+            GLenum type;
+            GLint arraySize;
+        };
+        struct AttributeInfo {
+            std::string name;
+            GLint location;
+            GLenum type;
+            GLint arraySize;
+        };
+        struct UniformBlockInfo {
+            std::string name;
+            GLuint index;
+            GLint binding;
+            GLint dataSize;
+        };
+
+        // With 'async' the compile and link are only issued; the shader can't be bound
+        // until PollReady or Finish reports it ready
+        Shader(const std::string& vertexSrc, const std::string& fragmentSrc, bool async = false);
         ~Shader();
 
+        // Non-blocking when KHR_parallel_shader_compile is available; true once linked
+        bool PollReady();
+        // Waits for the driver and finalises the program
+        void Finish();
+        bool IsReady() const { return m_status == Status::Ready; }
+        bool HasFailed() const { return m_status == Status::Failed; }
+
+        // KHR/ARB_parallel_shader_compile: completion can be polled without blocking
+        static bool HasParallelCompile();
+
         void Bind() const;
         void Unbind() const;
 
-        // Uniform setters
-        void SetInt(const std::string& name, int value);
-        void SetFloat(const std::string& name, float value);
-        void SetVec2(const std::string& name, const glm::vec2& value);
-        void SetVec3(const std::string& name, const glm::vec3& value);
-        void SetVec4(const std::string& name, const glm::vec4& value);
-        void SetMat3(const std::string& name, const glm::mat3& value);
-        void SetMat4(const std::string& name, const glm::mat4& value);
+        // Uniform setters. The program must be bound; values equal to the last one
+        // written through these setters are skipped
+        void SetInt(UniformID id, int value);
+        void SetFloat(UniformID id, float value);
+        void SetVec2(UniformID id, const glm::vec2& value);
+        void SetVec3(UniformID id, const glm::vec3& value);
+        void SetVec4(UniformID id, const glm::vec4& value);
+        void SetMat3(UniformID id, const glm::mat3& value);
+        void SetMat4(UniformID id, const glm::mat4& value);
+
+        // -1 if the program has no such active uniform
+        GLint GetUniformLocation(UniformID id) const;
 
         GLuint GetProgramID() const { return m_program; }
 
+        const std::vector<UniformInfo>& GetUniforms() const { return m_uniforms; }
+        const std::vector<AttributeInfo>& GetAttributes() const { return m_attributes; }
+        const std::vector<UniformBlockInfo>& GetUniformBlocks() const { return m_uniformBlocks; }
+
+        // Setter calls that reached GL / were skipped as redundant since the last reset
+        uint32_t GetUniformWrites() const { return m_uniformWrites; }
+        uint32_t GetRedundantUniformWrites() const { return m_redundantUniformWrites; }
+        void ResetUniformStats() { m_uniformWrites = 0; m_redundantUniformWrites = 0; }
+
         // Load from files
         static std::shared_ptr<Shader> LoadFromFiles(
             const std::string& vertexPath,
@@ -34,13 +102,64 @@ namespace Klein {
         );
 
     private:
+        enum class Status {
+            Compiling,
+            Ready,
+            Failed,
+        };
+
+        // Last value written to a uniform, compared before every write
+        struct UniformState {
+            GLint location;
+            bool valid = false;
+            alignas(16) unsigned char value[sizeof(glm::mat4)];
+        };
+
         GLuint CompileShader(GLenum type, const std::string& source);
-        GLint GetUniformLocation(const std::string& name);
+        bool CheckShader(GLuint shader, GLenum type);
+        void BeginCompile(const std::string& vertexSrc, const std::string& fragmentSrc);
+        void BindEngineSlots();
+        void Reflect();
+        void InsertUniform(uint32_t hash, uint32_t state);
+        UniformState* FindUniform(UniformID id);
+        GLint PrepareWrite(UniformID id, const void* value, size_t size);
 
         GLuint m_program;
-        std::unordered_map<std::string, GLint> m_uniformLocationCache;
+        Status m_status = Status::Compiling;
+        GLuint m_vertexShader = 0;     // Only alive while compiling
+        GLuint m_fragmentShader = 0;
+        uint64_t m_cacheKey = 0;
+
+        std::vector<UniformInfo> m_uniforms;
+        std::vector<AttributeInfo> m_attributes;
+        std::vector<UniformBlockInfo> m_uniformBlocks;
+        std::vector<UniformState> m_uniformStates;
+
+        // Open-addressed table of the program's active uniforms, filled once at link
+        // time. Indexed by hash & mask; a lookup is normally a single probe
+        static constexpr uint32_t kEmptySlot = UINT32_MAX;
+        struct UniformSlot {
+            uint32_t hash = 0;
+            uint32_t state = kEmptySlot;   // Index into m_uniformStates
+        };
+        std::vector<UniformSlot> m_uniformTable;
+        uint32_t m_uniformMask = 0;
+
+        uint32_t m_uniformWrites = 0;
+        uint32_t m_redundantUniformWrites = 0;
     };
 
+    // Keywords of a permutation family; each selects specialised code with #ifdef
+    namespace ShaderFeature {
+        constexpr uint32_t AlbedoMap = 1u << 0;
+        constexpr uint32_t NormalMap = 1u << 1;
+        constexpr uint32_t Shadows = 1u << 2;
+        constexpr uint32_t Instanced = 1u << 3;   // Model matrix from the per-instance attribute
+        constexpr uint32_t Count = 4;
+
+        constexpr const char* kNames[Count] = { "ALBEDO_MAP", "NORMAL_MAP", "SHADOWS", "INSTANCED" };
+    }
+
     // Shader Library for managing shaders
     class ShaderLibrary {
     public:
@@ -51,12 +170,54 @@ namespace Klein {
                                       const std::string& vertPath, 
                                       const std::string& fragPath);
         std::shared_ptr<Shader> Get(const std::string& name);
+        const std::unordered_map<std::string, std::shared_ptr<Shader>>& GetAll() const { return m_shaders; }
         
+        // Issues the compile and returns immediately; Update finishes it later
+        std::shared_ptr<Shader> AddAsync(const std::string& name,
+                                         const std::string& vertexSrc,
+                                         const std::string& fragmentSrc);
+
+        // The named shader if it's linked, otherwise the (always ready) default shader
+        std::shared_ptr<Shader> GetOrFallback(const std::string& name);
+
+        // Registers sources whose variants are built by prepending #defines for the
+        // requested ShaderFeature bits after #version
+        void AddPermutations(const std::string& name,
+                             const std::string& vertexSrc,
+                             const std::string& fragmentSrc);
+
+        // Variant for a feature mask, compiled asynchronously on first request and cached
+        // by mask. Until it links, the plain shader registered under 'name' is returned
+        // (falling back to the default shader). Names without permutations act as
+        // GetOrFallback
+        std::shared_ptr<Shader> GetVariant(const std::string& name, uint32_t features);
+
+        // Finalises shaders whose compile completed. Without parallel compile support
+        // this blocks on at most one shader per call. Call once per frame
+        void Update();
+        size_t GetPendingCount() const { return m_pending.size(); }
+
         void CreateDefaultShaders();
 
+        // Drops every shader while the GL context is still alive (Renderer::Shutdown);
+        // the library is static and would otherwise outlive it
+        void Clear();
+
     private:
+        struct Permutations {
+            std::string vertexSrc;
+            std::string fragmentSrc;
+            std::unordered_map<uint32_t, std::shared_ptr<Shader>> variants;
+        };
+
         ShaderLibrary() = default;
+        static std::string InjectDefines(const std::string& source, const std::string& defines);
+        // Replaces the #version line with 'header' (a #version plus any #extension lines)
+        static std::string SetVersion(const std::string& source, const std::string& header);
+
         std::unordered_map<std::string, std::shared_ptr<Shader>> m_shaders;
+        std::unordered_map<std::string, Permutations> m_permutations;
+        std::vector<std::shared_ptr<Shader>> m_pending;
     };
 
 } // namespace Klein
@@ -0,0 +1,92 @@
+#ifndef SHADOWMAPPER_H
+#define SHADOWMAPPER_H
+
+#include <cstdint>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Components.h"
+#include "UniformBuffer.h"
+
+namespace Klein {
+
+    // Cascaded shadow maps for the primary directional light.
+    //
+    // Cascades are fitted to bounding spheres of the camera frustum splits and snapped
+    // to shadow texels across the light (and to the cascade radius along it), so their
+    // matrices only change when the camera moves by at least a texel. Every cascade
+    // keeps a cached depth layer containing only static casters.
+    // A cascade is re-rendered from scratch only when its matrix or static caster set
+    // changes. Otherwise the cache is copied into the sampled map and just the moving
+    // casters are drawn on top, and cascades with nothing moving in them are skipped.
+    class ShadowMapper {
+    public:
+        static constexpr int kCascadeCount = kShadowCascadeCount;
+
+        // What a cascade needs this frame
+        struct CascadePlan {
+            bool renderStatic = false;  // Rebuild the static cache layer
+            bool composite = false;     // Copy cache to the shadow map and draw dynamic casters
+        };
+
+        explicit ShadowMapper(int resolution = 2048);
+        ~ShadowMapper();
+
+        ShadowMapper(const ShadowMapper&) = delete;
+        ShadowMapper& operator=(const ShadowMapper&) = delete;
+
+        void UpdateCascades(const glm::mat4& view, const CameraComponent& camera,
+                            float aspectRatio, const glm::vec3& lightDirection);
+
+        const glm::mat4& GetCascadeViewProj(int cascade) const { return m_cascades[cascade].viewProj; }
+
+        // The fit behind UpdateCascades, without touching GL state
+        static void FitCascades(const glm::mat4& view, const CameraComponent& camera, float aspectRatio,
+                                const glm::vec3& lightDirection, int resolution, float shadowDistance,
+                                float splitLambda, glm::mat4 outViewProj[kCascadeCount],
+                                float outSplitFar[kCascadeCount]);
+
+        CascadePlan PlanCascade(int cascade, uint64_t staticCasterHash, bool hasDynamicCasters);
+
+        // Render targets; both leave the cascade's layer bound with the shadow viewport
+        void BeginStaticPass(int cascade);
+        void BeginDynamicPass(int cascade);  // Copies the static cache in first
+        void EndPasses(GLuint framebuffer, const GLint viewport[4]);
+
+        // Invalidates every cached cascade (e.g. after static geometry changed)
+        void InvalidateCache();
+
+        void Bind() const;
+        void FillBlock(ShadowBlock& block, bool enabled) const;
+
+        float GetShadowDistance() const { return m_shadowDistance; }
+        void SetShadowDistance(float distance) { m_shadowDistance = distance; }
+
+    private:
+        struct Cascade {
+            glm::mat4 viewProj{1.0f};
+            float splitFar = 0.0f;
+
+            // Cache state
+            glm::mat4 cachedViewProj{0.0f};
+            uint64_t cachedStaticHash = 0;
+            bool cacheValid = false;
+            bool hadDynamic = false;
+        };
+
+        GLuint CreateDepthArray(bool comparison) const;
+
+        int m_resolution;
+        float m_shadowDistance = 150.0f;
+        float m_splitLambda = 0.75f;
+
+        GLuint m_shadowMap = 0;    // Sampled, depth compare enabled
+        GLuint m_staticCache = 0;  // Static casters only
+        GLuint m_drawFBO = 0;
+        GLuint m_readFBO = 0;
+
+        Cascade m_cascades[kCascadeCount];
+    };
+
+} // namespace Klein
+
+#endif // SHADOWMAPPER_H
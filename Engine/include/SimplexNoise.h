@@ -0,0 +1,40 @@
+#ifndef SIMPLEXNOISE_H
+#define SIMPLEXNOISE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Klein {
+
+    // Seeded 3D simplex noise (Gustavson's formulation), roughly in [-1, 1].
+    //
+    // Batches run 8 points at a time with AVX2 when the CPU supports it, chosen at
+    // runtime so the engine itself builds without -mavx2. Both paths use the same
+    // arithmetic; results may differ in the last bits where AVX2 fuses multiply-adds.
+    class SimplexNoise {
+    public:
+        explicit SimplexNoise(uint32_t seed = 0);
+
+        float Sample(float x, float y, float z) const;
+
+        // out[i] = Sample(x[i], y[i], z[i])
+        void SampleBatch(const float* x, const float* y, const float* z, float* out, size_t count) const;
+
+        // Sum of 'octaves' layers, each at 'lacunarity' times the frequency and 'gain'
+        // times the amplitude of the previous; normalised back to about [-1, 1]
+        float Fractal(float x, float y, float z, int octaves, float lacunarity = 2.0f, float gain = 0.5f) const;
+        void FractalBatch(const float* x, const float* y, const float* z, float* out, size_t count,
+                          int octaves, float lacunarity = 2.0f, float gain = 0.5f) const;
+
+        static bool HasAVX2();
+        // Benchmarks turn the AVX2 path off to compare; on by default where supported
+        static void SetSIMDEnabled(bool enabled);
+        static bool IsSIMDEnabled();
+
+    private:
+        alignas(32) int32_t m_perm[512];
+    };
+
+} // namespace Klein
+
+#endif // SIMPLEXNOISE_H
@@ -0,0 +1,80 @@
+#ifndef TERRAINGENERATOR_H
+#define TERRAINGENERATOR_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "SimplexNoise.h"
+#include "VoxelChunk.h"
+
+namespace Klein {
+
+    class VoxelWorld;
+
+    // Block types placed by TerrainGenerator
+    namespace TerrainBlock {
+        constexpr BlockID Grass = 1;
+        constexpr BlockID Dirt = 2;
+        constexpr BlockID Stone = 3;
+        constexpr BlockID Sand = 4;
+        constexpr BlockID Water = 5;
+        constexpr BlockID Snow = 6;
+    }
+
+    // Fills VoxelChunks with terrain from simplex noise.
+    //
+    // Two low-frequency climate fields (temperature, humidity) give each column a
+    // weight for every biome; heights and overhang strength are blended by those
+    // weights, so biomes fade into each other instead of meeting at cliffs. A 3D
+    // density pass adds overhangs and carves caves. All noise goes through
+    // SimplexNoise batches. GenerateChunk is const and thread-safe.
+    class TerrainGenerator {
+    public:
+        struct Settings {
+            uint32_t seed = 1337;
+            int seaLevel = 36;
+            int snowLine = 92;
+            float climateScale = 0.0025f;      // Biome size; smaller = larger biomes
+            float caveThreshold = 0.07f;       // Width of cave tunnels, 0 disables caves
+        };
+
+        enum class Biome { Plains, Hills, Mountains, Desert, Count };
+
+        TerrainGenerator() : TerrainGenerator(Settings()) {}
+        explicit TerrainGenerator(const Settings& settings);
+
+        VoxelChunk GenerateChunk(const glm::ivec3& chunkCoord) const;
+
+        // Generates [minChunk, maxChunk) across the job pool and hands the chunks to
+        // the world. Returns how many were non-empty. Update thread
+        size_t GenerateRegion(VoxelWorld& world, const glm::ivec3& minChunk, const glm::ivec3& maxChunk) const;
+
+        // Colours for the TerrainBlock types
+        static void ApplyDefaultColors(VoxelWorld& world);
+
+        const Settings& GetSettings() const { return m_settings; }
+
+    private:
+        static constexpr int kSize = VoxelChunk::kSize;
+        static constexpr int kBiomeCount = (int)Biome::Count;
+
+        // Per-column results of the 2D pass
+        struct ColumnData {
+            float height[kSize * kSize];
+            float overhang[kSize * kSize];
+            Biome biome[kSize * kSize];        // Strongest weight; picks surface blocks
+        };
+
+        void ComputeColumns(int originX, int originZ, ColumnData& out) const;
+
+        Settings m_settings;
+        SimplexNoise m_temperature;
+        SimplexNoise m_humidity;
+        SimplexNoise m_height;
+        SimplexNoise m_detail;
+        SimplexNoise m_caves;
+    };
+
+} // namespace Klein
+
+#endif // TERRAINGENERATOR_H
@@ -0,0 +1,66 @@
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+namespace Klein {
+
+    // CPU-side image with its full mip chain, laid out for upload
+    struct TextureData {
+        struct Level {
+            size_t offset;     // Into 'data'
+            size_t size;
+            int width;
+            int height;
+        };
+
+        int width = 0;
+        int height = 0;
+        int channels = 4;
+        GLenum internalFormat = GL_RGBA8;
+        GLenum format = GL_RGBA;           // Uncompressed data only
+        bool compressed = false;
+        bool generateMips = false;         // Single uncompressed level, mips built on upload
+        std::vector<Level> levels;
+        std::vector<unsigned char> data;
+    };
+
+    // Reads block-compressed textures with prebuilt mip chains from KTX2 and DDS files.
+    //
+    // Supported: BC1/BC3/BC4/BC5/BC7, ETC2 and ASTC 4x4 (KTX2), plus 8-bit RGBA.
+    // KTX2 supercompression (Basis Universal, zstd) isn't. Files are uploaded as
+    // stored, so author them with OpenGL's bottom-left origin. BC1-BC5 can be
+    // decoded to RGBA8 on the CPU for drivers that lack the format.
+    class TextureLoader {
+    public:
+        // True for .ktx2 and .dds paths
+        static bool IsContainerFile(const std::string& path);
+
+        static bool Load(const std::string& path, TextureData& out);
+        // Containers above, anything else through stb_image as a single level with
+        // generateMips set
+        static bool LoadAny(const std::string& path, TextureData& out);
+        static void FromPixels(const unsigned char* pixels, int width, int height, int channels,
+                               TextureData& out);
+        static bool LoadKTX2(const std::string& path, TextureData& out);
+        static bool LoadDDS(const std::string& path, TextureData& out);
+
+        // Needs a current context; uncompressed formats are always supported
+        static bool IsFormatSupported(GLenum internalFormat);
+
+        // glTexStorage2D (GL 4.2 or ARB_texture_storage); needs a current context
+        static bool HasImmutableStorage();
+
+        // Levels in a full chain down to 1x1
+        static int FullMipCount(int width, int height);
+
+        // Replaces BC1-BC5 data with RGBA8, mip chain included. False for other formats
+        static bool Decompress(TextureData& data);
+    };
+
+} // namespace Klein
+
+#endif // TEXTURELOADER_H
@@ -0,0 +1,116 @@
+#ifndef TEXTURESTREAMER_H
+#define TEXTURESTREAMER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+#include "JobSystem.h"
+#include "Mesh.h"
+
+namespace Klein {
+
+    // Loads textures in the background and keeps only the mips that are needed resident.
+    //
+    // Images are decoded (and given a CPU-built mip chain) on job workers. The render
+    // thread then uploads them through a ring of pixel buffer objects, a few megabytes
+    // per frame. Each texture first gets its small mip tail; larger mips follow once the
+    // renderer reports the texture's on-screen size. Growing a texture re-creates it with
+    // more levels and swaps it in when complete. When resident memory would pass the
+    // budget, the least recently seen textures drop back to their tail.
+    class TextureStreamer {
+    public:
+        static TextureStreamer& Get();
+
+        // Returns immediately; the texture is IsReady() once its tail is resident.
+        // Safe to call from any thread. Textures are shared per path
+        std::shared_ptr<Texture> Load(const std::string& path, Texture::Type type = Texture::Type::Diffuse);
+
+        // Render thread, once per frame: accepts decoded images, updates residency and
+        // spends the upload budget
+        void Update();
+        // Render thread; waits for outstanding decodes and frees GL objects
+        void Shutdown();
+
+        void SetMemoryBudget(size_t bytes) { m_memoryBudget = bytes; }
+        size_t GetMemoryBudget() const { return m_memoryBudget; }
+        // Capped at the staging buffer size
+        void SetUploadBudget(size_t bytes) { m_uploadBudget = bytes; }
+
+        size_t GetResidentBytes() const { return m_committedBytes; }
+        size_t GetUploadedBytes() const { return m_uploadedBytes; }   // Last Update
+        size_t GetPendingCount() const;            // Render thread
+
+    private:
+        struct Entry {
+            std::weak_ptr<Texture> texture;
+            std::unique_ptr<TextureData> data;
+            int residentBase = -1;         // First source level in the live texture; -1 = none
+            int committedBase = -1;        // Same, counting the upload in flight
+            int tailBase = 0;              // Smallest levels, loaded first and never evicted
+            uint64_t lastUsed = 0;
+            bool expired = false;          // Set by RemoveExpired, which frees the entry
+        };
+
+        // Fills a new GL texture holding source levels [base, levelCount), smallest level first
+        struct Upload {
+            Entry* entry;
+            GLuint texture;
+            int base;
+            int level;
+            int nextUnit = 0;              // Row (or row of blocks) within 'level'
+        };
+
+        struct Decoded {
+            std::weak_ptr<Texture> texture;
+            std::unique_ptr<TextureData> data;
+        };
+
+        TextureStreamer() = default;
+
+        void AcceptDecoded();
+        void UpdateResidency();
+        void ProcessUploads();
+        void RemoveExpired();
+
+        void QueueUpload(Entry& entry, int base);
+        bool MakeRoom(size_t bytes, const Entry* keep);
+        size_t BytesFrom(const Entry& entry, int base) const;
+        bool HasUpload(const Entry* entry) const;
+        void CreateStaging();
+
+        static void BuildMipChain(TextureData& data);
+
+        // Shared with Load() on other threads
+        mutable std::mutex m_mutex;
+        std::unordered_map<std::string, std::weak_ptr<Texture>> m_cache;
+        std::vector<Decoded> m_decoded;
+        size_t m_decoding = 0;
+        JobCounter m_decodeJobs;
+
+        // Render thread only
+        std::vector<std::unique_ptr<Entry>> m_entries;
+        std::deque<Upload> m_uploads;
+        uint64_t m_frame = 0;
+        size_t m_committedBytes = 0;
+        size_t m_uploadedBytes = 0;
+        size_t m_memoryBudget = 256ull * 1024 * 1024;
+        size_t m_uploadBudget = kStagingSize;
+
+        // Staging ring; a fence guards each buffer until the GPU has read it
+        static constexpr int kStagingCount = 3;
+        static constexpr size_t kStagingSize = 4 * 1024 * 1024;
+        static constexpr int kTailSize = 64;
+        GLuint m_staging[kStagingCount] = {};
+        GLsync m_stagingFences[kStagingCount] = {};
+        int m_stagingIndex = 0;
+    };
+
+} // namespace Klein
+
+#endif // TEXTURESTREAMER_H
@@ -0,0 +1,90 @@
+#ifndef UNIFORMBUFFER_H
+#define UNIFORMBUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+namespace Klein {
+
+    // Fixed binding points shared by every program (attached by Shader after linking)
+    namespace UniformBinding {
+        constexpr GLuint Camera = 0;
+        constexpr GLuint Lights = 1;
+        constexpr GLuint Material = 2;
+        constexpr GLuint Shadow = 3;
+    }
+
+    namespace TextureSlot {
+        constexpr GLuint Albedo = 0;
+        constexpr GLuint Normal = 1;
+        constexpr GLuint Scratch = 3;              // Never sampled; binds that only query or allocate
+        constexpr GLuint LightData = 4;
+        constexpr GLuint ClusterGrid = 5;
+        constexpr GLuint LightIndices = 6;
+        constexpr GLuint ShadowMap = 7;
+        constexpr GLuint MaterialArrays = 8;       // First of MaterialTable::kMaxArrays units
+    }
+
+    // ===== std140 block layouts, mirrored in the GLSL sources =====
+    struct CameraBlock {
+        glm::mat4 viewProjection{1.0f};
+        glm::mat4 view{1.0f};
+        glm::mat4 projection{1.0f};
+        glm::vec3 position{0.0f};
+        float _pad0 = 0.0f;
+    };
+
+    // Light data itself lives in ClusteredLighting's texture buffers
+    struct LightsBlock {
+        glm::uvec4 clusterCounts{0u};   // x, y, z cluster counts, w = 1 for linear depth slices
+        glm::vec4 clusterParams{0.0f};  // xy = tile size in pixels, z = depth slice scale, w = depth slice bias
+        int dirLightCount = 0;
+        int pointLightCount = 0;
+        int _pad0[2] = {0, 0};
+    };
+
+    struct MaterialBlock {
+        glm::vec3 albedo{1.0f};
+        float metallic = 0.0f;
+        float roughness = 0.5f;
+        float ao = 1.0f;
+        int useAlbedoMap = 0;
+        int _pad0 = 0;
+    };
+
+    constexpr int kShadowCascadeCount = 4;
+
+    struct ShadowBlock {
+        glm::mat4 cascadeViewProj[kShadowCascadeCount];
+        glm::vec4 cascadeSplits{0.0f};  // View depth at the far end of each cascade
+        glm::vec4 params{0.0f};         // x = enabled, y = depth bias, z = texel size
+    };
+
+    static_assert(sizeof(CameraBlock) == 208, "CameraBlock must match std140 layout");
+    static_assert(sizeof(LightsBlock) == 48, "LightsBlock must match std140 layout");
+    static_assert(sizeof(MaterialBlock) == 32, "MaterialBlock must match std140 layout");
+    static_assert(sizeof(ShadowBlock) == 64 * kShadowCascadeCount + 32, "ShadowBlock must match std140 layout");
+
+    // Thin wrapper around a GL_UNIFORM_BUFFER
+    class UniformBuffer {
+    public:
+        explicit UniformBuffer(GLsizeiptr size);
+        ~UniformBuffer();
+
+        UniformBuffer(const UniformBuffer&) = delete;
+        UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+        void SetData(const void* data, GLsizeiptr size, GLintptr offset = 0);
+        void Bind(GLuint binding) const;
+
+        GLuint GetID() const { return m_buffer; }
+        GLsizeiptr GetSize() const { return m_size; }
+
+    private:
+        GLuint m_buffer = 0;
+        GLsizeiptr m_size;
+    };
+
+} // namespace Klein
+
+#endif // UNIFORMBUFFER_H
@@ -0,0 +1,72 @@
+#ifndef VOXELCHUNK_H
+#define VOXELCHUNK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Klein {
+
+    using BlockID = uint16_t;
+    constexpr BlockID kAirBlock = 0;
+
+    // Cubic block volume with palette compression.
+    //
+    // Each chunk keeps a palette of the block types it contains and stores one
+    // palette index per block, packed at 0, 1, 2, 4, 8 or 16 bits so indices never
+    // straddle a word. A chunk of a single type (all air, all stone) costs no index
+    // storage at all; typical terrain needs 2-4 bits per block instead of 16.
+    class VoxelChunk {
+    public:
+        static constexpr int kSize = 32;
+        static constexpr int kVolume = kSize * kSize * kSize;
+
+        // Layout shared with Decode/Assign: x fastest, then z, then y
+        static constexpr int Index(int x, int y, int z) { return x + z * kSize + y * kSize * kSize; }
+
+        explicit VoxelChunk(BlockID fill = kAirBlock);
+
+        BlockID Get(int x, int y, int z) const { return m_palette[ReadIndex(Index(x, y, z))]; }
+        void Set(int x, int y, int z, BlockID block);
+
+        // Bulk access through a flat array of kVolume blocks in Index() order
+        void Decode(BlockID* out) const;
+        void Assign(const BlockID* blocks);
+
+        void Fill(BlockID block);
+
+        // Palette and packed indices as stored, little-endian. Deserialize validates
+        // the data and leaves the chunk untouched on failure
+        void Serialize(std::vector<uint8_t>& out) const;
+        bool Deserialize(const uint8_t* data, size_t size);
+
+        bool IsUniform() const { return m_bitsPerBlock == 0; }
+        bool IsEmpty() const { return IsUniform() && m_palette[0] == kAirBlock; }
+
+        uint32_t GetBitsPerBlock() const { return m_bitsPerBlock; }
+        size_t GetPaletteSize() const { return m_palette.size(); }
+        size_t GetMemoryUsage() const;
+
+    private:
+        uint32_t ReadIndex(int block) const {
+            if (m_bitsPerBlock == 0) return 0;
+            uint32_t bit = (uint32_t)block * m_bitsPerBlock;
+            return (uint32_t)(m_bits[bit >> 6] >> (bit & 63)) & ((1u << m_bitsPerBlock) - 1);
+        }
+        void WriteIndex(int block, uint32_t index);
+
+        // Palette slot for 'block', adding it (and widening the indices) if needed
+        uint32_t FindOrAddEntry(BlockID block);
+        void Repack(uint32_t bitsPerBlock);
+
+        static uint32_t BitsFor(size_t paletteSize);
+
+        std::vector<BlockID> m_palette;
+        std::vector<uint32_t> m_counts;        // Blocks using each entry; 0 = free slot
+        std::vector<uint64_t> m_bits;
+        uint32_t m_bitsPerBlock = 0;
+    };
+
+} // namespace Klein
+
+#endif // VOXELCHUNK_H
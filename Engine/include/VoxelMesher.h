@@ -0,0 +1,40 @@
+#ifndef VOXELMESHER_H
+#define VOXELMESHER_H
+
+#include <memory>
+#include <vector>
+#include "Mesh.h"
+#include "VoxelChunk.h"
+
+namespace Klein {
+
+    // Greedy mesher for VoxelChunk.
+    //
+    // Faces between two solid blocks are dropped, then each slice of the remaining
+    // faces is merged into the fewest rectangles of one block type (Lysenko's greedy
+    // meshing), so flat terrain becomes a handful of quads instead of two triangles
+    // per block face. Block colours come from a one-row palette texture: every quad
+    // samples the texel of its block type (see TexCoordFor).
+    class VoxelMesher {
+    public:
+        // A chunk plus its six face neighbours (null = air), read-only while meshing
+        struct Neighborhood {
+            std::shared_ptr<const VoxelChunk> center;
+            std::shared_ptr<const VoxelChunk> neighbors[6];    // -X, +X, -Y, +Y, -Z, +Z
+        };
+
+        static constexpr int kPaletteWidth = 256;   // Block types with their own colour
+
+        // Vertex positions are in chunk space, 0..VoxelChunk::kSize
+        static void Build(const Neighborhood& input, std::vector<Vertex>& outVertices,
+                          std::vector<unsigned int>& outIndices);
+
+        // Null when the chunk has no visible faces
+        static std::shared_ptr<Mesh> BuildMesh(const Neighborhood& input);
+
+        static glm::vec2 TexCoordFor(BlockID block);
+    };
+
+} // namespace Klein
+
+#endif // VOXELMESHER_H
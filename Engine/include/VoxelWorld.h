@@ -0,0 +1,128 @@
+#ifndef VOXELWORLD_H
+#define VOXELWORLD_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Entity.h"
+#include "JobSystem.h"
+#include "VoxelChunk.h"
+#include "VoxelMesher.h"
+
+namespace Klein {
+
+    class Scene;
+    class Material;
+    class RegionStore;
+    class Texture;
+
+    // Block world made of VoxelChunks, each drawn as one greedy-meshed entity.
+    //
+    // Edits mark the chunk (and neighbours across a border) dirty; Update() meshes
+    // dirty chunks on the job system, nearest to the focus point first, and swaps
+    // finished meshes into the chunk entities. Chunks are copy-on-write, so meshing
+    // jobs (and saves) read a snapshot while the update thread keeps editing.
+    // Update thread only.
+    class VoxelWorld {
+    public:
+        explicit VoxelWorld(Scene* scene);
+        ~VoxelWorld();
+
+        VoxelWorld(const VoxelWorld&) = delete;
+        VoxelWorld& operator=(const VoxelWorld&) = delete;
+
+        // Air outside loaded chunks
+        BlockID GetBlock(const glm::ivec3& position) const;
+        void SetBlock(const glm::ivec3& position, BlockID block);
+
+        // Replaces a whole chunk; the fast path for generators
+        void SetChunk(const glm::ivec3& chunkCoord, VoxelChunk chunk);
+        void RemoveChunk(const glm::ivec3& chunkCoord);
+        const VoxelChunk* GetChunk(const glm::ivec3& chunkCoord) const;
+
+        // Colour of a block type, for ids below VoxelMesher::kPaletteWidth
+        void SetBlockColor(BlockID block, const glm::vec3& color);
+
+        // Queues snapshots of chunks edited since their last save on the store's
+        // background thread; returns how many. Chunks count as saved once the store
+        // reports their snapshot written (picked up by the next Save), and failed
+        // ones are queued again
+        size_t Save(RegionStore& store);
+        // Loads a previously saved chunk; false if it was never saved
+        bool LoadChunk(RegionStore& store, const glm::ivec3& chunkCoord);
+
+        // Chunks closest to this point are meshed first
+        void SetFocus(const glm::vec3& position) { m_focus = position; }
+
+        // Starts meshing dirty chunks and installs meshes that finished. Call once per frame
+        void Update();
+        // Blocks until every dirty chunk has its mesh (loading screens, tests)
+        void Flush();
+
+        static glm::ivec3 ToChunkCoord(const glm::ivec3& position);
+
+        size_t GetChunkCount() const { return m_chunks.size(); }
+        size_t GetPendingMeshCount() const { return m_dirty.size() + m_inFlight; }
+        size_t GetMemoryUsage() const;
+        const std::shared_ptr<Material>& GetMaterial() const { return m_material; }
+
+    private:
+        struct ChunkCoordHash {
+            size_t operator()(const glm::ivec3& c) const {
+                return ((size_t)(uint32_t)c.x * 73856093u) ^ ((size_t)(uint32_t)c.y * 19349663u) ^
+                       ((size_t)(uint32_t)c.z * 83492791u);
+            }
+        };
+
+        struct ChunkSlot {
+            std::shared_ptr<VoxelChunk> chunk;
+            Entity entity;
+            // New on every edit, from a world-wide counter so a chunk removed and added
+            // again never reuses one; meshes built from an older version are dropped
+            uint64_t version = 0;
+            uint64_t meshingVersion = 0;   // Version the chunk's running mesh job started from; 0 = none
+            bool dirty = false;
+            bool unsaved = false;          // Not known to be on disk in its current state
+            // Snapshot queued by Save() whose result hasn't come back yet
+            std::shared_ptr<const VoxelChunk> saving;
+        };
+
+        struct MeshResult {
+            glm::ivec3 coord;
+            uint64_t version;
+            std::shared_ptr<Mesh> mesh;
+        };
+
+        // Chunk to edit, cloned first if a meshing job still holds a snapshot of it
+        VoxelChunk& Writable(ChunkSlot& slot);
+        void MarkDirty(const glm::ivec3& chunkCoord);
+        void DispatchMeshing();
+        void InstallResults();
+        void InstallMesh(ChunkSlot& slot, const glm::ivec3& coord, std::shared_ptr<Mesh> mesh);
+        void UpdatePalette();
+
+        Scene* m_scene;
+        std::shared_ptr<Material> m_material;
+        std::vector<glm::vec3> m_colors;
+        bool m_colorsDirty = true;
+
+        std::unordered_map<glm::ivec3, ChunkSlot, ChunkCoordHash> m_chunks;
+        std::vector<glm::ivec3> m_dirty;
+        uint64_t m_nextVersion = 0;
+        glm::vec3 m_focus{0.0f};
+
+        JobCounter m_jobs;
+        size_t m_inFlight = 0;
+        std::mutex m_resultsMutex;
+        std::vector<MeshResult> m_results;
+
+        // Caps the queue so edits made later don't wait behind the whole world
+        static constexpr size_t kMaxJobsInFlight = 64;
+    };
+
+} // namespace Klein
+
+#endif // VOXELWORLD_H
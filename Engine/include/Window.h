@@ -8,17 +8,23 @@
 
 namespace Klein {
 
+    // Runs without a display. Simulation has no GL context at all; Offscreen gets
+    // one through EGL (or OSMesa as a software fallback) and renders into an FBO
+    enum class HeadlessMode { Off, Simulation, Offscreen };
+
     struct WindowProps {
         std::string title;
         int width;
         int height;
         bool vsync;
+        HeadlessMode headless;
 
         WindowProps(const std::string& title = "Klein Engine",
                    int width = 1280,
                    int height = 720,
-                   bool vsync = true)
-            : title(title), width(width), height(height), vsync(vsync) {}
+                   bool vsync = true,
+                   HeadlessMode headless = HeadlessMode::Off)
+            : title(title), width(width), height(height), vsync(vsync), headless(headless) {}
     };
 
     class Window {
@@ -43,8 +49,13 @@ namespace Klein {
         
         GLFWwindow* GetNativeWindow() const { return m_window; }
 
+        HeadlessMode GetHeadlessMode() const { return m_headless; }
+        bool HasContext() const { return m_headless != HeadlessMode::Simulation; }
+
         void SetVSync(bool enabled);
         bool IsVSync() const { return m_vsync; }
+        // Of the primary monitor when the window was created; 0 if unknown
+        double GetRefreshRate() const { return m_refreshRate; }
 
         // Event callbacks
         void SetResizeCallback(ResizeCallback callback) { m_resizeCallback = callback; }
@@ -63,6 +74,7 @@ namespace Klein {
         void Init();
         void Shutdown();
         void SetupCallbacks();
+        bool CreateOffscreenTarget();
 
 
         static void FramebufferSizeCallbackImpl(GLFWwindow* window, int width, int height);
@@ -77,6 +89,13 @@ namespace Klein {
         int m_width;
         int m_height;
         bool m_vsync;
+        double m_refreshRate = 0.0;
+        HeadlessMode m_headless;
+
+        // Offscreen mode's render target, bound for the context's lifetime
+        GLuint m_offscreenFBO = 0;
+        GLuint m_offscreenColor = 0;
+        GLuint m_offscreenDepth = 0;
 
         // Callbacks
         ResizeCallback m_resizeCallback;
@@ -2,9 +2,13 @@
 #include "Logger.h"
 #include "AssetManager.h"
 #include "Shader.h"
+#include "ProgramBinaryCache.h"
+#include "Profiler.h"
 #include <GLFW/glfw3.h>
 
 namespace Klein {
+    App* App::m_AppInstance = nullptr;
+
     App::App() {
         Init();
         m_AppInstance = this;
@@ -12,7 +16,6 @@ namespace Klein {
 
     App::~App() {
         Shutdown();
-        OnShutdown();
     }
 
 
@@ -22,11 +25,25 @@ namespace Klein {
         WindowProps props(
             appWindowName ? appWindowName : appDefaultName,
             appWindowX,
-            appWindowY
+            appWindowY,
+            true,
+            appHeadless
         );
         m_window = std::make_unique<Window>(props);
+        double frameRate = appTargetFrameRate;
+        if (frameRate < 0.0) {
+            frameRate = appHeadless != HeadlessMode::Off ? appHeadlessFrameRate : 0.0;
+        }
+        m_framePacer.SetTargetFrameRate(frameRate);
 
+        // Create renderer; simulation-only runs have no context to render with
+        if (m_window->HasContext()) {
+            // Shaders compiled by the renderer go through the binary cache
+            ProgramBinaryCache::Get().SetDirectory(appShaderCacheDirectory ? appShaderCacheDirectory : "");
 
+            m_renderer = std::make_unique<Renderer>();
+            m_renderer->Init();
+        }
 
         // Setup default scene
         m_activeScene = std::make_shared<Scene>("Default Scene");
@@ -35,11 +52,11 @@ namespace Klein {
     }
 
     void App::Shutdown() {
-        OnShutdown();
-        
         m_activeScene.reset();
-        m_renderer->Shutdown();
-        m_renderer.reset();
+        if (m_renderer) {
+            m_renderer->Shutdown();
+            m_renderer.reset();
+        }
         m_window.reset();
 
         KleinLogger::Logger::EngineLog("Application shutdown complete");
@@ -48,22 +65,50 @@ namespace Klein {
     void App::Run() {
         OnStart();
 
+        if (appRenderThread && m_renderer) {
+            m_renderThread = std::make_unique<RenderThread>(m_window.get(), m_renderer.get());
+            m_renderThread->SetUICallback([this] { OnUI(); });
+            m_renderThread->Start();
+        }
+
+        KLEIN_PROFILE_THREAD("Main");
         while (m_running && !m_window->ShouldClose()) {
-            float currentFrame = (float)glfwGetTime();
-            s_deltaTime = currentFrame - s_lastFrame;
-            s_lastFrame = currentFrame;
+            if (appFrameCount != 0 && m_frameIndex >= appFrameCount) break;
+            m_frameIndex++;
+
+            KLEIN_PROFILE_FRAME();
+            KLEIN_PROFILE_SCOPE("App::Frame");
+
+            // Waits out the frame rate cap; vsync can be toggled at any time
+            m_framePacer.SetRefreshRate(m_window->IsVSync() ? m_window->GetRefreshRate() : 0.0);
+            s_deltaTime = m_framePacer.Tick();
 
             // Poll input
             m_window->PollEvents();
 
             // User update
-            OnUpdate(s_deltaTime);
+            {
+                KLEIN_PROFILE_SCOPE("App::OnUpdate");
+                OnUpdate(s_deltaTime);
+            }
 
             // Update scene (physics, scripts, etc.)
             if (m_activeScene) {
                 m_activeScene->OnUpdate(s_deltaTime);
             }
 
+            if (m_renderThread) {
+                // Hand the frame over; drawn while the next one updates
+                FrameSnapshot& snapshot = m_renderThread->BeginFrame();
+                if (m_activeScene) {
+                    m_renderer->ExtractFrame(m_activeScene.get(), m_window->GetAspectRatio(),
+                                             m_window->GetWidth(), m_window->GetHeight(), snapshot);
+                }
+                m_renderThread->SubmitFrame();
+                continue;
+            }
+            if (!m_renderer) continue;
+
             // Render
             m_renderer->Clear();
             if (m_activeScene) {
@@ -71,11 +116,26 @@ namespace Klein {
             }
 
             // UI pass
-            OnUI();
+            {
+                KLEIN_PROFILE_SCOPE("App::OnUI");
+                OnUI();
+            }
 
             // Swap buffers
             m_window->SwapBuffers();
         }
+
+        if (m_renderThread) {
+            m_renderThread->Stop();
+            m_renderThread.reset();
+        }
+
+        // Here rather than in ~App, where the derived app's members are already gone
+        OnShutdown();
+
+        // A capture cut short by the loop ending still gets written
+        Profiler::Get().FinishCapture();
+        m_framePacer.LogReport();
     }
 
     void App::SetScene(std::shared_ptr<Scene> scene) {
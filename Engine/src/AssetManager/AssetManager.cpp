@@ -3,6 +3,7 @@
 //
 
 #include "AssetManager.h"
+#include "Profiler.h"
 #include <iostream>
 
 namespace Klein
@@ -15,6 +16,7 @@ namespace Klein
 
     const aiScene* AssetManager::LoadModel(const std::string& path)
     {
+        KLEIN_PROFILE_SCOPE("AssetManager::LoadModel");
         if (m_modelCache.contains(path))
             return m_modelCache[path];
 
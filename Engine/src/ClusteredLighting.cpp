@@ -0,0 +1,236 @@
+#include "ClusteredLighting.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Klein {
+
+    // ===== TexelBuffer =====
+    void ClusteredLighting::TexelBuffer::Create(GLenum format) {
+        capacity = 256;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    void ClusteredLighting::TexelBuffer::Destroy() {
+        glDeleteTextures(1, &texture);
+        glDeleteBuffers(1, &buffer);
+        texture = buffer = 0;
+    }
+
+    void ClusteredLighting::TexelBuffer::Upload(const void* data, GLsizeiptr size) {
+        if (size == 0) return;
+
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        if (size > capacity) {
+            // Grow geometrically so a rising light count doesn't reallocate every frame
+            while (capacity < size) capacity *= 2;
+            glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+        }
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // ===== ClusteredLighting =====
+    ClusteredLighting::ClusteredLighting()
+        : m_grid(kClusterCount)
+        , m_sliceIndices(kClustersZ)
+    {
+        m_lightData.Create(GL_RGBA32F);
+        m_clusterGrid.Create(GL_RG32UI);
+        m_lightIndices.Create(GL_R32UI);
+    }
+
+    ClusteredLighting::~ClusteredLighting() {
+        m_lightData.Destroy();
+        m_clusterGrid.Destroy();
+        m_lightIndices.Destroy();
+    }
+
+    uint32_t ClusteredLighting::DepthSlice(float viewDepth) const {
+        float sliceDepth = m_linearSlices ? viewDepth : std::log(std::max(viewDepth, kMinSliceDepth));
+        float slice = std::floor(sliceDepth * m_sliceScale + m_sliceBias);
+        return (uint32_t)std::clamp(slice, 0.0f, (float)(kClustersZ - 1));
+    }
+
+    void ClusteredLighting::Update(const std::vector<DirectionalLight>& dirLights,
+                                   const std::vector<PointLight>& pointLights,
+                                   const glm::mat4& view, const glm::mat4& projection,
+                                   float nearClip, float farClip,
+                                   int viewportWidth, int viewportHeight) {
+        m_dirLightCount = (uint32_t)dirLights.size();
+        m_pointLightCount = (uint32_t)pointLights.size();
+
+        // Exponential depth slicing for perspective views: slice = log(depth) * scale + bias.
+        // Orthographic views (w row of 0, 0, 0, 1) have no perspective to follow, and
+        // their near plane may be at or behind the camera, so they slice linearly
+        m_linearSlices = projection[2][3] == 0.0f;
+        if (m_linearSlices) {
+            float range = std::max(farClip - nearClip, kMinSliceDepth);
+            m_sliceScale = (float)kClustersZ / range;
+            m_sliceBias = -nearClip * m_sliceScale;
+        } else {
+            nearClip = std::max(nearClip, kMinSliceDepth);
+            farClip = std::max(farClip, nearClip * 2.0f);
+            float logRatio = std::log(farClip / nearClip);
+            m_sliceScale = (float)kClustersZ / logRatio;
+            m_sliceBias = -(float)kClustersZ * std::log(nearClip) / logRatio;
+        }
+        m_tileSize = glm::vec2(
+            std::ceil((float)std::max(viewportWidth, 1) / kClustersX),
+            std::ceil((float)std::max(viewportHeight, 1) / kClustersY)
+        );
+
+        // Light data: directional lights first, then point lights
+        m_lightTexels.resize((m_dirLightCount + m_pointLightCount) * 2);
+        for (uint32_t i = 0; i < m_dirLightCount; i++) {
+            const auto& light = dirLights[i];
+            m_lightTexels[i * 2 + 0] = glm::vec4(light.direction, 0.0f);
+            m_lightTexels[i * 2 + 1] = glm::vec4(light.color, light.intensity);
+        }
+
+        // Screen tile and depth slice bounds per point light
+        m_bounds.resize(m_pointLightCount);
+        JobSystem::Get().ParallelFor(m_pointLightCount, 64, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const auto& light = pointLights[i];
+                size_t texel = (m_dirLightCount + i) * 2;
+                m_lightTexels[texel + 0] = glm::vec4(light.position, light.range);
+                m_lightTexels[texel + 1] = glm::vec4(light.color, light.intensity);
+
+                LightBounds& bounds = m_bounds[i];
+                bounds.visible = false;
+
+                glm::vec3 center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+                float radius = light.range;
+                float depthMin = -center.z - radius;
+                float depthMax = -center.z + radius;
+                if (depthMax < nearClip || depthMin > farClip) continue;
+
+                bounds.minZ = DepthSlice(std::max(depthMin, nearClip));
+                bounds.maxZ = DepthSlice(std::min(depthMax, farClip));
+
+                if (depthMin <= nearClip && !m_linearSlices) {
+                    // Sphere crosses the near plane, its projection is unbounded
+                    bounds.minX = 0; bounds.maxX = kClustersX - 1;
+                    bounds.minY = 0; bounds.maxY = kClustersY - 1;
+                    bounds.visible = true;
+                    continue;
+                }
+
+                // Project the sphere's view-space box, which contains its projection
+                glm::vec2 ndcMin(1e30f), ndcMax(-1e30f);
+                for (int corner = 0; corner < 8; corner++) {
+                    glm::vec3 offset(
+                        (corner & 1) ? radius : -radius,
+                        (corner & 2) ? radius : -radius,
+                        (corner & 4) ? radius : -radius
+                    );
+                    glm::vec4 clip = projection * glm::vec4(center + offset, 1.0f);
+                    glm::vec2 ndc = glm::vec2(clip.x, clip.y) / clip.w;
+                    ndcMin = glm::min(ndcMin, ndc);
+                    ndcMax = glm::max(ndcMax, ndc);
+                }
+                if (ndcMax.x < -1.0f || ndcMax.y < -1.0f || ndcMin.x > 1.0f || ndcMin.y > 1.0f) continue;
+
+                auto toTile = [&](float ndc, float viewportSize, float tileSize, uint32_t count) {
+                    float pixel = (std::clamp(ndc, -1.0f, 1.0f) * 0.5f + 0.5f) * viewportSize;
+                    return std::min((uint32_t)(pixel / tileSize), count - 1);
+                };
+                bounds.minX = toTile(ndcMin.x, (float)viewportWidth, m_tileSize.x, kClustersX);
+                bounds.maxX = toTile(ndcMax.x, (float)viewportWidth, m_tileSize.x, kClustersX);
+                bounds.minY = toTile(ndcMin.y, (float)viewportHeight, m_tileSize.y, kClustersY);
+                bounds.maxY = toTile(ndcMax.y, (float)viewportHeight, m_tileSize.y, kClustersY);
+                bounds.visible = true;
+            }
+        });
+
+        // Each depth slice owns its clusters, so slices can be filled independently
+        constexpr uint32_t kSliceClusters = kClustersX * kClustersY;
+        JobSystem::Get().ParallelFor(kClustersZ, 1, [&](size_t begin, size_t end) {
+            uint32_t counts[kSliceClusters];
+
+            for (size_t slice = begin; slice < end; slice++) {
+                std::memset(counts, 0, sizeof(counts));
+
+                for (uint32_t i = 0; i < m_pointLightCount; i++) {
+                    const LightBounds& b = m_bounds[i];
+                    if (!b.visible || slice < b.minZ || slice > b.maxZ) continue;
+                    for (uint32_t y = b.minY; y <= b.maxY; y++) {
+                        for (uint32_t x = b.minX; x <= b.maxX; x++) {
+                            counts[x + y * kClustersX]++;
+                        }
+                    }
+                }
+
+                glm::uvec2* grid = &m_grid[slice * kSliceClusters];
+                uint32_t total = 0;
+                for (uint32_t c = 0; c < kSliceClusters; c++) {
+                    grid[c] = glm::uvec2(total, 0);
+                    total += counts[c];
+                }
+
+                auto& indices = m_sliceIndices[slice];
+                indices.resize(total);
+                for (uint32_t i = 0; i < m_pointLightCount; i++) {
+                    const LightBounds& b = m_bounds[i];
+                    if (!b.visible || slice < b.minZ || slice > b.maxZ) continue;
+                    for (uint32_t y = b.minY; y <= b.maxY; y++) {
+                        for (uint32_t x = b.minX; x <= b.maxX; x++) {
+                            glm::uvec2& cell = grid[x + y * kClustersX];
+                            indices[cell.x + cell.y++] = m_dirLightCount + i;
+                        }
+                    }
+                }
+            }
+        });
+
+        // Rebase the per-slice offsets and flatten the index lists
+        uint32_t base = 0;
+        for (uint32_t slice = 0; slice < kClustersZ; slice++) {
+            glm::uvec2* grid = &m_grid[slice * kSliceClusters];
+            for (uint32_t c = 0; c < kSliceClusters; c++) {
+                grid[c].x += base;
+            }
+            base += (uint32_t)m_sliceIndices[slice].size();
+        }
+
+        m_indices.resize(base);
+        base = 0;
+        for (const auto& indices : m_sliceIndices) {
+            std::copy(indices.begin(), indices.end(), m_indices.begin() + base);
+            base += (uint32_t)indices.size();
+        }
+
+        m_lightData.Upload(m_lightTexels.data(), m_lightTexels.size() * sizeof(glm::vec4));
+        m_clusterGrid.Upload(m_grid.data(), m_grid.size() * sizeof(glm::uvec2));
+        m_lightIndices.Upload(m_indices.data(), m_indices.size() * sizeof(uint32_t));
+    }
+
+    void ClusteredLighting::Bind() const {
+        glActiveTexture(GL_TEXTURE0 + TextureSlot::LightData);
+        glBindTexture(GL_TEXTURE_BUFFER, m_lightData.texture);
+        glActiveTexture(GL_TEXTURE0 + TextureSlot::ClusterGrid);
+        glBindTexture(GL_TEXTURE_BUFFER, m_clusterGrid.texture);
+        glActiveTexture(GL_TEXTURE0 + TextureSlot::LightIndices);
+        glBindTexture(GL_TEXTURE_BUFFER, m_lightIndices.texture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void ClusteredLighting::FillBlock(LightsBlock& block) const {
+        block.clusterCounts = glm::uvec4(kClustersX, kClustersY, kClustersZ, m_linearSlices ? 1u : 0u);
+        block.clusterParams = glm::vec4(m_tileSize.x, m_tileSize.y, m_sliceScale, m_sliceBias);
+        block.dirLightCount = (int)m_dirLightCount;
+        block.pointLightCount = (int)m_pointLightCount;
+    }
+
+} // namespace Klein
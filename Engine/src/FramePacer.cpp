@@ -0,0 +1,155 @@
+#include "FramePacer.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <thread>
+
+namespace Klein {
+
+    double FramePacer::Stats::GetPercentileMs(double fraction) const {
+        if (frameCount == 0) return 0.0;
+
+        auto target = (uint64_t)std::ceil(fraction * (double)frameCount);
+        uint64_t seen = 0;
+        for (int i = 0; i < kBucketCount; i++) {
+            seen += buckets[i];
+            if (seen >= target) {
+                return i == kBucketCount - 1 ? maxMs : (i + 1) * kBucketWidth;
+            }
+        }
+        return maxMs;
+    }
+
+    FramePacer::FramePacer() {
+        m_history.fill(0.0);
+    }
+
+    void FramePacer::SetTargetFrameRate(double framesPerSecond) {
+        m_targetFrameRate = std::max(0.0, framesPerSecond);
+    }
+
+    void FramePacer::SetSmoothingWindow(int frames) {
+        m_smoothing = std::clamp(frames, 1, kMaxSmoothing);
+        m_historyNext = 0;
+        m_historyCount = 0;
+    }
+
+    float FramePacer::Tick() {
+        if (m_firstFrame) {
+            m_firstFrame = false;
+            m_lastFrame = Clock::now();
+            return 0.0f;
+        }
+
+        if (m_targetFrameRate > 0.0) {
+            auto interval = std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(1.0 / m_targetFrameRate));
+            WaitUntil(m_lastFrame + interval);
+        }
+
+        Clock::time_point now = Clock::now();
+        double frameSeconds = std::chrono::duration<double>(now - m_lastFrame).count();
+        m_lastFrame = now;
+        Record(frameSeconds);
+
+        // Average of the last few frames, so one late frame doesn't jerk the camera
+        double delta = std::min(frameSeconds, kMaxDelta);
+        m_history[m_historyNext] = delta;
+        m_historyNext = (m_historyNext + 1) % m_smoothing;
+        m_historyCount = std::min(m_historyCount + 1, m_smoothing);
+
+        double sum = 0.0;
+        for (int i = 0; i < m_historyCount; i++) {
+            sum += m_history[i];
+        }
+        m_rawDelta = (float)frameSeconds;
+        m_smoothedDelta = (float)(sum / m_historyCount);
+        return m_smoothedDelta;
+    }
+
+    void FramePacer::WaitUntil(Clock::time_point deadline) {
+        KLEIN_PROFILE_SCOPE("FramePacer::Wait");
+        using Seconds = std::chrono::duration<double>;
+
+        while (true) {
+            double left = Seconds(deadline - Clock::now()).count();
+            double estimate = m_sleepMean + 2.0 * std::sqrt(m_sleepM2 / (double)m_sleepCount);
+            if (left <= estimate) break;
+
+            Clock::time_point start = Clock::now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            double slept = Seconds(Clock::now() - start).count();
+
+            // Past the cap older samples fade, so the estimate follows scheduler changes
+            if (m_sleepCount < kMaxSleepSamples) {
+                m_sleepCount++;
+            } else {
+                m_sleepM2 *= (double)(kMaxSleepSamples - 1) / (double)kMaxSleepSamples;
+            }
+            double diff = slept - m_sleepMean;
+            m_sleepMean += diff / (double)m_sleepCount;
+            m_sleepM2 += diff * (slept - m_sleepMean);
+        }
+
+        // Spin the remainder
+        while (Clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+    }
+
+    void FramePacer::Record(double frameSeconds) {
+        double ms = frameSeconds * 1000.0;
+        if (m_stats.frameCount == 0) {
+            m_stats.minMs = ms;
+            m_stats.maxMs = ms;
+        }
+        m_stats.frameCount++;
+        m_stats.totalMs += ms;
+        m_stats.minMs = std::min(m_stats.minMs, ms);
+        m_stats.maxMs = std::max(m_stats.maxMs, ms);
+
+        int bucket = std::min((int)(ms / Stats::kBucketWidth), Stats::kBucketCount - 1);
+        m_stats.buckets[bucket]++;
+
+        // The slower of the refresh and the cap is the deadline; half an interval of slack
+        double interval = 0.0;
+        if (m_refreshRate > 0.0) interval = 1.0 / m_refreshRate;
+        if (m_targetFrameRate > 0.0) interval = std::max(interval, 1.0 / m_targetFrameRate);
+        if (interval > 0.0 && frameSeconds > interval * 1.5) {
+            m_stats.missedFrames++;
+        }
+    }
+
+    void FramePacer::LogReport() const {
+        const Stats& stats = m_stats;
+        if (stats.frameCount == 0) return;
+
+        KleinLogger::Logger::EngineLog("Frame times over %llu frames: avg %.2f ms, min %.2f, max %.2f, "
+            "p50 %.1f, p95 %.1f, p99 %.1f; %llu missed",
+            (unsigned long long)stats.frameCount, stats.GetAverageMs(), stats.minMs, stats.maxMs,
+            stats.GetPercentileMs(0.50), stats.GetPercentileMs(0.95), stats.GetPercentileMs(0.99),
+            (unsigned long long)stats.missedFrames);
+
+        // 2 ms rows, empty ones skipped
+        constexpr int kRowBuckets = 4;
+        for (int row = 0; row < Stats::kBucketCount; row += kRowBuckets) {
+            uint64_t count = 0;
+            for (int i = row; i < row + kRowBuckets; i++) {
+                count += stats.buckets[i];
+            }
+            if (count == 0) continue;
+
+            std::string bar((size_t)std::ceil(40.0 * (double)count / (double)stats.frameCount), '#');
+            double low = row * Stats::kBucketWidth;
+            if (row + kRowBuckets >= Stats::kBucketCount) {
+                KleinLogger::Logger::EngineLog("  %3.0f+    ms %8llu %s", low, (unsigned long long)count, bar.c_str());
+            } else {
+                KleinLogger::Logger::EngineLog("  %3.0f-%-3.0f ms %8llu %s", low, low + kRowBuckets * Stats::kBucketWidth,
+                    (unsigned long long)count, bar.c_str());
+            }
+        }
+    }
+
+} // namespace Klein
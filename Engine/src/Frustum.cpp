@@ -0,0 +1,43 @@
+#include "Frustum.h"
+
+namespace Klein {
+
+    Frustum::Frustum(const glm::mat4& m) {
+        // Gribb/Hartmann: each plane is the 4th row of the matrix +/- one of the others
+        for (int i = 0; i < 3; i++) {
+            for (int side = 0; side < 2; side++) {
+                glm::vec4& plane = planes[i * 2 + side];
+                float sign = side == 0 ? 1.0f : -1.0f;
+                for (int c = 0; c < 4; c++) {
+                    plane[c] = m[c][3] + sign * m[c][i];
+                }
+                plane /= glm::length(glm::vec3(plane));
+            }
+        }
+    }
+
+    bool Frustum::IntersectsSphere(const glm::vec3& center, float radius) const {
+        for (const auto& plane : planes) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Frustum::IntersectsAABB(const glm::vec3& min, const glm::vec3& max) const {
+        for (const auto& plane : planes) {
+            // Corner furthest along the plane normal
+            glm::vec3 positive(
+                plane.x >= 0.0f ? max.x : min.x,
+                plane.y >= 0.0f ? max.y : min.y,
+                plane.z >= 0.0f ? max.z : min.z
+            );
+            if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+} // namespace Klein
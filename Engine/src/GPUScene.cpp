@@ -0,0 +1,492 @@
+#include "GPUScene.h"
+#include "Mesh.h"
+#include "Frustum.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace Klein {
+
+    static const char* s_cullComputeSrc = R"(
+#version 430 core
+layout(local_size_x = 64) in;
+
+struct ObjectData {
+    mat4 model;
+    vec4 boundsSphere;
+    vec4 albedoMetallic;
+    vec4 roughnessAo;
+    uvec4 info;  // x = mesh, y = flags, z = LOD bias bits, w = alive
+};
+
+struct MeshEntry {
+    uvec4 lods[4];  // index count, first index, base vertex
+    vec4 lodScreenSizes;
+    uvec4 info;     // x = LOD count
+};
+
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout(std430, binding = 0) readonly buffer Objects { ObjectData objects[]; };
+layout(std430, binding = 1) readonly buffer Meshes { MeshEntry meshes[]; };
+layout(std430, binding = 2) writeonly buffer Commands { DrawCommand commands[]; };
+
+uniform vec4 u_Planes[6];
+uniform vec3 u_LodOrigin;
+uniform float u_LodProjScale;
+uniform int u_LodPerspective;
+uniform uint u_ObjectCount;
+uniform uint u_RequiredFlags;
+
+void main() {
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= u_ObjectCount) return;
+
+    ObjectData object = objects[id];
+    vec3 center = object.boundsSphere.xyz;
+    float radius = object.boundsSphere.w;
+
+    bool visible = object.info.w != 0u && (object.info.y & u_RequiredFlags) == u_RequiredFlags;
+    for (int i = 0; i < 6 && visible; i++) {
+        visible = dot(u_Planes[i].xyz, center) + u_Planes[i].w >= -radius;
+    }
+
+    // Same projected size metric as Renderer::SelectLOD, without the hysteresis
+    MeshEntry mesh = meshes[object.info.x];
+    float screenSize = radius * u_LodProjScale;
+    if (u_LodPerspective != 0) {
+        float distance = length(center - u_LodOrigin);
+        screenSize = distance > radius ? screenSize / distance : 1e30;
+    }
+    screenSize *= uintBitsToFloat(object.info.z);
+
+    uint lod = 0u;
+    while (lod + 1u < mesh.info.x && screenSize < mesh.lodScreenSizes[lod + 1u]) {
+        lod++;
+    }
+
+    uvec4 range = mesh.lods[lod];
+    commands[id].count = range.x;
+    commands[id].instanceCount = visible ? 1u : 0u;
+    commands[id].firstIndex = range.y;
+    commands[id].baseVertex = int(range.z);
+    commands[id].baseInstance = id;
+}
+)";
+
+    static GLuint CreateComputeProgram(const char* source) {
+        GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+
+        GLint status = 0;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (!status) {
+            GLint length = 0;
+            glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+            std::vector<char> log(length + 1, '\0');
+            glGetShaderInfoLog(shader, length, nullptr, log.data());
+            KleinLogger::Logger::EngineError("Compute shader compilation failed: %s", log.data());
+        }
+
+        GLuint program = glCreateProgram();
+        glAttachShader(program, shader);
+        glLinkProgram(program);
+        glDetachShader(program, shader);
+        glDeleteShader(shader);
+
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (!status) {
+            GLint length = 0;
+            glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+            std::vector<char> log(length + 1, '\0');
+            glGetProgramInfoLog(program, length, nullptr, log.data());
+            KleinLogger::Logger::EngineError("Compute program link failed: %s", log.data());
+        }
+        return program;
+    }
+
+    // Replaces 'buffer' with a larger one, keeping the first 'used' bytes
+    static void GrowBuffer(GLuint& buffer, GLsizeiptr used, GLsizeiptr newCapacity, GLenum usage) {
+        GLuint grown;
+        glGenBuffers(1, &grown);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, newCapacity, nullptr, usage);
+
+        if (buffer) {
+            if (used > 0) {
+                glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+                glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            }
+            glDeleteBuffers(1, &buffer);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        buffer = grown;
+    }
+
+    bool GPUScene::IsSupported() {
+        return GLAD_GL_VERSION_4_3 != 0;
+    }
+
+    GPUScene::GPUScene() {
+        m_cullProgram = CreateComputeProgram(s_cullComputeSrc);
+        m_planesLocation = glGetUniformLocation(m_cullProgram, "u_Planes");
+        m_lodOriginLocation = glGetUniformLocation(m_cullProgram, "u_LodOrigin");
+        m_lodProjScaleLocation = glGetUniformLocation(m_cullProgram, "u_LodProjScale");
+        m_lodPerspectiveLocation = glGetUniformLocation(m_cullProgram, "u_LodPerspective");
+        m_objectCountLocation = glGetUniformLocation(m_cullProgram, "u_ObjectCount");
+        m_requiredFlagsLocation = glGetUniformLocation(m_cullProgram, "u_RequiredFlags");
+
+        glGenVertexArrays(1, &m_vao);
+        ReserveGeometry(4 * 1024 * 1024, 1024 * 1024);
+        ReserveObjects(1024);
+
+        KleinLogger::Logger::EngineLog("GPU-driven scene created");
+    }
+
+    GPUScene::~GPUScene() {
+        glDeleteProgram(m_cullProgram);
+        glDeleteVertexArrays(1, &m_vao);
+        GLuint buffers[] = { m_vertexBuffer, m_indexBuffer, m_objectBuffer, m_objectIDBuffer, m_commandBuffer, m_meshBuffer };
+        glDeleteBuffers(6, buffers);
+    }
+
+    void GPUScene::ReserveGeometry(GLsizeiptr vertexBytes, GLsizeiptr indexBytes) {
+        bool changed = false;
+        if (vertexBytes > m_vertexCapacity) {
+            GLsizeiptr capacity = std::max(m_vertexCapacity * 2, vertexBytes);
+            GrowBuffer(m_vertexBuffer, m_vertexBytes, capacity, GL_STATIC_DRAW);
+            m_vertexCapacity = capacity;
+            changed = true;
+        }
+        if (indexBytes > m_indexCapacity) {
+            GLsizeiptr capacity = std::max(m_indexCapacity * 2, indexBytes);
+            GrowBuffer(m_indexBuffer, m_indexBytes, capacity, GL_STATIC_DRAW);
+            m_indexCapacity = capacity;
+            changed = true;
+        }
+        if (changed) {
+            SetupVertexArray();
+        }
+    }
+
+    void GPUScene::ReserveObjects(uint32_t capacity) {
+        if (capacity <= m_objectCapacity) return;
+        capacity = std::max(capacity, m_objectCapacity * 2);
+
+        // Objects are re-sent in full after growing, so nothing needs copying
+        glDeleteBuffers(1, &m_objectBuffer);
+        glGenBuffers(1, &m_objectBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(ObjectData), nullptr, GL_DYNAMIC_DRAW);
+
+        glDeleteBuffers(1, &m_commandBuffer);
+        glGenBuffers(1, &m_commandBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        std::vector<uint32_t> ids(capacity);
+        std::iota(ids.begin(), ids.end(), 0u);
+        glDeleteBuffers(1, &m_objectIDBuffer);
+        glGenBuffers(1, &m_objectIDBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, m_objectIDBuffer);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(uint32_t), ids.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        m_objectCapacity = capacity;
+        m_dirtyBegin = 0;
+        m_dirtyEnd = (uint32_t)m_objects.size();
+        SetupVertexArray();
+    }
+
+    void GPUScene::SetupVertexArray() {
+        if (!m_vertexBuffer || !m_indexBuffer || !m_objectIDBuffer) return;
+
+        glBindVertexArray(m_vao);
+        glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+
+        // Same layout as Mesh::SetupMesh
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
+
+        glBindBuffer(GL_ARRAY_BUFFER, m_objectIDBuffer);
+        glEnableVertexAttribArray(kObjectIDAttribLocation);
+        glVertexAttribIPointer(kObjectIDAttribLocation, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)0);
+        glVertexAttribDivisor(kObjectIDAttribLocation, 1);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    uint32_t GPUScene::RegisterMesh(const std::shared_ptr<Mesh>& mesh) {
+        auto it = m_meshIndices.find(mesh.get());
+        if (it != m_meshIndices.end()) {
+            m_meshSlots[it->second].objectCount++;
+            return it->second;
+        }
+
+        uint32_t index;
+        if (!m_freeMeshSlots.empty()) {
+            index = m_freeMeshSlots.back();
+            m_freeMeshSlots.pop_back();
+        } else {
+            index = (uint32_t)m_meshEntries.size();
+            m_meshEntries.emplace_back();
+            m_meshSlots.emplace_back();
+        }
+
+        MeshSlot& slot = m_meshSlots[index];
+        slot.mesh = mesh;
+        slot.objectCount = 1;
+        slot.lodCount = std::min(mesh->GetLODCount(), 4);
+
+        MeshEntry entry{};
+        entry.info = glm::uvec4((uint32_t)slot.lodCount, 0u, 0u, 0u);
+
+        // Copy each level's GPU buffers straight into the shared ones; the CPU copies
+        // are usually gone by now
+        for (int level = 0; level < slot.lodCount; level++) {
+            const Mesh* lod = mesh->GetLOD(level);
+            lod->EnsureUploaded();
+            GLsizeiptr vertexSize = (GLsizeiptr)lod->GetVertexCount() * sizeof(Vertex);
+            GLsizeiptr indexSize = (GLsizeiptr)lod->GetIndexCount() * sizeof(uint32_t);
+
+            GLsizeiptr vertexOffset = TakeFreeRange(m_freeVertexRanges, vertexSize);
+            GLsizeiptr indexOffset = TakeFreeRange(m_freeIndexRanges, indexSize);
+            if (vertexOffset < 0 || indexOffset < 0) {
+                ReserveGeometry(m_vertexBytes + (vertexOffset < 0 ? vertexSize : 0),
+                                m_indexBytes + (indexOffset < 0 ? indexSize : 0));
+                if (vertexOffset < 0) {
+                    vertexOffset = m_vertexBytes;
+                    m_vertexBytes += vertexSize;
+                }
+                if (indexOffset < 0) {
+                    indexOffset = m_indexBytes;
+                    m_indexBytes += indexSize;
+                }
+            }
+            slot.vertices[level] = { vertexOffset, vertexSize };
+            slot.indices[level] = { indexOffset, indexSize };
+
+            glBindBuffer(GL_COPY_READ_BUFFER, lod->GetVertexBuffer());
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_vertexBuffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, vertexOffset, vertexSize);
+
+            glBindBuffer(GL_COPY_READ_BUFFER, lod->GetIndexBuffer());
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexBuffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, indexOffset, indexSize);
+
+            entry.lods[level] = glm::uvec4(
+                lod->GetIndexCount(),
+                (uint32_t)(indexOffset / sizeof(uint32_t)),
+                (uint32_t)(vertexOffset / sizeof(Vertex)),
+                0u
+            );
+            entry.lodScreenSizes[level] = mesh->GetLODScreenSize(level);
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        m_meshEntries[index] = entry;
+        m_meshIndices[mesh.get()] = index;
+        m_meshesDirty = true;
+        return index;
+    }
+
+    void GPUScene::ReleaseMesh(uint32_t meshIndex) {
+        MeshSlot& slot = m_meshSlots[meshIndex];
+        if (--slot.objectCount > 0) return;
+
+        // Dead objects may still name this slot, but they never draw, so its entry
+        // can stay in the buffer until the slot is reused
+        for (int level = 0; level < slot.lodCount; level++) {
+            FreeGeometry(m_freeVertexRanges, m_vertexBytes, slot.vertices[level]);
+            FreeGeometry(m_freeIndexRanges, m_indexBytes, slot.indices[level]);
+        }
+        m_meshIndices.erase(slot.mesh.get());
+        slot = MeshSlot();
+        m_freeMeshSlots.push_back(meshIndex);
+    }
+
+    GLsizeiptr GPUScene::TakeFreeRange(std::vector<GeometryRange>& freeRanges, GLsizeiptr size) {
+        for (size_t i = 0; i < freeRanges.size(); i++) {
+            GeometryRange& range = freeRanges[i];
+            if (range.size < size) continue;
+
+            GLsizeiptr offset = range.offset;
+            range.offset += size;
+            range.size -= size;
+            if (range.size == 0) {
+                freeRanges.erase(freeRanges.begin() + (ptrdiff_t)i);
+            }
+            return offset;
+        }
+        return -1;
+    }
+
+    void GPUScene::FreeGeometry(std::vector<GeometryRange>& freeRanges, GLsizeiptr& used, GeometryRange range) {
+        if (range.size == 0) return;
+
+        auto next = std::lower_bound(freeRanges.begin(), freeRanges.end(), range.offset,
+            [](const GeometryRange& free, GLsizeiptr offset) { return free.offset < offset; });
+        if (next != freeRanges.end() && range.offset + range.size == next->offset) {
+            range.size += next->size;
+            next = freeRanges.erase(next);
+        }
+        if (next != freeRanges.begin()) {
+            auto previous = std::prev(next);
+            if (previous->offset + previous->size == range.offset) {
+                range.offset = previous->offset;
+                range.size += previous->size;
+                next = freeRanges.erase(previous);
+            }
+        }
+
+        if (range.offset + range.size == used) {
+            used = range.offset;
+        } else {
+            freeRanges.insert(next, range);
+        }
+    }
+
+    void GPUScene::MarkDirty(uint32_t object) {
+        m_dirtyBegin = std::min(m_dirtyBegin, object);
+        m_dirtyEnd = std::max(m_dirtyEnd, object + 1);
+        m_version++;
+    }
+
+    uint32_t GPUScene::AddObject(const std::shared_ptr<Mesh>& mesh, const MaterialBlock& material, const glm::mat4& model,
+                                 uint32_t flags, float lodBias) {
+        if (!mesh) return kInvalidObject;
+
+        uint32_t object;
+        if (!m_freeSlots.empty()) {
+            object = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        } else {
+            object = (uint32_t)m_objects.size();
+            m_objects.emplace_back();
+            ReserveObjects(object + 1);
+        }
+
+        uint32_t lodBiasBits;
+        std::memcpy(&lodBiasBits, &lodBias, sizeof(lodBiasBits));
+
+        ObjectData& data = m_objects[object];
+        data.albedoMetallic = glm::vec4(material.albedo, material.metallic);
+        data.roughnessAo = glm::vec4(material.roughness, material.ao, 0.0f, 0.0f);
+        data.info = glm::uvec4(RegisterMesh(mesh), flags, lodBiasBits, 1u);
+        m_liveObjects++;
+
+        UpdateObject(object, model);
+        return object;
+    }
+
+    void GPUScene::UpdateObject(uint32_t object, const glm::mat4& model) {
+        if (object >= m_objects.size()) return;
+
+        ObjectData& data = m_objects[object];
+        const Mesh& mesh = *m_meshSlots[data.info.x].mesh;
+        float maxScale = std::max({ glm::length(glm::vec3(model[0])),
+                                    glm::length(glm::vec3(model[1])),
+                                    glm::length(glm::vec3(model[2])) });
+
+        data.model = model;
+        data.boundsSphere = glm::vec4(glm::vec3(model * glm::vec4(mesh.GetBoundsCenter(), 1.0f)),
+                                      mesh.GetBoundsRadius() * maxScale);
+        MarkDirty(object);
+    }
+
+    void GPUScene::RemoveObject(uint32_t object) {
+        if (object >= m_objects.size() || m_objects[object].info.w == 0u) return;
+
+        // Dead slots stay in the buffer and always produce zero instances
+        m_objects[object].info.w = 0u;
+        m_freeSlots.push_back(object);
+        ReleaseMesh(m_objects[object].info.x);
+        m_liveObjects--;
+        MarkDirty(object);
+    }
+
+    void GPUScene::Upload() {
+        if (m_meshesDirty) {
+            if (m_meshEntries.size() > m_meshCapacity) {
+                m_meshCapacity = std::max<uint32_t>((uint32_t)m_meshEntries.size(), m_meshCapacity * 2);
+                glDeleteBuffers(1, &m_meshBuffer);
+                glGenBuffers(1, &m_meshBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_meshBuffer);
+                glBufferData(GL_SHADER_STORAGE_BUFFER, m_meshCapacity * sizeof(MeshEntry), nullptr, GL_STATIC_DRAW);
+            }
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_meshBuffer);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_meshEntries.size() * sizeof(MeshEntry), m_meshEntries.data());
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            m_meshesDirty = false;
+        }
+
+        // One contiguous range covers every change since the last upload
+        if (m_dirtyBegin < m_dirtyEnd) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, m_dirtyBegin * sizeof(ObjectData),
+                (m_dirtyEnd - m_dirtyBegin) * sizeof(ObjectData), &m_objects[m_dirtyBegin]);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+        m_dirtyBegin = UINT32_MAX;
+        m_dirtyEnd = 0;
+    }
+
+    void GPUScene::Cull(const glm::mat4& viewProj, const glm::vec3& lodOrigin, float lodProjScale,
+                        bool perspective, uint32_t requiredFlags) {
+        uint32_t slotCount = (uint32_t)m_objects.size();
+        if (slotCount == 0) return;
+
+        Frustum frustum(viewProj);
+
+        glUseProgram(m_cullProgram);
+        glUniform4fv(m_planesLocation, 6, glm::value_ptr(frustum.planes[0]));
+        glUniform3fv(m_lodOriginLocation, 1, glm::value_ptr(lodOrigin));
+        glUniform1f(m_lodProjScaleLocation, lodProjScale);
+        glUniform1i(m_lodPerspectiveLocation, perspective ? 1 : 0);
+        glUniform1ui(m_objectCountLocation, slotCount);
+        glUniform1ui(m_requiredFlagsLocation, requiredFlags);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StorageBinding::Objects, m_objectBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StorageBinding::Meshes, m_meshBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StorageBinding::DrawCommands, m_commandBuffer);
+
+        glDispatchCompute((slotCount + 63) / 64, 1, 1);
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+        glUseProgram(0);
+    }
+
+    void GPUScene::Draw() const {
+        uint32_t slotCount = (uint32_t)m_objects.size();
+        if (slotCount == 0) return;
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StorageBinding::Objects, m_objectBuffer);
+        glBindVertexArray(m_vao);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)slotCount, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+
+} // namespace Klein
@@ -0,0 +1,273 @@
+#include "HiZBuffer.h"
+#include "Shader.h"
+#include "Logger.h"
+#include <algorithm>
+
+namespace Klein {
+
+    // Full screen triangle, no vertex buffer needed
+    static const char* s_reduceVertexSrc = R"(
+#version 410 core
+void main() {
+    vec2 uv = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+    // Each destination texel keeps the farthest of the 2x2 source texels it covers.
+    // Level sizes round up, so clamping at the edge still covers odd sources exactly
+    static const char* s_reduceFragmentSrc = R"(
+#version 410 core
+uniform sampler2D u_Source;
+uniform int u_SourceLevel;
+
+out float o_Depth;
+
+void main() {
+    ivec2 size = textureSize(u_Source, u_SourceLevel);
+    ivec2 base = ivec2(gl_FragCoord.xy) * 2;
+
+    float depth = texelFetch(u_Source, min(base, size - 1), u_SourceLevel).r;
+    depth = max(depth, texelFetch(u_Source, min(base + ivec2(1, 0), size - 1), u_SourceLevel).r);
+    depth = max(depth, texelFetch(u_Source, min(base + ivec2(0, 1), size - 1), u_SourceLevel).r);
+    depth = max(depth, texelFetch(u_Source, min(base + ivec2(1, 1), size - 1), u_SourceLevel).r);
+    o_Depth = depth;
+}
+)";
+
+    HiZBuffer::HiZBuffer() {
+        m_reduceShader = std::make_shared<Shader>(s_reduceVertexSrc, s_reduceFragmentSrc);
+
+        glGenVertexArrays(1, &m_vao);
+        glGenFramebuffers(1, &m_fbo);
+        glGenBuffers(1, &m_readbackPBO);
+    }
+
+    HiZBuffer::~HiZBuffer() {
+        Release();
+        glDeleteBuffers(1, &m_readbackPBO);
+        glDeleteFramebuffers(1, &m_fbo);
+        glDeleteVertexArrays(1, &m_vao);
+    }
+
+    void HiZBuffer::Release() {
+        if (m_readbackFence) {
+            glDeleteSync(m_readbackFence);
+            m_readbackFence = nullptr;
+        }
+        glDeleteTextures(1, &m_depthCopy);
+        glDeleteTextures(1, &m_pyramid);
+        m_depthCopy = m_pyramid = 0;
+    }
+
+    void HiZBuffer::Resize(int width, int height) {
+        Release();
+        m_width = width;
+        m_height = height;
+
+        // Must be copyable from the default framebuffer's depth
+        glGenTextures(1, &m_depthCopy);
+        glBindTexture(GL_TEXTURE_2D, m_depthCopy);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0,
+            GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+        // Only the levels down to the readback size are ever needed
+        glGenTextures(1, &m_pyramid);
+        glBindTexture(GL_TEXTURE_2D, m_pyramid);
+        glm::ivec2 size(width, height);
+        m_readbackLevel = 0;
+        for (int level = 0; ; level++) {
+            size = (size + 1) / 2;
+            glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, size.x, size.y, 0, GL_RED, GL_FLOAT, nullptr);
+            if (size.x <= kReadbackMaxWidth || (size.x == 1 && size.y == 1)) {
+                m_readbackLevel = level;
+                m_readbackSize = size;
+                break;
+            }
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_readbackLevel);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackPBO);
+        glBufferData(GL_PIXEL_PACK_BUFFER, m_readbackSize.x * m_readbackSize.y * sizeof(float), nullptr, GL_STREAM_READ);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        KleinLogger::Logger::EngineLog("Hi-Z buffer resized to %dx%d (readback %dx%d)",
+            width, height, m_readbackSize.x, m_readbackSize.y);
+    }
+
+    void HiZBuffer::Build(const glm::mat4& viewProj, int width, int height) {
+        if (m_readbackFence || width <= 0 || height <= 0) return;
+
+        if (width != m_width || height != m_height) {
+            Resize(width, height);
+        }
+
+        GLint framebuffer = 0, program = 0, vao = 0;
+        GLint viewport[4];
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+        glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vao);
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+
+        // Copy depth out of the framebuffer that was just rendered
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_depthCopy);
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+        glDisable(GL_DEPTH_TEST);
+        m_reduceShader->Bind();
+        glBindVertexArray(m_vao);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+
+        glm::ivec2 size(width, height);
+        for (int level = 0; level <= m_readbackLevel; level++) {
+            size = (size + 1) / 2;
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_pyramid, level);
+
+            if (level == 0) {
+                glBindTexture(GL_TEXTURE_2D, m_depthCopy);
+                m_reduceShader->SetInt("u_SourceLevel", 0);
+            } else {
+                // Restrict sampling to the source level so reading and writing don't overlap
+                glBindTexture(GL_TEXTURE_2D, m_pyramid);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+                m_reduceShader->SetInt("u_SourceLevel", level - 1);
+            }
+
+            glViewport(0, 0, size.x, size.y);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+
+        glBindTexture(GL_TEXTURE_2D, m_pyramid);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_readbackLevel);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // Asynchronous readback of the smallest level, picked up by FetchReadback
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackPBO);
+        glReadPixels(0, 0, m_readbackSize.x, m_readbackSize.y, GL_RED, GL_FLOAT, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        m_readbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_pendingViewProj = viewProj;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)framebuffer);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glBindVertexArray((GLuint)vao);
+        glUseProgram((GLuint)program);
+        if (depthTest) glEnable(GL_DEPTH_TEST);
+    }
+
+    void HiZBuffer::FetchReadback() {
+        if (!m_readbackFence) return;
+
+        GLenum status = glClientWaitSync(m_readbackFence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+
+        glDeleteSync(m_readbackFence);
+        m_readbackFence = nullptr;
+
+        size_t texelCount = (size_t)m_readbackSize.x * m_readbackSize.y;
+        m_levels.resize(1);
+        m_levelSizes.assign(1, m_readbackSize);
+        m_levels[0].resize(texelCount);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackPBO);
+        void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, texelCount * sizeof(float), GL_MAP_READ_BIT);
+        if (!data) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            m_hasData = false;
+            return;
+        }
+        std::copy_n(static_cast<const float*>(data), texelCount, m_levels[0].begin());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        // Continue the pyramid on the CPU so large bounds only touch a few texels
+        while (m_levelSizes.back().x > 1 || m_levelSizes.back().y > 1) {
+            glm::ivec2 src = m_levelSizes.back();
+            glm::ivec2 dst = (src + 1) / 2;
+            std::vector<float> level(dst.x * dst.y);
+            const std::vector<float>& prev = m_levels.back();
+
+            for (int y = 0; y < dst.y; y++) {
+                int y0 = y * 2, y1 = std::min(y * 2 + 1, src.y - 1);
+                for (int x = 0; x < dst.x; x++) {
+                    int x0 = x * 2, x1 = std::min(x * 2 + 1, src.x - 1);
+                    level[x + y * dst.x] = std::max({
+                        prev[x0 + y0 * src.x], prev[x1 + y0 * src.x],
+                        prev[x0 + y1 * src.x], prev[x1 + y1 * src.x]
+                    });
+                }
+            }
+
+            m_levels.push_back(std::move(level));
+            m_levelSizes.push_back(dst);
+        }
+
+        m_viewProj = m_pendingViewProj;
+        m_sourceWidth = m_width;
+        m_sourceHeight = m_height;
+        m_hasData = true;
+    }
+
+    bool HiZBuffer::IsOccluded(const glm::vec3& center, float radius) const {
+        if (!m_hasData) return false;
+
+        // Screen rectangle and nearest depth of the sphere's bounding box
+        glm::vec2 ndcMin(1e30f), ndcMax(-1e30f);
+        float nearestDepth = 1e30f;
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec3 offset(
+                (corner & 1) ? radius : -radius,
+                (corner & 2) ? radius : -radius,
+                (corner & 4) ? radius : -radius
+            );
+            glm::vec4 clip = m_viewProj * glm::vec4(center + offset, 1.0f);
+            if (clip.w <= 1e-5f) return false; // Crosses the camera plane
+
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            ndcMin = glm::min(ndcMin, glm::vec2(ndc));
+            ndcMax = glm::max(ndcMax, glm::vec2(ndc));
+            nearestDepth = std::min(nearestDepth, ndc.z);
+        }
+
+        // Nothing is known about what was outside the old view
+        if (ndcMax.x < -1.0f || ndcMax.y < -1.0f || ndcMin.x > 1.0f || ndcMin.y > 1.0f) return false;
+
+        auto toPixel = [](float ndc, int size) {
+            return std::clamp((int)((std::clamp(ndc, -1.0f, 1.0f) * 0.5f + 0.5f) * size), 0, size - 1);
+        };
+        int px0 = toPixel(ndcMin.x, m_sourceWidth), px1 = toPixel(ndcMax.x, m_sourceWidth);
+        int py0 = toPixel(ndcMin.y, m_sourceHeight), py1 = toPixel(ndcMax.y, m_sourceHeight);
+
+        // Coarsest useful level: the rectangle spans at most 2x2 texels
+        int level = 0;
+        int shift = m_readbackLevel + 1;
+        while (level + 1 < (int)m_levels.size() &&
+               ((px1 >> shift) - (px0 >> shift) > 1 || (py1 >> shift) - (py0 >> shift) > 1)) {
+            level++;
+            shift++;
+        }
+
+        const std::vector<float>& depths = m_levels[level];
+        glm::ivec2 size = m_levelSizes[level];
+        float farthest = 0.0f;
+        for (int y = py0 >> shift; y <= std::min(py1 >> shift, size.y - 1); y++) {
+            for (int x = px0 >> shift; x <= std::min(px1 >> shift, size.x - 1); x++) {
+                farthest = std::max(farthest, depths[x + y * size.x]);
+            }
+        }
+
+        return nearestDepth * 0.5f + 0.5f > farthest;
+    }
+
+} // namespace Klein
@@ -0,0 +1,123 @@
+#include "JobSystem.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include <algorithm>
+
+namespace Klein {
+
+    static thread_local uint32_t s_threadIndex = 0;
+
+    JobSystem& JobSystem::Get() {
+        static JobSystem instance;
+        return instance;
+    }
+
+    JobSystem::JobSystem() {
+        // Leave one hardware thread for the main loop
+        uint32_t hardwareThreads = std::max(2u, std::thread::hardware_concurrency());
+        uint32_t workerCount = hardwareThreads - 1;
+
+        m_workers.reserve(workerCount);
+        for (uint32_t i = 0; i < workerCount; i++) {
+            m_workers.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+        }
+
+        KleinLogger::Logger::EngineLog("Job system started with %u worker(s)", workerCount);
+    }
+
+    JobSystem::~JobSystem() {
+        m_running.store(false, std::memory_order_release);
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    uint32_t JobSystem::GetThreadIndex() {
+        return s_threadIndex;
+    }
+
+    void JobSystem::Submit(Job job, JobCounter* counter) {
+        auto task = std::make_shared<JobTask>();
+        task->job = std::move(job);
+        task->counter = counter;
+        if (counter) {
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+            // Workers take jobs roughly in order, so the ones they ran sit at the front
+            std::lock_guard<std::mutex> lock(counter->laneMutex);
+            while (!counter->lane.empty() && counter->lane.front()->claimed.load(std::memory_order_relaxed)) {
+                counter->lane.pop_front();
+            }
+            counter->lane.push_back(task);
+        }
+        m_queue.enqueue(std::move(task));
+    }
+
+    void JobSystem::Wait(JobCounter& counter) {
+        while (!counter.IsDone()) {
+            std::shared_ptr<JobTask> task;
+            {
+                std::lock_guard<std::mutex> lock(counter.laneMutex);
+                if (!counter.lane.empty()) {
+                    task = std::move(counter.lane.front());
+                    counter.lane.pop_front();
+                }
+            }
+
+            // Nothing left to take; the rest is running on other threads
+            if (!task) {
+                std::this_thread::yield();
+                continue;
+            }
+            Execute(*task);
+        }
+    }
+
+    void JobSystem::ParallelFor(size_t count, size_t grainSize, const RangeJob& job) {
+        if (count == 0) return;
+
+        grainSize = std::max<size_t>(grainSize, 1);
+        size_t maxChunks = GetThreadSlotCount() * 4;
+        size_t chunkSize = std::max(grainSize, (count + maxChunks - 1) / maxChunks);
+
+        if (chunkSize >= count) {
+            job(0, count);
+            return;
+        }
+
+        JobCounter counter;
+        for (size_t begin = chunkSize; begin < count; begin += chunkSize) {
+            size_t end = std::min(begin + chunkSize, count);
+            Submit([&job, begin, end]() { job(begin, end); }, &counter);
+        }
+
+        // The caller takes the first chunk itself, then helps with the rest
+        job(0, chunkSize);
+        Wait(counter);
+    }
+
+    void JobSystem::WorkerLoop(uint32_t index) {
+        s_threadIndex = index;
+        KLEIN_PROFILE_THREAD("Worker " + std::to_string(index));
+
+        std::shared_ptr<JobTask> task;
+        while (m_running.load(std::memory_order_acquire)) {
+            if (m_queue.wait_dequeue_timed(task, 10000)) { // 10 ms, so shutdown is noticed
+                Execute(*task);
+                task.reset();
+            }
+        }
+    }
+
+    void JobSystem::Execute(JobTask& task) {
+        if (task.claimed.exchange(true, std::memory_order_acq_rel)) return;
+
+        task.job();
+        task.job = nullptr;
+        // The waiter may destroy the counter as soon as this lands
+        if (task.counter) {
+            task.counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+} // namespace Klein
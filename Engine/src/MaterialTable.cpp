@@ -0,0 +1,244 @@
+#include "MaterialTable.h"
+#include "GPUScene.h"
+#include "Mesh.h"
+#include "Logger.h"
+#include <algorithm>
+
+namespace Klein {
+
+    namespace {
+
+        // Binds on the scratch unit, so the units set up for drawing keep their
+        // textures, and restores the active unit when it goes out of scope
+        class ScratchBinding {
+        public:
+            ScratchBinding(GLenum target, GLuint texture) {
+                glGetIntegerv(GL_ACTIVE_TEXTURE, &m_activeUnit);
+                glActiveTexture(GL_TEXTURE0 + TextureSlot::Scratch);
+                glBindTexture(target, texture);
+            }
+            ~ScratchBinding() { glActiveTexture((GLenum)m_activeUnit); }
+
+            ScratchBinding(const ScratchBinding&) = delete;
+            ScratchBinding& operator=(const ScratchBinding&) = delete;
+
+        private:
+            GLint m_activeUnit = GL_TEXTURE0;
+        };
+
+    } // namespace
+
+    bool MaterialTable::IsSupported() {
+        return GLAD_GL_VERSION_4_3 != 0;
+    }
+
+    bool MaterialTable::HasBindless() {
+        return GLAD_GL_ARB_bindless_texture != 0;
+    }
+
+    MaterialTable::MaterialTable() {
+        glGenBuffers(1, &m_buffer);
+        m_bindless = HasBindless();
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &m_maxLayers);
+        m_arrays.resize(kMaxArrays);
+
+        KleinLogger::Logger::EngineLog("Material table created (%s)",
+            m_bindless ? "bindless textures" : "texture arrays");
+    }
+
+    MaterialTable::~MaterialTable() {
+        glDeleteBuffers(1, &m_buffer);
+        for (const TextureArray& array : m_arrays) {
+            if (array.texture) {
+                glDeleteTextures(1, &array.texture);
+            }
+        }
+    }
+
+    void MaterialTable::BeginFrame() {
+        m_frame++;
+        m_materials.clear();
+        m_indices.clear();
+        if (!m_bindless) {
+            ReleaseStale();
+        }
+    }
+
+    uint32_t MaterialTable::Add(const Material* material, const MaterialBlock& block,
+                                const Texture* albedoMap, const Texture* normalMap, const SamplerDesc& sampler) {
+        auto [it, inserted] = m_indices.try_emplace(material, (uint32_t)m_materials.size());
+        if (!inserted) {
+            return it->second;
+        }
+
+        MaterialData data;
+        data.albedoMetallic = glm::vec4(block.albedo, block.metallic);
+        data.roughnessAo = glm::vec4(block.roughness, block.ao, 0.0f, 0.0f);
+        GLuint samplerObject = SamplerCache::Get().GetSampler(sampler);
+        if (!Reference(albedoMap, samplerObject, data.albedoMap) ||
+            !Reference(normalMap, samplerObject, data.normalMap)) {
+            it->second = kInvalidIndex;
+            return kInvalidIndex;
+        }
+
+        m_materials.push_back(data);
+        return it->second;
+    }
+
+    void MaterialTable::Bind() {
+        if (m_materials.size() > m_capacity) {
+            m_capacity = std::max(m_materials.size(), m_capacity * 2);
+        }
+
+        // Orphaned every frame; the driver hands out fresh storage while the GPU reads the old one
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, m_capacity * sizeof(MaterialData), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_materials.size() * sizeof(MaterialData), m_materials.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StorageBinding::Materials, m_buffer);
+
+        for (GLuint i = 0; i < kMaxArrays; i++) {
+            if (m_arrays[i].texture) {
+                glActiveTexture(GL_TEXTURE0 + TextureSlot::MaterialArrays + i);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, m_arrays[i].texture);
+                glBindSampler(TextureSlot::MaterialArrays + i, m_arrays[i].sampler);
+            }
+        }
+    }
+
+    bool MaterialTable::Reference(const Texture* texture, GLuint sampler, glm::uvec4& out) {
+        out = glm::uvec4(0u);
+        if (!texture) return true;
+
+        texture->EnsureUploaded();
+        if (texture->GetID() == 0) return true;    // Failed to load; drawn untextured
+
+        if (m_bindless) {
+            GLuint64 handle = texture->GetBindlessHandle(sampler);
+            out = glm::uvec4((uint32_t)handle, (uint32_t)(handle >> 32), 0u, 1u);
+            return true;
+        }
+
+        PlacementKey key{ texture->GetContentID(), sampler };
+        auto it = m_placements.find(key);
+        if (it == m_placements.end()) {
+            Placement placement;
+            if (!Place(*texture, sampler, placement)) return false;
+            it = m_placements.emplace(key, placement).first;
+        }
+        it->second.lastUsed = m_frame;
+        out = glm::uvec4(it->second.array, it->second.layer, 0u, 1u);
+        return true;
+    }
+
+    // Copies the texture's whole mip chain into a free layer of a matching array
+    bool MaterialTable::Place(const Texture& texture, GLuint sampler, Placement& out) {
+        GLint internalFormat = 0, width = 0, height = 0, maxLevel = 0, immutableLevels = 0;
+        ScratchBinding binding(GL_TEXTURE_2D, texture.GetID());
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_LEVELS, &immutableLevels);
+        if (width == 0 || height == 0) return false;
+
+        // Mutable generated chains leave MAX_LEVEL at its default of 1000
+        int levels = immutableLevels > 0 ? immutableLevels
+                                         : std::min(maxLevel + 1, TextureLoader::FullMipCount(width, height));
+
+        TextureArray* array = nullptr;
+        TextureArray* emptySlot = nullptr;
+        for (TextureArray& candidate : m_arrays) {
+            if (!candidate.texture) {
+                if (!emptySlot) emptySlot = &candidate;
+            } else if (candidate.internalFormat == (GLenum)internalFormat && candidate.width == width &&
+                       candidate.height == height && candidate.levels == levels &&
+                       candidate.sampler == sampler) {
+                array = &candidate;
+                break;
+            }
+        }
+
+        if (!array) {
+            if (!emptySlot) {
+                if (!m_reportedFull) {
+                    KleinLogger::Logger::EngineWarn("All %u material texture arrays in use; %s drawn unbatched",
+                        kMaxArrays, texture.GetPath().c_str());
+                    m_reportedFull = true;
+                }
+                return false;
+            }
+            array = emptySlot;
+            *array = TextureArray();
+            array->internalFormat = (GLenum)internalFormat;
+            array->width = width;
+            array->height = height;
+            array->levels = levels;
+            array->sampler = sampler;
+            Grow(*array, std::min(16, m_maxLayers));
+        }
+
+        int layer;
+        if (!array->freeLayers.empty()) {
+            layer = array->freeLayers.back();
+            array->freeLayers.pop_back();
+        } else {
+            if (array->used == array->capacity) {
+                if (array->capacity >= m_maxLayers) return false;
+                Grow(*array, std::min(array->capacity * 2, m_maxLayers));
+            }
+            layer = array->used++;
+        }
+
+        for (int level = 0; level < levels; level++) {
+            glCopyImageSubData(texture.GetID(), GL_TEXTURE_2D, level, 0, 0, 0,
+                               array->texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+                               std::max(1, width >> level), std::max(1, height >> level), 1);
+        }
+
+        out.array = (uint32_t)(array - m_arrays.data());
+        out.layer = (uint32_t)layer;
+        out.lastUsed = m_frame;
+        return true;
+    }
+
+    void MaterialTable::Grow(TextureArray& array, int capacity) {
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        ScratchBinding binding(GL_TEXTURE_2D_ARRAY, texture);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, array.levels, array.internalFormat, array.width, array.height, capacity);
+
+        if (array.texture) {
+            for (int level = 0; level < array.levels; level++) {
+                glCopyImageSubData(array.texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                                   texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                                   std::max(1, array.width >> level), std::max(1, array.height >> level), array.used);
+            }
+            glDeleteTextures(1, &array.texture);
+        }
+
+        array.texture = texture;
+        array.capacity = capacity;
+    }
+
+    void MaterialTable::ReleaseStale() {
+        for (auto it = m_placements.begin(); it != m_placements.end();) {
+            if (it->second.lastUsed + kRetainFrames < m_frame) {
+                m_arrays[it->second.array].freeLayers.push_back((int)it->second.layer);
+                it = m_placements.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        // Empty arrays free their slot for another format or size
+        for (TextureArray& array : m_arrays) {
+            if (array.texture && (int)array.freeLayers.size() == array.used) {
+                glDeleteTextures(1, &array.texture);
+                array = TextureArray();
+                m_reportedFull = false;
+            }
+        }
+    }
+
+} // namespace Klein
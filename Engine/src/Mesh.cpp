@@ -1,64 +1,144 @@
 #include "Mesh.h"
+#include "MeshSimplifier.h"
+#include "RenderThread.h"
+#include "TextureStreamer.h"
+#include "SamplerCache.h"
 #include "Logger.h"
 #include <cmath>
-
-#ifndef STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-#endif
+#include <algorithm>
+#include <cstring>
 
 namespace Klein {
 
     // ===== Texture Implementation =====
-    Texture::Texture(const std::string& path, Type type)
-        : m_path(path), m_type(type)
+    Texture::Texture(const std::string& path, Type type, DeferredLoad)
+        : m_type(type), m_path(path)
     {
-        stbi_set_flip_vertically_on_load(true);
-        
-        unsigned char* data = stbi_load(path.c_str(), &m_width, &m_height, &m_channels, 0);
-        
-        if (!data) {
-            KleinLogger::Logger::EngineError("Failed to load texture: %s", path.c_str());
-            m_textureID = 0;
-            return;
+    }
+
+    Texture::~Texture() {
+        if (m_textureID != 0) {
+            GLuint texture = m_textureID;
+            RenderThread::RunOnContext([texture, handles = std::move(m_bindlessHandles)] {
+                // Resident handles must be released before their texture is deleted
+                for (const auto& [sampler, handle] : handles) {
+                    glMakeTextureHandleNonResidentARB(handle);
+                }
+                glDeleteTextures(1, &texture);
+            });
         }
+    }
 
-        glGenTextures(1, &m_textureID);
-        glBindTexture(GL_TEXTURE_2D, m_textureID);
+    void Texture::Upload(TextureData& data) const {
+        if (data.compressed && !TextureLoader::IsFormatSupported(data.internalFormat)) {
+            if (!TextureLoader::Decompress(data)) {
+                KleinLogger::Logger::EngineError("Compressed format 0x%X not supported by the driver: %s",
+                    data.internalFormat, m_path.c_str());
+                return;
+            }
+            KleinLogger::Logger::EngineWarn("Compressed format not supported, decoded on the CPU: %s",
+                m_path.c_str());
+        }
 
-        GLenum format = GL_RGB;
-        if (m_channels == 1) format = GL_RED;
-        else if (m_channels == 3) format = GL_RGB;
-        else if (m_channels == 4) format = GL_RGBA;
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        SetTextureID(texture);
+        glBindTexture(GL_TEXTURE_2D, m_textureID);
 
-        glTexImage2D(GL_TEXTURE_2D, 0, format, m_width, m_height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        // Immutable storage lets the driver validate the chain once instead of on every draw.
+        // Filtering and wrapping come from sampler objects (SamplerCache), not the texture
+        bool immutable = TextureLoader::HasImmutableStorage();
+        if (immutable) {
+            GLsizei levels = data.generateMips ? TextureLoader::FullMipCount(data.width, data.height)
+                                               : (GLsizei)data.levels.size();
+            glTexStorage2D(GL_TEXTURE_2D, levels, data.internalFormat, data.width, data.height);
+        }
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // Rows of RGB and block data aren't 4-byte aligned in general
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t i = 0; i < data.levels.size(); i++) {
+            const TextureData::Level& level = data.levels[i];
+            const unsigned char* pixels = data.data.data() + level.offset;
+            if (immutable && data.compressed) {
+                glCompressedTexSubImage2D(GL_TEXTURE_2D, (GLint)i, 0, 0, level.width, level.height,
+                                          data.internalFormat, (GLsizei)level.size, pixels);
+            } else if (immutable) {
+                glTexSubImage2D(GL_TEXTURE_2D, (GLint)i, 0, 0, level.width, level.height,
+                                data.format, GL_UNSIGNED_BYTE, pixels);
+            } else if (data.compressed) {
+                glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, data.internalFormat, level.width, level.height,
+                                       0, (GLsizei)level.size, pixels);
+            } else {
+                glTexImage2D(GL_TEXTURE_2D, (GLint)i, (GLint)data.internalFormat, level.width, level.height,
+                             0, data.format, GL_UNSIGNED_BYTE, pixels);
+            }
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-        stbi_image_free(data);
-        KleinLogger::Logger::EngineLog("Texture loaded: %s (%dx%d, %d channels)", 
-            path.c_str(), m_width, m_height, m_channels);
+        if (data.generateMips) {
+            glGenerateMipmap(GL_TEXTURE_2D);
+        } else if (!immutable) {
+            // Stop at the last level in the file so a partial chain is still complete
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)data.levels.size() - 1);
+        }
     }
 
-    Texture::~Texture() {
-        if (m_textureID != 0) {
-            glDeleteTextures(1, &m_textureID);
+    void Texture::EnsureUploaded() const {
+        if (m_textureID == 0 && m_pending) {
+            Upload(*m_pending);
+            m_pending.reset();
         }
     }
 
-    void Texture::Bind(unsigned int slot) const {
+    void Texture::Bind(unsigned int slot, GLuint sampler) const {
+        EnsureUploaded();
         glActiveTexture(GL_TEXTURE0 + slot);
         glBindTexture(GL_TEXTURE_2D, m_textureID);
+        glBindSampler(slot, sampler ? sampler : SamplerCache::Get().GetDefaultSampler());
     }
 
     void Texture::Unbind() const {
         glBindTexture(GL_TEXTURE_2D, 0);
     }
 
+    void Texture::SetTextureID(GLuint texture) const {
+        static std::atomic<uint64_t> s_nextContentID{1};
+
+        // Handles belong to the old object, which the caller deletes after this
+        for (const auto& [sampler, handle] : m_bindlessHandles) {
+            glMakeTextureHandleNonResidentARB(handle);
+        }
+        m_bindlessHandles.clear();
+
+        m_textureID = texture;
+        m_contentID = s_nextContentID.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    GLuint64 Texture::GetBindlessHandle(GLuint sampler) const {
+        if (m_textureID == 0) return 0;
+
+        for (const auto& [handleSampler, handle] : m_bindlessHandles) {
+            if (handleSampler == sampler) return handle;
+        }
+        GLuint64 handle = glGetTextureSamplerHandleARB(m_textureID, sampler);
+        glMakeTextureHandleResidentARB(handle);
+        m_bindlessHandles.emplace_back(sampler, handle);
+        return handle;
+    }
+
+    std::shared_ptr<Texture> Texture::Stream(const std::string& path, Type type) {
+        return TextureStreamer::Get().Load(path, type);
+    }
+
+    void Texture::RequestResolution(float pixels) const {
+        // +1 so a request for a tiny object still counts as "seen"
+        uint32_t size = (uint32_t)std::clamp(pixels, 0.0f, 65535.0f) + 1;
+        uint32_t current = m_requestedSize.load(std::memory_order_relaxed);
+        while (size > current &&
+               !m_requestedSize.compare_exchange_weak(current, size, std::memory_order_relaxed)) {
+        }
+    }
+
     std::shared_ptr<Texture> Texture::CreateFromData(
         unsigned char* data, 
         int width, 
@@ -66,19 +146,20 @@ namespace Klein {
         int channels,
         Type type)
     {
-        auto texture = std::make_shared<Texture>("", type);
-        
-        glGenTextures(1, &texture->m_textureID);
-        glBindTexture(GL_TEXTURE_2D, texture->m_textureID);
-
-        GLenum format = channels == 4 ? GL_RGBA : GL_RGB;
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // Nothing to load from disk
+        std::shared_ptr<Texture> texture(new Texture("", type, DeferredLoad{}));
+        texture->m_width = width;
+        texture->m_height = height;
+        texture->m_channels = channels == 4 ? 4 : 3;
+
+        auto pixels = std::make_unique<TextureData>();
+        TextureLoader::FromPixels(data, width, height, texture->m_channels, *pixels);
+
+        if (RenderThread::HasContext()) {
+            texture->Upload(*pixels);
+        } else {
+            texture->m_pending = std::move(pixels);
+        }
 
         return texture;
     }
@@ -86,17 +167,65 @@ namespace Klein {
     // ===== Material Implementation =====
     Material::Material() {}
 
+    MaterialBlock Material::GetBlock() const {
+        MaterialBlock block;
+        block.albedo = albedo;
+        block.metallic = metallic;
+        block.roughness = roughness;
+        block.ao = ao;
+        block.useAlbedoMap = albedoMap ? 1 : 0;
+        return block;
+    }
+
+    void Material::BindUniforms(const MaterialBlock& block) const {
+        if (!m_gpu.buffer) {
+            m_gpu.buffer = std::make_unique<UniformBuffer>(sizeof(MaterialBlock));
+            m_gpu.buffer->SetData(&block, sizeof(block));
+            m_gpu.uploaded = block;
+        } else if (std::memcmp(&block, &m_gpu.uploaded, sizeof(block)) != 0) {
+            m_gpu.buffer->SetData(&block, sizeof(block));
+            m_gpu.uploaded = block;
+        }
+
+        m_gpu.buffer->Bind(UniformBinding::Material);
+    }
+
     // ===== Mesh Implementation =====
-    Mesh::Mesh(const std::vector<Vertex>& verts, const std::vector<unsigned int>& inds)
+    Mesh::Mesh(const std::vector<Vertex>& verts, const std::vector<unsigned int>& inds, bool keepCPUData)
         : vertices(verts), indices(inds)
+        , m_keepCPUData(keepCPUData)
+        , m_vertexCount((uint32_t)verts.size())
+        , m_indexCount((uint32_t)inds.size())
     {
-        SetupMesh();
+        ComputeBounds();
+
+        if (RenderThread::HasContext()) {
+            EnsureUploaded();
+        }
     }
 
     Mesh::~Mesh() {
-        glDeleteVertexArrays(1, &m_VAO);
-        glDeleteBuffers(1, &m_VBO);
-        glDeleteBuffers(1, &m_EBO);
+        if (!m_uploaded) return;
+
+        // May be the last reference dropped on the update thread
+        GLuint vao = m_VAO, vbo = m_VBO, ebo = m_EBO;
+        RenderThread::RunOnContext([vao, vbo, ebo] {
+            glDeleteVertexArrays(1, &vao);
+            glDeleteBuffers(1, &vbo);
+            glDeleteBuffers(1, &ebo);
+        });
+    }
+
+    void Mesh::EnsureUploaded() const {
+        if (m_uploaded) return;
+
+        // Lazy first-use upload; the GL names and CPU copies are logically part of it
+        Mesh* self = const_cast<Mesh*>(this);
+        self->SetupMesh();
+        self->m_uploaded = true;
+        if (!m_keepCPUData) {
+            self->ReleaseCPUData();
+        }
     }
 
     void Mesh::SetupMesh() {
@@ -132,15 +261,138 @@ namespace Klein {
         glEnableVertexAttribArray(4);
         glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
 
+        // Instance model matrix (one column per location), pointed at a buffer by BindInstanceBuffer
+        for (GLuint i = 0; i < 4; i++) {
+            glVertexAttribDivisor(kInstanceAttribLocation + i, 1);
+        }
+        glVertexAttribDivisor(kInstanceInfoAttribLocation, 1);
+
         glBindVertexArray(0);
     }
 
+    void Mesh::ComputeBounds() {
+        if (vertices.empty()) return;
+
+        m_boundsMin = m_boundsMax = vertices[0].position;
+        for (const auto& v : vertices) {
+            m_boundsMin = glm::min(m_boundsMin, v.position);
+            m_boundsMax = glm::max(m_boundsMax, v.position);
+        }
+
+        glm::vec3 center = GetBoundsCenter();
+        float radiusSq = 0.0f;
+        for (const auto& v : vertices) {
+            glm::vec3 d = v.position - center;
+            radiusSq = std::max(radiusSq, glm::dot(d, d));
+        }
+        m_boundsRadius = std::sqrt(radiusSq);
+    }
+
+    void Mesh::ReleaseCPUData() {
+        // Still needed for the deferred upload; dropped right after it
+        if (!m_uploaded) {
+            m_keepCPUData = false;
+            return;
+        }
+
+        // swap with empties so the capacity is actually returned
+        std::vector<Vertex>().swap(vertices);
+        std::vector<unsigned int>().swap(indices);
+    }
+
     void Mesh::Draw() const {
+        EnsureUploaded();
+        glBindVertexArray(m_VAO);
+        glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+    }
+
+    void Mesh::BindInstanceBuffer(GLuint buffer, GLintptr offset, GLsizei stride, bool withInfo) const {
+        EnsureUploaded();
+        glBindVertexArray(m_VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        for (GLuint i = 0; i < 4; i++) {
+            GLuint location = kInstanceAttribLocation + i;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride,
+                (void*)(offset + sizeof(glm::vec4) * i));
+        }
+        if (withInfo) {
+            glEnableVertexAttribArray(kInstanceInfoAttribLocation);
+            glVertexAttribIPointer(kInstanceInfoAttribLocation, 2, GL_UNSIGNED_INT, stride,
+                (void*)(offset + sizeof(glm::mat4)));
+        } else {
+            glDisableVertexAttribArray(kInstanceInfoAttribLocation);
+        }
+        glBindVertexArray(0);
+    }
+
+    void Mesh::DrawInstanced(GLsizei instanceCount) const {
+        EnsureUploaded();
         glBindVertexArray(m_VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElementsInstanced(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, 0, instanceCount);
         glBindVertexArray(0);
     }
 
+    void Mesh::GenerateLODs(int levelCount, float reduction) {
+        if (!HasCPUData()) {
+            KleinLogger::Logger::EngineWarn("Mesh::GenerateLODs needs CPU data; create the mesh with keepCPUData");
+            return;
+        }
+
+        m_lods.clear();
+
+        const std::vector<Vertex>* srcVertices = &vertices;
+        const std::vector<unsigned int>* srcIndices = &indices;
+
+        for (int level = 1; level <= levelCount; level++) {
+            size_t target = (size_t)(srcIndices->size() * reduction) / 3 * 3;
+            if (target < 3) break;
+
+            std::vector<Vertex> lodVertices;
+            std::vector<unsigned int> lodIndices;
+            if (!MeshSimplifier::Simplify(*srcVertices, *srcIndices, target, lodVertices, lodIndices)) {
+                break;
+            }
+
+            // Stop once the topology refuses to get meaningfully simpler
+            if (lodIndices.size() > srcIndices->size() * 9 / 10) {
+                break;
+            }
+
+            // Keep the level's data until the next one has been built from it
+            auto lod = std::make_shared<Mesh>(lodVertices, lodIndices, true);
+            m_lods.push_back({ lod, std::pow(0.5f, (float)level) });
+
+            srcVertices = &lod->vertices;
+            srcIndices = &lod->indices;
+        }
+
+        for (auto& lod : m_lods) {
+            lod.mesh->ReleaseCPUData();
+        }
+
+        KleinLogger::Logger::EngineLog("Generated %d LOD level(s) (%u -> %u triangles)",
+            (int)m_lods.size(), m_indexCount / 3,
+            m_lods.empty() ? m_indexCount / 3 : m_lods.back().mesh->GetIndexCount() / 3);
+    }
+
+    const Mesh* Mesh::GetLOD(int level) const {
+        if (level <= 0 || m_lods.empty()) return this;
+        level = std::min(level, (int)m_lods.size());
+        return m_lods[level - 1].mesh.get();
+    }
+
+    float Mesh::GetLODScreenSize(int level) const {
+        if (level <= 0 || level > (int)m_lods.size()) return 0.0f;
+        return m_lods[level - 1].screenSize;
+    }
+
+    void Mesh::SetLODScreenSize(int level, float screenSize) {
+        if (level <= 0 || level > (int)m_lods.size()) return;
+        m_lods[level - 1].screenSize = screenSize;
+    }
+
     // Primitive generators
     std::shared_ptr<Mesh> Mesh::CreateCube() {
         std::vector<Vertex> vertices = {
@@ -193,7 +445,10 @@ namespace Klein {
             }
         }
 
-        return std::make_shared<Mesh>(vertices, indices);
+        auto mesh = std::make_shared<Mesh>(vertices, indices, true);
+        mesh->GenerateLODs();
+        mesh->ReleaseCPUData();
+        return mesh;
     }
 
     std::shared_ptr<Mesh> Mesh::CreatePlane(float width, float height) {
@@ -0,0 +1,258 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace Klein {
+
+    namespace {
+
+        // Symmetric 4x4 error quadric, upper triangle only
+        struct Quadric {
+            double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+            double a11 = 0, a12 = 0, a13 = 0;
+            double a22 = 0, a23 = 0;
+            double a33 = 0;
+
+            void AddPlane(double a, double b, double c, double d, double w) {
+                a00 += w * a * a; a01 += w * a * b; a02 += w * a * c; a03 += w * a * d;
+                a11 += w * b * b; a12 += w * b * c; a13 += w * b * d;
+                a22 += w * c * c; a23 += w * c * d;
+                a33 += w * d * d;
+            }
+
+            Quadric& operator+=(const Quadric& o) {
+                a00 += o.a00; a01 += o.a01; a02 += o.a02; a03 += o.a03;
+                a11 += o.a11; a12 += o.a12; a13 += o.a13;
+                a22 += o.a22; a23 += o.a23;
+                a33 += o.a33;
+                return *this;
+            }
+
+            Quadric operator+(const Quadric& o) const {
+                Quadric q = *this;
+                q += o;
+                return q;
+            }
+
+            double Evaluate(const glm::vec3& p) const {
+                double x = p.x, y = p.y, z = p.z;
+                return a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x
+                     + a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y
+                     + a22 * z * z + 2.0 * a23 * z
+                     + a33;
+            }
+        };
+
+        struct Collapse {
+            double cost;
+            uint32_t from;
+            uint32_t to;
+            uint32_t fromVersion;
+            uint32_t toVersion;
+
+            bool operator>(const Collapse& other) const { return cost > other.cost; }
+        };
+
+        constexpr double kBorderWeight = 1000.0;
+
+        uint64_t EdgeKey(uint32_t a, uint32_t b) {
+            if (a > b) std::swap(a, b);
+            return (uint64_t(a) << 32) | uint64_t(b);
+        }
+
+    } // namespace
+
+    bool MeshSimplifier::Simplify(
+        const std::vector<Vertex>& vertices,
+        const std::vector<unsigned int>& indices,
+        size_t targetIndexCount,
+        std::vector<Vertex>& outVertices,
+        std::vector<unsigned int>& outIndices)
+    {
+        const size_t vertexCount = vertices.size();
+        const size_t triCount = indices.size() / 3;
+        const size_t targetTris = targetIndexCount / 3;
+
+        if (triCount == 0 || triCount <= targetTris) {
+            return false;
+        }
+
+        std::vector<uint32_t> tris(indices.begin(), indices.begin() + triCount * 3);
+        std::vector<bool> triDead(triCount, false);
+        std::vector<std::vector<uint32_t>> vertTris(vertexCount);
+        std::vector<Quadric> quadrics(vertexCount);
+        std::vector<uint32_t> version(vertexCount, 0);
+        std::vector<bool> removed(vertexCount, false);
+
+        auto position = [&](uint32_t v) -> const glm::vec3& { return vertices[v].position; };
+
+        // Face quadrics (area weighted) and edge use counts for border detection
+        std::unordered_map<uint64_t, uint32_t> edgeUse;
+        edgeUse.reserve(triCount * 3);
+
+        for (size_t t = 0; t < triCount; t++) {
+            uint32_t i0 = tris[t * 3 + 0], i1 = tris[t * 3 + 1], i2 = tris[t * 3 + 2];
+            vertTris[i0].push_back((uint32_t)t);
+            vertTris[i1].push_back((uint32_t)t);
+            vertTris[i2].push_back((uint32_t)t);
+
+            edgeUse[EdgeKey(i0, i1)]++;
+            edgeUse[EdgeKey(i1, i2)]++;
+            edgeUse[EdgeKey(i2, i0)]++;
+
+            glm::vec3 n = glm::cross(position(i1) - position(i0), position(i2) - position(i0));
+            float area2 = glm::length(n);
+            if (area2 <= 1e-12f) continue;
+            n /= area2;
+
+            double d = -glm::dot(n, position(i0));
+            Quadric q;
+            q.AddPlane(n.x, n.y, n.z, d, area2 * 0.5);
+            quadrics[i0] += q;
+            quadrics[i1] += q;
+            quadrics[i2] += q;
+        }
+
+        // Border edges get a constraint plane perpendicular to the face
+        for (size_t t = 0; t < triCount; t++) {
+            uint32_t ids[3] = { tris[t * 3 + 0], tris[t * 3 + 1], tris[t * 3 + 2] };
+            glm::vec3 faceN = glm::cross(position(ids[1]) - position(ids[0]), position(ids[2]) - position(ids[0]));
+            if (glm::length(faceN) <= 1e-12f) continue;
+            faceN = glm::normalize(faceN);
+
+            for (int e = 0; e < 3; e++) {
+                uint32_t a = ids[e], b = ids[(e + 1) % 3];
+                if (edgeUse[EdgeKey(a, b)] != 1) continue;
+
+                glm::vec3 edge = position(b) - position(a);
+                float len = glm::length(edge);
+                if (len <= 1e-12f) continue;
+
+                glm::vec3 n = glm::normalize(glm::cross(edge, faceN));
+                double d = -glm::dot(n, position(a));
+                Quadric q;
+                q.AddPlane(n.x, n.y, n.z, d, kBorderWeight * len * len);
+                quadrics[a] += q;
+                quadrics[b] += q;
+            }
+        }
+
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+
+        auto pushEdge = [&](uint32_t a, uint32_t b) {
+            Quadric q = quadrics[a] + quadrics[b];
+            double costAB = q.Evaluate(position(b)); // a collapses onto b
+            double costBA = q.Evaluate(position(a)); // b collapses onto a
+            if (costAB <= costBA) {
+                heap.push({ costAB, a, b, version[a], version[b] });
+            } else {
+                heap.push({ costBA, b, a, version[b], version[a] });
+            }
+        };
+
+        for (auto& [key, uses] : edgeUse) {
+            pushEdge(uint32_t(key >> 32), uint32_t(key & 0xffffffffu));
+        }
+        edgeUse.clear();
+
+        // Rejects collapses that would flip or degenerate a surviving triangle
+        auto collapseFlips = [&](uint32_t from, uint32_t to) {
+            for (uint32_t t : vertTris[from]) {
+                if (triDead[t]) continue;
+                uint32_t* tri = &tris[t * 3];
+                if (tri[0] == to || tri[1] == to || tri[2] == to) continue;
+
+                glm::vec3 p[3] = { position(tri[0]), position(tri[1]), position(tri[2]) };
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                if (glm::length(before) <= 1e-12f) continue;
+
+                for (int k = 0; k < 3; k++) {
+                    if (tri[k] == from) p[k] = position(to);
+                }
+                glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+                if (glm::length(after) <= 1e-12f) return true;
+                if (glm::dot(glm::normalize(before), glm::normalize(after)) < 0.2f) return true;
+            }
+            return false;
+        };
+
+        size_t aliveTris = triCount;
+        std::vector<uint32_t> neighbours;
+
+        while (aliveTris > targetTris && !heap.empty()) {
+            Collapse c = heap.top();
+            heap.pop();
+
+            if (removed[c.from] || removed[c.to]) continue;
+            if (version[c.from] != c.fromVersion || version[c.to] != c.toVersion) continue;
+            if (collapseFlips(c.from, c.to)) continue;
+
+            // Move every triangle of 'from' onto 'to', dropping the ones that span the edge
+            for (uint32_t t : vertTris[c.from]) {
+                if (triDead[t]) continue;
+                uint32_t* tri = &tris[t * 3];
+                if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) {
+                    triDead[t] = true;
+                    aliveTris--;
+                    continue;
+                }
+                for (int k = 0; k < 3; k++) {
+                    if (tri[k] == c.from) tri[k] = c.to;
+                }
+                vertTris[c.to].push_back(t);
+            }
+
+            removed[c.from] = true;
+            vertTris[c.from].clear();
+            vertTris[c.from].shrink_to_fit();
+            quadrics[c.to] += quadrics[c.from];
+            version[c.to]++;
+
+            // Drop dead triangles from the survivor and requeue its edges
+            auto& toTris = vertTris[c.to];
+            toTris.erase(std::remove_if(toTris.begin(), toTris.end(),
+                [&](uint32_t t) { return triDead[t]; }), toTris.end());
+
+            neighbours.clear();
+            for (uint32_t t : toTris) {
+                for (int k = 0; k < 3; k++) {
+                    uint32_t v = tris[t * 3 + k];
+                    if (v != c.to) neighbours.push_back(v);
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+            for (uint32_t n : neighbours) {
+                pushEdge(c.to, n);
+            }
+        }
+
+        if (aliveTris == triCount) {
+            return false;
+        }
+
+        // Compact the surviving vertices
+        std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+        outVertices.clear();
+        outIndices.clear();
+        outIndices.reserve(aliveTris * 3);
+
+        for (size_t t = 0; t < triCount; t++) {
+            if (triDead[t]) continue;
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = tris[t * 3 + k];
+                if (remap[v] == UINT32_MAX) {
+                    remap[v] = (uint32_t)outVertices.size();
+                    outVertices.push_back(vertices[v]);
+                }
+                outIndices.push_back(remap[v]);
+            }
+        }
+
+        return !outIndices.empty();
+    }
+
+} // namespace Klein
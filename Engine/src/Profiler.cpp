@@ -0,0 +1,160 @@
+#include "Profiler.h"
+#include "Logger.h"
+#include <chrono>
+#include <cstdio>
+
+namespace Klein {
+
+    namespace {
+
+        // Names are literals from our own code, but a stray quote would break the file
+        void WriteEscaped(std::FILE* file, const char* text) {
+            for (const char* c = text; *c; c++) {
+                if (*c == '"' || *c == '\\') std::fputc('\\', file);
+                std::fputc(*c, file);
+            }
+        }
+
+    } // namespace
+
+    Profiler& Profiler::Get() {
+        static Profiler instance;
+        return instance;
+    }
+
+    uint64_t Profiler::Now() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void Profiler::RequestCapture(uint32_t frames, const std::string& path) {
+#ifndef KLEIN_PROFILER_ENABLED
+        KleinLogger::Logger::EngineWarn("Profiler capture requested, but the engine was built without "
+            "KLEIN_PROFILER_ENABLED");
+#endif
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requestedFrames = frames;
+        m_requestedPath = path;
+    }
+
+    void Profiler::NewFrame() {
+        if (s_capturing.load(std::memory_order_relaxed)) {
+            if (++m_capturedFrames < m_captureFrames) return;
+
+            // Zones still open finish into the buffers but aren't part of this trace
+            s_capturing.store(false, std::memory_order_relaxed);
+            WriteTrace();
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_requestedFrames == 0) return;
+
+        m_captureFrames = m_requestedFrames;
+        m_capturePath = m_requestedPath;
+        m_capturedFrames = 0;
+        m_requestedFrames = 0;
+        m_captureStart = Now();
+
+        // Threads reset their own buffers when they see the new generation
+        m_generation.fetch_add(1, std::memory_order_release);
+        s_capturing.store(true, std::memory_order_relaxed);
+    }
+
+    void Profiler::FinishCapture() {
+        if (!s_capturing.load(std::memory_order_relaxed)) return;
+
+        s_capturing.store(false, std::memory_order_relaxed);
+        m_captureFrames = m_capturedFrames;
+        WriteTrace();
+    }
+
+    void Profiler::SetThreadName(const std::string& name) {
+        s_threadName = name;
+        if (s_threadBuffer) {
+            std::lock_guard<std::mutex> lock(Get().m_mutex);
+            s_threadBuffer->name = name;
+        }
+    }
+
+    void Profiler::Record(const char* name, uint64_t start, uint64_t end) {
+        ThreadBuffer* buffer = s_threadBuffer ? s_threadBuffer : RegisterThread();
+
+        uint32_t generation = m_generation.load(std::memory_order_acquire);
+        if (buffer->generation.load(std::memory_order_relaxed) != generation) {
+            // Cleared before the generation is published, so the exporter never pairs
+            // the new generation with the old count
+            buffer->count.store(0, std::memory_order_relaxed);
+            buffer->dropped.store(0, std::memory_order_relaxed);
+            buffer->generation.store(generation, std::memory_order_release);
+        }
+
+        uint32_t count = buffer->count.load(std::memory_order_relaxed);
+        if (count >= kZonesPerThread) {
+            buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer->zones[count] = { name, start, end };
+        buffer->count.store(count + 1, std::memory_order_release);
+    }
+
+    Profiler::ThreadBuffer* Profiler::RegisterThread() {
+        auto buffer = std::make_unique<ThreadBuffer>();
+        buffer->zones = std::make_unique<Zone[]>(kZonesPerThread);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        buffer->id = (uint32_t)m_threads.size() + 1;
+        buffer->name = s_threadName.empty() ? "Thread " + std::to_string(buffer->id) : s_threadName;
+        m_threads.push_back(std::move(buffer));
+
+        s_threadBuffer = m_threads.back().get();
+        return s_threadBuffer;
+    }
+
+    void Profiler::WriteTrace() {
+        std::FILE* file = std::fopen(m_capturePath.c_str(), "wb");
+        if (!file) {
+            KleinLogger::Logger::EngineError("Failed to write profiler trace: %s", m_capturePath.c_str());
+            return;
+        }
+
+        uint32_t generation = m_generation.load(std::memory_order_relaxed);
+        size_t zoneCount = 0;
+        uint32_t dropped = 0;
+        bool first = true;
+
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& buffer : m_threads) {
+            std::fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+                first ? "" : ",", buffer->id);
+            WriteEscaped(file, buffer->name.c_str());
+            std::fputs("\"}}", file);
+            first = false;
+
+            // Threads that recorded nothing during this capture
+            if (buffer->generation.load(std::memory_order_acquire) != generation) continue;
+
+            uint32_t count = buffer->count.load(std::memory_order_acquire);
+            for (uint32_t i = 0; i < count; i++) {
+                // Opened during the previous capture
+                const Zone& zone = buffer->zones[i];
+                if (zone.start < m_captureStart) continue;
+                std::fputs(",\n{\"name\":\"", file);
+                WriteEscaped(file, zone.name);
+                std::fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", buffer->id,
+                    (double)(zone.start - m_captureStart) / 1000.0, (double)(zone.end - zone.start) / 1000.0);
+                zoneCount++;
+            }
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+        }
+        std::fputs("\n]}\n", file);
+        std::fclose(file);
+
+        KleinLogger::Logger::EngineLog("Profiler trace written: %s (%u frames, %zu zones)",
+            m_capturePath.c_str(), m_captureFrames, zoneCount);
+        if (dropped > 0) {
+            KleinLogger::Logger::EngineWarn("Profiler dropped %u zones; a thread filled its buffer", dropped);
+        }
+    }
+
+} // namespace Klein
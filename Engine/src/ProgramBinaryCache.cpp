@@ -0,0 +1,161 @@
+#include "ProgramBinaryCache.h"
+#include "Logger.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace Klein {
+
+    namespace {
+        constexpr uint32_t kMagic = 0x4350424B; // "KBPC"
+        constexpr uint32_t kFormatVersion = 1;
+        // Far above any real program binary; larger lengths mean a damaged entry
+        constexpr uint32_t kMaxBinaryLength = 64u << 20;
+
+        struct FileHeader {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t key;
+            uint32_t binaryFormat;
+            uint32_t length;
+        };
+
+        // 64-bit FNV-1a, chained through 'hash'
+        uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+            const auto* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++) {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+            return hash;
+        }
+
+        uint64_t HashString(const std::string& text, uint64_t hash) {
+            // Include the terminator so "ab"+"c" and "a"+"bc" differ
+            return HashBytes(text.c_str(), text.size() + 1, hash);
+        }
+    }
+
+    ProgramBinaryCache& ProgramBinaryCache::Get() {
+        static ProgramBinaryCache instance;
+        return instance;
+    }
+
+    void ProgramBinaryCache::SetDirectory(const std::string& directory) {
+        m_directory = directory;
+        m_enabled = false;
+        if (directory.empty()) return;
+
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if (formats == 0) {
+            KleinLogger::Logger::EngineWarn("Driver exposes no program binary formats, shader cache disabled");
+            return;
+        }
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error) {
+            KleinLogger::Logger::EngineWarn("Cannot create shader cache directory %s: %s",
+                directory.c_str(), error.message().c_str());
+            return;
+        }
+
+        uint64_t hash = 14695981039346656037ull;
+        for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+            const char* value = reinterpret_cast<const char*>(glGetString(name));
+            hash = HashString(value ? value : "", hash);
+        }
+        m_driverHash = hash;
+        m_enabled = true;
+    }
+
+    uint64_t ProgramBinaryCache::MakeKey(const std::string& vertexSrc, const std::string& fragmentSrc) const {
+        uint64_t hash = HashBytes(&m_driverHash, sizeof(m_driverHash));
+        hash = HashString(vertexSrc, hash);
+        return HashString(fragmentSrc, hash);
+    }
+
+    std::string ProgramBinaryCache::GetPath(uint64_t key) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+        return (std::filesystem::path(m_directory) / name).string();
+    }
+
+    bool ProgramBinaryCache::Load(uint64_t key, GLuint program) {
+        if (!m_enabled) return false;
+
+        std::string path = GetPath(key);
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+
+        FileHeader header{};
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            header.magic != kMagic || header.version != kFormatVersion || header.key != key) {
+            return false;
+        }
+
+        // The length comes from the file, so check it against what's really there
+        // before allocating; a truncated or damaged entry is a miss and is removed
+        std::error_code error;
+        uintmax_t fileSize = std::filesystem::file_size(path, error);
+        if (error || header.length == 0 || header.length > kMaxBinaryLength ||
+            fileSize - sizeof(header) != header.length) {
+            KleinLogger::Logger::EngineWarn("Shader cache entry %s is damaged, recompiling", path.c_str());
+            file.close();
+            std::filesystem::remove(path, error);
+            return false;
+        }
+
+        std::vector<char> binary(header.length);
+        if (!file.read(binary.data(), binary.size())) {
+            return false;
+        }
+
+        glProgramBinary(program, (GLenum)header.binaryFormat, binary.data(), (GLsizei)binary.size());
+
+        GLint linked = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            KleinLogger::Logger::EngineWarn("Cached program binary %016llx rejected by the driver, recompiling",
+                (unsigned long long)key);
+            return false;
+        }
+        return true;
+    }
+
+    void ProgramBinaryCache::Store(uint64_t key, GLuint program) {
+        if (!m_enabled) return;
+
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+
+        std::vector<char> binary(length);
+        GLenum binaryFormat = 0;
+        GLsizei written = 0;
+        glGetProgramBinary(program, length, &written, &binaryFormat, binary.data());
+        if (written <= 0) return;
+
+        FileHeader header{ kMagic, kFormatVersion, key, (uint32_t)binaryFormat, (uint32_t)written };
+
+        // Write to a temporary name first so a crash can't leave a truncated entry behind
+        std::string path = GetPath(key);
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+                !file.write(binary.data(), written)) {
+                KleinLogger::Logger::EngineWarn("Failed to write shader cache entry %s", tempPath.c_str());
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, path, error);
+        if (error) {
+            std::filesystem::remove(tempPath, error);
+        }
+    }
+
+} // namespace Klein
@@ -0,0 +1,242 @@
+#include "RegionFile.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <lz4.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace Klein {
+
+    namespace {
+
+        bool Seek(std::FILE* file, uint64_t offset) {
+#ifdef _WIN32
+            return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#else
+            return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+        }
+
+        uint64_t FileSize(std::FILE* file) {
+#ifdef _WIN32
+            _fseeki64(file, 0, SEEK_END);
+            return (uint64_t)_ftelli64(file);
+#else
+            fseeko(file, 0, SEEK_END);
+            return (uint64_t)ftello(file);
+#endif
+        }
+
+    } // namespace
+
+    std::unique_ptr<RegionFile> RegionFile::Open(const std::string& path, bool create) {
+        std::error_code error;
+        if (!std::filesystem::exists(path, error)) {
+            if (!create) return nullptr;
+
+            // Header plus an empty offset table, padded to whole sectors
+            std::FILE* file = std::fopen(path.c_str(), "wb");
+            Header header = { { 'K', 'R', 'G', 'N' }, kVersion, (uint32_t)kEntryCount, 0 };
+            std::vector<char> zeros(kHeaderSectors * kSectorSize - sizeof(Header), 0);
+            bool written = file && std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                           std::fwrite(zeros.data(), zeros.size(), 1, file) == 1;
+            if (file && std::fclose(file) != 0) written = false;
+            if (!written) {
+                KleinLogger::Logger::EngineError("Failed to create region file: %s", path.c_str());
+                return nullptr;
+            }
+        }
+
+        std::unique_ptr<RegionFile> region(new RegionFile());
+        region->m_file = std::fopen(path.c_str(), "r+b");
+        if (!region->m_file || !region->Load()) {
+            KleinLogger::Logger::EngineError("Failed to open region file: %s", path.c_str());
+            return nullptr;
+        }
+        return region;
+    }
+
+    RegionFile::~RegionFile() {
+        if (!m_file) return;
+        if (!Flush()) {
+            KleinLogger::Logger::EngineError("Failed to flush a region file; its last writes are lost");
+        }
+        std::fclose(m_file);
+    }
+
+    bool RegionFile::Load() {
+        Header header;
+        if (!Seek(m_file, 0) || std::fread(&header, sizeof(header), 1, m_file) != 1 ||
+            std::fread(m_entries, sizeof(m_entries), 1, m_file) != 1 ||
+            std::memcmp(header.magic, "KRGN", 4) != 0 || header.version != kVersion ||
+            header.entryCount != (uint32_t)kEntryCount) {
+            return false;
+        }
+
+        uint64_t fileSize = FileSize(m_file);
+        m_sectorCount = std::max(kHeaderSectors, (uint32_t)((fileSize + kSectorSize - 1) / kSectorSize));
+        m_usedSectors.assign(m_sectorCount, false);
+        MarkSectors(0, kHeaderSectors, true);
+
+        // Entries pointing past the end (a write cut short) are treated as never written
+        for (Entry& entry : m_entries) {
+            if (entry.sectorCount == 0) continue;
+            if (entry.sector < kHeaderSectors || entry.sector + entry.sectorCount > m_sectorCount) {
+                entry = Entry();
+                continue;
+            }
+            MarkSectors(entry.sector, entry.sectorCount, true);
+        }
+        return true;
+    }
+
+    bool RegionFile::Read(int x, int z, std::vector<uint8_t>& out) {
+        const Entry& entry = m_entries[Slot(x, z)];
+        if (entry.sectorCount == 0) return false;
+
+        // Sizes come from the file, so a damaged entry mustn't drive the allocations
+        size_t storedLimit = entry.compression == Compression::LZ4
+            ? (size_t)LZ4_compressBound((int)kMaxPayloadSize) : kMaxPayloadSize;
+        if (entry.rawSize > kMaxPayloadSize || entry.storedSize > storedLimit ||
+            entry.storedSize > (size_t)entry.sectorCount * kSectorSize) {
+            return false;
+        }
+
+        m_compressed.resize(entry.storedSize);
+        if (!Seek(m_file, (uint64_t)entry.sector * kSectorSize) ||
+            std::fread(m_compressed.data(), 1, entry.storedSize, m_file) != entry.storedSize) {
+            std::clearerr(m_file);
+            return false;
+        }
+
+        out.resize(entry.rawSize);
+        if (entry.compression == Compression::LZ4) {
+            int decoded = LZ4_decompress_safe(m_compressed.data(), reinterpret_cast<char*>(out.data()),
+                                              (int)entry.storedSize, (int)entry.rawSize);
+            return decoded == (int)entry.rawSize;
+        }
+        if (entry.storedSize != entry.rawSize) return false;
+        std::memcpy(out.data(), m_compressed.data(), entry.rawSize);
+        return true;
+    }
+
+    bool RegionFile::Write(int x, int z, const uint8_t* data, size_t size) {
+        if (size > kMaxPayloadSize) return false;
+
+        // Stored raw when LZ4 doesn't make it smaller
+        m_compressed.resize((size_t)LZ4_compressBound((int)size));
+        int compressedSize = LZ4_compress_default(reinterpret_cast<const char*>(data), m_compressed.data(),
+                                                  (int)size, (int)m_compressed.size());
+        Compression compression = Compression::LZ4;
+        const char* payload = m_compressed.data();
+        size_t storedSize = (size_t)compressedSize;
+        if (compressedSize <= 0 || (size_t)compressedSize >= size) {
+            compression = Compression::None;
+            payload = reinterpret_cast<const char*>(data);
+            storedSize = size;
+        }
+
+        // Always a free run: the run the header still points at stays intact until
+        // Flush has committed the new entry
+        auto sectors = (uint32_t)std::max<size_t>(1, (storedSize + kSectorSize - 1) / kSectorSize);
+        uint32_t sector = Allocate(sectors);
+        if (!Seek(m_file, (uint64_t)sector * kSectorSize) ||
+            std::fwrite(payload, 1, storedSize, m_file) != storedSize) {
+            std::clearerr(m_file);
+            MarkSectors(sector, sectors, false);
+            return false;
+        }
+
+        int slot = Slot(x, z);
+        Entry& entry = m_entries[slot];
+        bool dirty = std::find(m_dirtySlots.begin(), m_dirtySlots.end(), slot) != m_dirtySlots.end();
+        if (entry.sectorCount != 0) {
+            // A run written since the last flush was never committed, so nothing points at it
+            if (dirty) {
+                MarkSectors(entry.sector, entry.sectorCount, false);
+            } else {
+                m_replacedRuns.push_back({ entry.sector, entry.sectorCount });
+            }
+        }
+        if (!dirty) {
+            m_dirtySlots.push_back(slot);
+        }
+
+        entry.sector = sector;
+        entry.sectorCount = (uint16_t)sectors;
+        entry.compression = compression;
+        entry.storedSize = (uint32_t)storedSize;
+        entry.rawSize = (uint32_t)size;
+        return true;
+    }
+
+    bool RegionFile::Flush() {
+        if (m_dirtySlots.empty()) {
+            return std::fflush(m_file) == 0;
+        }
+
+        // Payloads reach the disk before any entry pointing at them
+        if (!Sync()) return false;
+
+        // Only the changed slots' table entries are rewritten
+        for (int slot : m_dirtySlots) {
+            if (!Seek(m_file, sizeof(Header) + sizeof(Entry) * (uint64_t)slot) ||
+                std::fwrite(&m_entries[slot], sizeof(Entry), 1, m_file) != 1) {
+                std::clearerr(m_file);
+                return false;
+            }
+        }
+        if (!Sync()) return false;
+
+        for (const FreedRun& run : m_replacedRuns) {
+            MarkSectors(run.sector, run.count, false);
+        }
+        m_dirtySlots.clear();
+        m_replacedRuns.clear();
+        return true;
+    }
+
+    bool RegionFile::Sync() {
+        if (std::fflush(m_file) != 0) {
+            std::clearerr(m_file);
+            return false;
+        }
+#ifdef _WIN32
+        return _commit(_fileno(m_file)) == 0;
+#else
+        return fsync(fileno(m_file)) == 0;
+#endif
+    }
+
+    uint32_t RegionFile::Allocate(uint32_t sectors) {
+        // First free run that fits, otherwise the end of the file
+        uint32_t runStart = kHeaderSectors;
+        for (uint32_t sector = kHeaderSectors; sector < m_sectorCount; sector++) {
+            if (m_usedSectors[sector]) {
+                runStart = sector + 1;
+            } else if (sector + 1 - runStart == sectors) {
+                MarkSectors(runStart, sectors, true);
+                return runStart;
+            }
+        }
+
+        // A free run at the end is extended rather than skipped
+        uint32_t first = std::min(runStart, m_sectorCount);
+        m_sectorCount = std::max(m_sectorCount, first + sectors);
+        m_usedSectors.resize(m_sectorCount, false);
+        MarkSectors(first, sectors, true);
+        return first;
+    }
+
+    void RegionFile::MarkSectors(uint32_t first, uint32_t count, bool used) {
+        for (uint32_t i = 0; i < count; i++) {
+            m_usedSectors[first + i] = used;
+        }
+    }
+
+} // namespace Klein
@@ -0,0 +1,192 @@
+#include "RegionStore.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <filesystem>
+
+namespace Klein {
+
+    namespace {
+
+        int FloorDiv(int value, int divisor) {
+            return (value >= 0 ? value : value - divisor + 1) / divisor;
+        }
+
+    } // namespace
+
+    RegionStore::RegionStore(const std::string& directory)
+        : m_directory(directory)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error) {
+            KleinLogger::Logger::EngineError("Failed to create save directory %s: %s",
+                directory.c_str(), error.message().c_str());
+        }
+        m_thread = std::thread(&RegionStore::ThreadMain, this);
+    }
+
+    RegionStore::~RegionStore() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopRequested = true;
+        }
+        m_condition.notify_one();
+        m_thread.join();
+    }
+
+    glm::ivec3 RegionStore::ToRegionCoord(const glm::ivec3& chunkCoord) {
+        return { FloorDiv(chunkCoord.x, RegionFile::kSize), chunkCoord.y, FloorDiv(chunkCoord.z, RegionFile::kSize) };
+    }
+
+    bool RegionStore::LoadChunk(const glm::ivec3& chunkCoord, VoxelChunk& out) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_pending.find(chunkCoord);
+            if (it != m_pending.end()) {
+                out = *it->second;
+                return true;
+            }
+        }
+
+        // Waits at most for the one chunk the save thread is writing
+        std::lock_guard<std::mutex> lock(m_fileMutex);
+        glm::ivec3 regionCoord = ToRegionCoord(chunkCoord);
+        RegionFile* region = GetRegion(regionCoord, false);
+        if (!region) return false;
+
+        int x = chunkCoord.x - regionCoord.x * RegionFile::kSize;
+        int z = chunkCoord.z - regionCoord.z * RegionFile::kSize;
+        if (!region->Has(x, z)) return false;
+        if (!region->Read(x, z, m_loadBuffer) || !out.Deserialize(m_loadBuffer.data(), m_loadBuffer.size())) {
+            KleinLogger::Logger::EngineWarn("Chunk (%d, %d, %d) is damaged in its region file",
+                chunkCoord.x, chunkCoord.y, chunkCoord.z);
+            return false;
+        }
+        return true;
+    }
+
+    void RegionStore::SaveChunks(std::vector<ChunkSnapshot> chunks) {
+        if (chunks.empty()) return;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (ChunkSnapshot& chunk : chunks) {
+                m_pending[chunk.first] = chunk.second;
+                m_queue.push_back(std::move(chunk));
+            }
+        }
+        m_condition.notify_one();
+    }
+
+    void RegionStore::Flush() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_queue.empty() && !m_writing; });
+    }
+
+    void RegionStore::TakeSaveResults(std::vector<SaveResult>& out) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        out.insert(out.end(), m_results.begin(), m_results.end());
+        m_results.clear();
+    }
+
+    size_t RegionStore::GetQueuedCount() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_pending.size();
+    }
+
+    void RegionStore::ThreadMain() {
+        KLEIN_PROFILE_THREAD("Region Saver");
+        std::vector<ChunkSnapshot> batch;
+        std::vector<SaveResult> results;
+        std::vector<glm::ivec3> failedRegions;
+        std::vector<uint8_t> buffer;
+
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this] { return m_stopRequested || !m_queue.empty(); });
+                if (m_queue.empty()) break;    // Stop requested and nothing left to write
+                batch.swap(m_queue);
+                m_writing = true;
+            }
+
+            KLEIN_PROFILE_SCOPE("RegionStore::WriteBatch");
+            for (const ChunkSnapshot& chunk : batch) {
+                // A newer snapshot of this chunk is queued behind this one
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    auto it = m_pending.find(chunk.first);
+                    if (it == m_pending.end() || it->second != chunk.second) continue;
+                }
+
+                chunk.second->Serialize(buffer);
+                glm::ivec3 regionCoord = ToRegionCoord(chunk.first);
+                bool written = false;
+                {
+                    std::lock_guard<std::mutex> lock(m_fileMutex);
+                    if (RegionFile* region = GetRegion(regionCoord, true)) {
+                        written = region->Write(chunk.first.x - regionCoord.x * RegionFile::kSize,
+                                                chunk.first.z - regionCoord.z * RegionFile::kSize,
+                                                buffer.data(), buffer.size());
+                    }
+                }
+                results.push_back({ chunk.first, chunk.second.get(), written });
+                if (!written) {
+                    // Stays pending so loads still see it until it's saved again
+                    KleinLogger::Logger::EngineError("Failed to save chunk (%d, %d, %d)",
+                        chunk.first.x, chunk.first.y, chunk.first.z);
+                    continue;
+                }
+
+                // The region file returns the written data until it's flushed
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto it = m_pending.find(chunk.first);
+                if (it != m_pending.end() && it->second == chunk.second) {
+                    m_pending.erase(it);
+                }
+            }
+            batch.clear();
+
+            {
+                std::lock_guard<std::mutex> lock(m_fileMutex);
+                for (auto& [coord, region] : m_regions) {
+                    if (!region->Flush()) {
+                        KleinLogger::Logger::EngineError("Failed to flush region (%d, %d, %d); retrying with the next batch",
+                            coord.x, coord.y, coord.z);
+                        failedRegions.push_back(coord);
+                    }
+                }
+            }
+
+            // Only durable writes count as saved
+            for (SaveResult& result : results) {
+                if (result.saved && std::find(failedRegions.begin(), failedRegions.end(),
+                                              ToRegionCoord(result.coord)) != failedRegions.end()) {
+                    result.saved = false;
+                }
+                if (result.saved) {
+                    m_savedCount.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            failedRegions.clear();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_results.insert(m_results.end(), results.begin(), results.end());
+            results.clear();
+            m_writing = false;
+            m_idle.notify_all();
+        }
+    }
+
+    RegionFile* RegionStore::GetRegion(const glm::ivec3& regionCoord, bool create) {
+        auto it = m_regions.find(regionCoord);
+        if (it != m_regions.end()) return it->second.get();
+
+        std::string name = "r." + std::to_string(regionCoord.x) + "." + std::to_string(regionCoord.y) + "." +
+                           std::to_string(regionCoord.z) + ".kreg";
+        auto region = RegionFile::Open((std::filesystem::path(m_directory) / name).string(), create);
+        if (!region) return nullptr;
+        return m_regions.emplace(regionCoord, std::move(region)).first->second.get();
+    }
+
+} // namespace Klein
@@ -0,0 +1,122 @@
+#include "RenderThread.h"
+#include "Renderer.h"
+#include "Window.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include <GLFW/glfw3.h>
+
+namespace Klein {
+
+    RenderThread::RenderThread(Window* window, Renderer* renderer)
+        : m_window(window)
+        , m_renderer(renderer)
+    {}
+
+    RenderThread::~RenderThread() {
+        Stop();
+    }
+
+    void RenderThread::Start() {
+        if (m_running) return;
+
+        // A context can only be current on one thread at a time
+        glfwMakeContextCurrent(nullptr);
+
+        m_stopRequested = false;
+        m_running = true;
+        m_thread = std::thread(&RenderThread::ThreadMain, this);
+        KleinLogger::Logger::EngineLog("Render thread started");
+    }
+
+    void RenderThread::Stop() {
+        if (!m_running) return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopRequested = true;
+        }
+        m_condition.notify_all();
+        m_thread.join();
+        m_running = false;
+
+        // Take the context back so shutdown can release GL objects
+        glfwMakeContextCurrent(m_window->GetNativeWindow());
+        ExecutePendingTasks();
+        KleinLogger::Logger::EngineLog("Render thread stopped");
+    }
+
+    FrameSnapshot& RenderThread::BeginFrame() {
+        // Rendered two submissions ago; SubmitFrame has already waited for it
+        FrameSnapshot& snapshot = m_snapshots[m_writeIndex];
+        snapshot.Clear();
+        return snapshot;
+    }
+
+    void RenderThread::SubmitFrame() {
+        // Time spent here is the update thread waiting on the render thread
+        KLEIN_PROFILE_SCOPE("RenderThread::SubmitFrame");
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this] { return m_pending == nullptr; });
+        m_pending = &m_snapshots[m_writeIndex];
+        m_writeIndex ^= 1;
+        lock.unlock();
+        m_condition.notify_all();
+    }
+
+    void RenderThread::ThreadMain() {
+        KLEIN_PROFILE_THREAD("Render");
+        glfwMakeContextCurrent(m_window->GetNativeWindow());
+
+        while (true) {
+            FrameSnapshot* snapshot = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this] { return m_pending != nullptr || m_stopRequested; });
+                if (!m_pending) break; // Only exits once the last submitted frame is drawn
+                snapshot = m_pending;
+            }
+
+            m_renderer->Clear();
+            m_renderer->RenderFrame(*snapshot);
+            if (m_uiCallback) {
+                m_uiCallback();
+            }
+            m_window->SwapBuffers();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pending = nullptr;
+            }
+            m_condition.notify_all();
+        }
+
+        ExecutePendingTasks();
+        glfwMakeContextCurrent(nullptr);
+    }
+
+    bool RenderThread::HasContext() {
+        return glfwGetCurrentContext() != nullptr;
+    }
+
+    void RenderThread::RunOnContext(std::function<void()> task) {
+        if (HasContext()) {
+            task();
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(s_taskMutex);
+        s_tasks.push_back(std::move(task));
+    }
+
+    void RenderThread::ExecutePendingTasks() {
+        std::vector<std::function<void()>> tasks;
+        {
+            std::lock_guard<std::mutex> lock(s_taskMutex);
+            tasks.swap(s_tasks);
+        }
+        for (auto& task : tasks) {
+            task();
+        }
+    }
+
+} // namespace Klein
@@ -2,11 +2,27 @@
 #include "Renderer.h"
 #include "Logger.h"
 #include "Shader.h"
+#include "JobSystem.h"
+#include "TextureStreamer.h"
+#include "MaterialTable.h"
+#include "SamplerCache.h"
+#include "Profiler.h"
+#include "RenderThread.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 
 namespace Klein {
 
+    namespace {
+        // Streamed textures that aren't resident yet are drawn as if absent
+        const Texture* IfReady(const Texture* texture) {
+            return texture && texture->IsReady() ? texture : nullptr;
+        }
+    }
+
     Renderer::Renderer() {}
 
     Renderer::~Renderer() {
@@ -23,12 +39,49 @@ namespace Klein {
         // Create default material
         m_defaultMaterial = std::make_shared<Material>();
 
+        // Per-frame upload space for instance data, uniform blocks and other dynamic geometry
+        m_dynamicBuffer = std::make_unique<RingBuffer>(kDynamicBufferFrameSize);
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &m_uniformBufferAlignment);
+
+        m_clusteredLighting = std::make_unique<ClusteredLighting>();
+        m_shadowMapper = std::make_unique<ShadowMapper>();
+        m_hiZ = std::make_unique<HiZBuffer>();
+        m_gpuSupported = GPUScene::IsSupported();
+        if (m_gpuSupported) {
+            m_gpuScene = std::make_unique<GPUScene>();
+        }
+        if (MaterialTable::IsSupported()) {
+            m_materialTable = std::make_unique<MaterialTable>();
+        }
+        glGenQueries(kOverdrawQueryCount, m_overdrawQueries);
+
         KleinLogger::Logger::EngineLog("Renderer initialized");
     }
 
     void Renderer::Shutdown() {
         m_defaultCubeMesh.reset();
         m_defaultMaterial.reset();
+        m_dynamicBuffer.reset();
+        m_clusteredLighting.reset();
+        m_shadowMapper.reset();
+        m_hiZ.reset();
+        m_gpuScene.reset();
+        m_materialTable.reset();
+        TextureStreamer::Get().Shutdown();
+        SamplerCache::Get().Clear();
+        ShaderLibrary::Get().Clear();
+        m_gpuEntities.clear();
+        m_gpuObjects.clear();
+        m_cpuRenderables.clear();
+        m_cpuRenderableIndices.clear();
+        m_trackedScene = nullptr;
+        m_immediateSnapshot.Clear();
+        m_drawItems.clear();
+        if (m_overdrawQueries[0]) {
+            glDeleteQueries(kOverdrawQueryCount, m_overdrawQueries);
+            std::fill(std::begin(m_overdrawQueries), std::end(m_overdrawQueries), 0u);
+        }
+        RenderThread::ExecutePendingTasks();
         KleinLogger::Logger::EngineLog("Renderer shutdown");
     }
 
@@ -38,9 +91,23 @@ namespace Klein {
     }
 
     void Renderer::RenderScene(Scene* scene, float aspectRatio) {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        ExtractFrame(scene, aspectRatio, viewport[2], viewport[3], m_immediateSnapshot);
+        RenderFrame(m_immediateSnapshot);
+    }
+
+    void Renderer::ExtractFrame(Scene* scene, float aspectRatio, int viewportWidth, int viewportHeight,
+                                FrameSnapshot& out) {
+        KLEIN_PROFILE_SCOPE("Renderer::ExtractFrame");
+        out.Clear();
         if (!scene) return;
 
-        ResetStats();
+        m_frameIndex++;
+
+        // Before the camera check, so entities still enter and leave the GPU scene
+        SyncRenderables(scene, out);
 
         // Get primary camera
         Entity cameraEntity = scene->GetPrimaryCamera();
@@ -53,31 +120,206 @@ namespace Klein {
         auto& camTransform = cameraEntity.GetComponent<TransformComponent>();
 
         // Calculate view and projection matrices
-        glm::mat4 view = glm::lookAt(
+        out.hasCamera = true;
+        out.camera = camera;
+        out.view = glm::lookAt(
             camTransform.position,
             camTransform.position + camTransform.GetForward(),
             camTransform.GetUp()
         );
-        glm::mat4 projection = camera.GetProjection(aspectRatio);
+        out.projection = camera.GetProjection(aspectRatio);
+        out.cameraPosition = camTransform.position;
+        out.aspectRatio = aspectRatio;
+        out.viewportWidth = viewportWidth;
+        out.viewportHeight = viewportHeight;
+
+        m_lodProjScale = out.projection[1][1];
+        m_lodViewportHeight = (float)viewportHeight;
+        m_lodPerspective = camera.projectionType == CameraComponent::ProjectionType::Perspective;
+        out.lodProjScale = m_lodProjScale;
+        out.lodPerspective = m_lodPerspective;
+
+        CollectLights(scene, out);
+
+        // Gather the CPU-path renderables. Workers cull, pick LODs and build packets per
+        // fixed block of entities; blocks are merged in order, so no two threads share a
+        // scratch array and the packet order doesn't depend on scheduling
+        std::vector<Entity>& renderables = m_cpuRenderables;
+        Frustum frustum(out.projection * out.view);
+        glm::vec3 cameraPos = camTransform.position;
+
+        size_t blockCount = (renderables.size() + kExtractGrainSize - 1) / kExtractGrainSize;
+        if (m_extractScratch.size() < blockCount) {
+            m_extractScratch.resize(blockCount);
+        }
+        for (auto& scratch : m_extractScratch) {
+            scratch.packets.clear();
+            scratch.resources.clear();
+        }
+
+        JobSystem::Get().ParallelFor(blockCount, 1, [&](size_t beginBlock, size_t endBlock) {
+            KLEIN_PROFILE_SCOPE("Renderer::CollectEntities");
+            for (size_t block = beginBlock; block < endBlock; block++) {
+                ExtractScratch& scratch = m_extractScratch[block];
+                size_t end = std::min(renderables.size(), (block + 1) * kExtractGrainSize);
+                for (size_t i = block * kExtractGrainSize; i < end; i++) {
+                    CollectEntity(renderables[i], cameraPos, frustum, scratch);
+                }
+            }
+        });
+
+        size_t packetCount = 0;
+        size_t resourceCount = 0;
+        for (const auto& scratch : m_extractScratch) {
+            packetCount += scratch.packets.size();
+            resourceCount += scratch.resources.size();
+        }
+        out.packets.reserve(packetCount);
+        out.resources.reserve(resourceCount);
+        for (auto& scratch : m_extractScratch) {
+            out.packets.insert(out.packets.end(), scratch.packets.begin(), scratch.packets.end());
+            out.resources.insert(out.resources.end(),
+                std::make_move_iterator(scratch.resources.begin()), std::make_move_iterator(scratch.resources.end()));
+            scratch.resources.clear();
+        }
+    }
+
+    void Renderer::RenderFrame(const FrameSnapshot& snapshot) {
+        KLEIN_PROFILE_SCOPE("Renderer::RenderFrame");
+        auto start = std::chrono::steady_clock::now();
+        ResetStats();
+
+        // GL objects released by other threads, on whichever thread renders (App::Run
+        // without a render thread, benches and tools included)
+        RenderThread::ExecutePendingTasks();
+        ShaderLibrary::Get().Update();
+        TextureStreamer::Get().Update();
+        m_stats.streamedTextureBytes = TextureStreamer::Get().GetResidentBytes();
+        m_stats.textureUploadBytes = TextureStreamer::Get().GetUploadedBytes();
+
+        // GPU scene changes are applied even without a camera so handles stay in sync
+        ApplyGPUChanges(snapshot);
+        if (!snapshot.hasCamera) {
+            m_stats.frameTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            m_publishedStats = m_stats;
+            return;
+        }
+
+        if (snapshot.viewportWidth > 0 && snapshot.viewportHeight > 0) {
+            glViewport(0, 0, snapshot.viewportWidth, snapshot.viewportHeight);
+        }
+
+        const glm::mat4& view = snapshot.view;
+        const glm::mat4& projection = snapshot.projection;
         glm::mat4 viewProj = projection * view;
 
-        // Get shader
-        auto shader = ShaderLibrary::Get().Get("default");
-        shader->Bind();
+        m_dynamicBuffer->BeginFrame();
+        m_hiZ->FetchReadback();
 
         // Setup lighting
-        SetupLighting(scene, shader, camTransform.position);
+        SetupLighting(snapshot);
+
+        bool drawGPUScene = HasGPUObjects();
+
+        // Shadow cascades rebind the Camera block, so they go before the main camera upload
+        m_shadowsRendered = m_shadowsEnabled && !snapshot.dirLights.empty();
+        if (m_shadowsRendered) {
+            RenderShadows(snapshot);
+        }
+
+        ShadowBlock shadowBlock;
+        m_shadowMapper->FillBlock(shadowBlock, m_shadowsRendered);
+        UploadUniformBlock(UniformBinding::Shadow, &shadowBlock, sizeof(shadowBlock));
+        m_shadowMapper->Bind();
+
+        // Per-frame uniform blocks: one upload each, bound by range for every draw
+        CameraBlock cameraBlock;
+        cameraBlock.viewProjection = viewProj;
+        cameraBlock.view = view;
+        cameraBlock.projection = projection;
+        cameraBlock.position = snapshot.cameraPosition;
+        UploadUniformBlock(UniformBinding::Camera, &cameraBlock, sizeof(cameraBlock));
+
+        if (drawGPUScene) {
+            m_gpuScene->Cull(viewProj, snapshot.cameraPosition, snapshot.lodProjScale, snapshot.lodPerspective);
+            m_stats.gpuDrivenObjects = m_gpuScene->GetObjectCount();
+        }
+
+        // Main pass only draws what the camera can see and older depth doesn't hide.
+        // Frustum visibility was already decided during extraction
+        bool testOcclusion = m_occlusionCulling && m_hiZ->HasData();
+        m_drawItems.clear();
+        for (const auto& packet : snapshot.packets) {
+            if (!packet.visible) {
+                m_stats.culledObjects++;
+            } else if (testOcclusion && m_hiZ->IsOccluded(packet.center, packet.radius)) {
+                m_stats.occludedObjects++;
+            } else {
+                m_drawItems.push_back(packet);
+            }
+        }
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        if (m_depthPrepass) {
+            RenderDepthPrepass();
+        }
+
+        BeginOverdrawQuery();
+        SubmitDrawItems();
+        if (drawGPUScene) {
+            DrawGPUScene("gpu_driven", m_stats.drawCalls);
+        }
+        EndOverdrawQuery(viewport);
 
-        // Render all entities with MeshRenderer
-        auto renderables = scene->GetEntitiesWithComponent<MeshRendererComponent>();
-        for (auto& entity : renderables) {
-            RenderEntity(entity, viewProj, camTransform.position);
+        if (m_depthPrepass) {
+            glDepthFunc(GL_LESS);
+            glDepthMask(GL_TRUE);
         }
 
-        shader->Unbind();
+        if (m_occlusionCulling) {
+            m_hiZ->Build(viewProj, viewport[2], viewport[3]);
+        }
+
+        m_dynamicBuffer->EndFrame();
+
+        CollectShaderStats();
+        m_stats.frameTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_publishedStats = m_stats;
     }
 
-    void Renderer::RenderEntity(Entity entity, const glm::mat4& viewProj, const glm::vec3& cameraPos) {
+    void Renderer::CollectShaderStats() {
+        for (const auto& [name, shader] : ShaderLibrary::Get().GetAll()) {
+            uint32_t writes = shader->GetUniformWrites();
+            uint32_t skipped = shader->GetRedundantUniformWrites();
+            m_stats.uniformWrites += writes;
+            m_stats.redundantUniformWrites += skipped;
+            if (writes + skipped > 0) {
+                m_stats.shaderUniforms.push_back({ name, writes, skipped });
+            }
+            shader->ResetUniformStats();
+        }
+    }
+
+    bool Renderer::UploadUniformBlock(GLuint binding, const void* data, GLsizeiptr size) {
+        auto allocation = m_dynamicBuffer->Allocate(size, m_uniformBufferAlignment);
+        if (!allocation) {
+            KleinLogger::Logger::EngineWarn("Dynamic buffer exhausted, uniform block %u not updated", binding);
+            return false;
+        }
+
+        std::memcpy(allocation.data, data, size);
+        m_dynamicBuffer->Flush(allocation);
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_dynamicBuffer->GetBuffer(), allocation.offset, size);
+        return true;
+    }
+
+    // Runs on job workers: only writes to this entity's components and to 'scratch'
+    void Renderer::CollectEntity(Entity& entity, const glm::vec3& cameraPos, const Frustum& frustum,
+                                 ExtractScratch& scratch) const {
         if (!entity.HasComponent<TransformComponent>() ||
             !entity.HasComponent<MeshRendererComponent>()) {
             return;
@@ -93,71 +335,601 @@ namespace Klein {
             meshRenderer.material = m_defaultMaterial;
         }
 
-        auto shader = ShaderLibrary::Get().Get(meshRenderer.material->shaderName);
-        if (!shader) {
-            shader = ShaderLibrary::Get().Get("default");
+        const Material& material = *meshRenderer.material;
+        glm::mat4 model = transform.GetTransform();
+
+        // World space bounding sphere, shared by LOD selection and culling
+        const Mesh& mesh = *meshRenderer.mesh;
+        glm::vec3 center = glm::vec3(model * glm::vec4(mesh.GetBoundsCenter(), 1.0f));
+        float maxScale = std::max({ glm::length(glm::vec3(model[0])),
+                                    glm::length(glm::vec3(model[1])),
+                                    glm::length(glm::vec3(model[2])) });
+        float radius = mesh.GetBoundsRadius() * maxScale;
+
+        // Culled objects may still cast shadows, so they keep a packet
+        bool visible = frustum.IntersectsSphere(center, radius);
+        if (meshRenderer.autoLOD && visible) {
+            meshRenderer.lod = SelectLOD(mesh, meshRenderer, center, radius, cameraPos);
+        }
+
+        // Streamed textures load the mips this object can show: its diameter in pixels
+        if (visible && (material.albedoMap || material.normalMap)) {
+            float pixels = radius * m_lodProjScale * m_lodViewportHeight;
+            if (m_lodPerspective) {
+                pixels /= std::max(glm::length(center - cameraPos), radius);
+            }
+            if (material.albedoMap) material.albedoMap->RequestResolution(pixels);
+            if (material.normalMap) material.normalMap->RequestResolution(pixels);
+        }
+
+        DrawPacket packet;
+        packet.mesh = mesh.GetLOD(meshRenderer.lod);
+        packet.material = meshRenderer.material.get();
+        packet.albedoMap = material.albedoMap.get();
+        packet.normalMap = material.normalMap.get();
+        packet.materialBlock = material.GetBlock();
+        packet.model = model;
+        packet.center = center;
+        packet.radius = radius;
+        packet.castShadows = meshRenderer.castShadows;
+        packet.receiveShadows = meshRenderer.receiveShadows;
+        packet.isStatic = meshRenderer.isStatic;
+        packet.visible = visible;
+        packet.batched = m_materialBatching && material.shaderName == "default";
+
+        // Material in the high bits, then mesh, then the shadow flag; batches are still
+        // split on the actual pointers, so a hash collision only costs a draw call.
+        // Batched packets only group by mesh
+        auto hashPointer = [](const void* pointer) {
+            uint64_t value = (uint64_t)(uintptr_t)pointer;
+            value ^= value >> 33;
+            value *= 0xff51afd7ed558ccdull;
+            value ^= value >> 33;
+            return value;
+        };
+        if (packet.batched) {
+            packet.sortKey = hashPointer(packet.mesh);
+        } else {
+            packet.sortKey = (hashPointer(packet.material) & 0xFFFFFFFF00000000ull) |
+                             ((hashPointer(packet.mesh) >> 32) & 0xFFFFFFFEull) |
+                             (packet.receiveShadows ? 1ull : 0ull);
+        }
+        scratch.packets.push_back(packet);
+
+        // The entity may drop these before the render thread is done with them
+        scratch.resources.push_back(meshRenderer.mesh);
+        scratch.resources.push_back(meshRenderer.material);
+        if (material.albedoMap) {
+            scratch.resources.push_back(material.albedoMap);
+        }
+        if (material.normalMap) {
+            scratch.resources.push_back(material.normalMap);
+        }
+    }
+
+    void Renderer::SyncRenderables(Scene* scene, FrameSnapshot& out) {
+        KLEIN_PROFILE_SCOPE("Renderer::SyncRenderables");
+        bool recording = scene->TakeRenderableChanges(m_renderableChanges);
+        bool rescan = m_renderablesDirty.exchange(false);
+        if (recording && !rescan && scene == m_trackedScene) {
+            for (auto& change : m_renderableChanges) {
+                if (change.added) {
+                    AddRenderable(change.entity, out);
+                } else {
+                    RemoveRenderable(change.entity.GetID(), out);
+                }
+            }
+            m_renderableChanges.clear();
+            return;
+        }
+
+        // New scene, or the GPU-driven setting changed: everything is re-sorted once.
+        // Nothing has been added to this snapshot yet, so every GPU entity is removed
+        for (const auto& [entityID, frame] : m_gpuEntities) {
+            out.gpuRemoved.push_back(entityID);
+        }
+        m_gpuEntities.clear();
+        m_cpuRenderables.clear();
+        m_cpuRenderableIndices.clear();
+        m_trackedScene = scene;
+        for (Entity& entity : scene->GetEntitiesWithComponent<MeshRendererComponent>()) {
+            AddRenderable(entity, out);
+        }
+    }
+
+    void Renderer::AddRenderable(Entity& entity, FrameSnapshot& out) {
+        // Removed again later in the same change list
+        uint32_t entityID = entity.GetID();
+        if (!entity.HasComponent<MeshRendererComponent>() ||
+            m_cpuRenderableIndices.count(entityID) || m_gpuEntities.count(entityID)) {
+            return;
+        }
+
+        auto& meshRenderer = entity.GetComponent<MeshRendererComponent>();
+        if (!meshRenderer.mesh) {
+            meshRenderer.mesh = m_defaultCubeMesh;
+        }
+        if (!meshRenderer.material) {
+            meshRenderer.material = m_defaultMaterial;
+        }
+
+        // Static objects are uploaded once; their transform and material are not re-read
+        // until Scene::RefreshRenderable
+        const Material& material = *meshRenderer.material;
+        if (m_gpuDriven && m_gpuSupported && meshRenderer.isStatic && entity.HasComponent<TransformComponent>() &&
+            material.shaderName == "default" && !material.albedoMap && !material.normalMap) {
+            uint32_t flags = (meshRenderer.castShadows ? GPUScene::CastShadows : 0u) |
+                             (meshRenderer.receiveShadows ? GPUScene::ReceiveShadows : 0u);
+            out.gpuAdded.push_back({ entityID, meshRenderer.mesh, material.GetBlock(),
+                                     entity.GetComponent<TransformComponent>().GetTransform(),
+                                     flags, meshRenderer.lodBias });
+            m_gpuEntities[entityID] = m_frameIndex;
+            return;
+        }
+
+        m_cpuRenderableIndices[entityID] = m_cpuRenderables.size();
+        m_cpuRenderables.push_back(entity);
+    }
+
+    void Renderer::RemoveRenderable(uint32_t entityID, FrameSnapshot& out) {
+        auto cpu = m_cpuRenderableIndices.find(entityID);
+        if (cpu != m_cpuRenderableIndices.end()) {
+            size_t position = cpu->second;
+            m_cpuRenderableIndices.erase(cpu);
+            if (position + 1 != m_cpuRenderables.size()) {
+                m_cpuRenderables[position] = std::move(m_cpuRenderables.back());
+                m_cpuRenderableIndices[m_cpuRenderables[position].GetID()] = position;
+            }
+            m_cpuRenderables.pop_back();
+            return;
+        }
+
+        auto gpu = m_gpuEntities.find(entityID);
+        if (gpu == m_gpuEntities.end()) return;
+
+        // The render stage applies removals before additions, so an entity that only
+        // arrived in this snapshot is taken back out of it instead
+        if (gpu->second == m_frameIndex) {
+            auto added = std::find_if(out.gpuAdded.rbegin(), out.gpuAdded.rend(),
+                [entityID](const GPUObjectPacket& packet) { return packet.entityID == entityID; });
+            if (added != out.gpuAdded.rend()) {
+                out.gpuAdded.erase(std::next(added).base());
+            }
+        } else {
+            out.gpuRemoved.push_back(entityID);
+        }
+        m_gpuEntities.erase(gpu);
+    }
+
+    void Renderer::ApplyGPUChanges(const FrameSnapshot& snapshot) {
+        if (!m_gpuScene) return;
+
+        // Removals first, an entity can leave and re-enter within one snapshot
+        for (uint32_t entityID : snapshot.gpuRemoved) {
+            auto it = m_gpuObjects.find(entityID);
+            if (it != m_gpuObjects.end()) {
+                m_gpuScene->RemoveObject(it->second);
+                m_gpuObjects.erase(it);
+            }
         }
+        for (const auto& added : snapshot.gpuAdded) {
+            m_gpuObjects[added.entityID] = m_gpuScene->AddObject(added.mesh, added.materialBlock, added.model,
+                                                                 added.flags, added.lodBias);
+        }
+        m_gpuScene->Upload();
+    }
+
+    void Renderer::DrawGPUScene(const char* shaderName, uint32_t& drawCalls) {
+        // The object SSBO layout has no fallback; skip until the program is linked
+        auto shader = ShaderLibrary::Get().Get(shaderName);
+        if (!shader || !shader->IsReady()) return;
 
         shader->Bind();
+        m_gpuScene->Draw();
+        drawCalls++;
+    }
 
-        // Set transform matrices
-        glm::mat4 model = transform.GetTransform();
-        shader->SetMat4("u_Model", model);
-        shader->SetMat4("u_ViewProjection", viewProj);
-        shader->SetVec3("u_CameraPos", cameraPos);
-
-        // Set material properties
-        shader->SetVec3("u_Material.albedo", meshRenderer.material->albedo);
-        shader->SetFloat("u_Material.metallic", meshRenderer.material->metallic);
-        shader->SetFloat("u_Material.roughness", meshRenderer.material->roughness);
-        shader->SetFloat("u_Material.ao", meshRenderer.material->ao);
-
-        // Bind textures if available
-        if (meshRenderer.material->albedoMap) {
-            meshRenderer.material->albedoMap->Bind(0);
-            shader->SetInt("u_AlbedoMap", 0);
-            shader->SetInt("u_UseAlbedoMap", 1);
+    void Renderer::SetMaterialBatching(bool enabled) {
+        if (enabled && !m_materialTable) {
+            KleinLogger::Logger::EngineWarn("Material batching needs OpenGL 4.3, staying on per-material draws");
+            return;
+        }
+        m_materialBatching = enabled;
+    }
+
+    void Renderer::SetGPUDriven(bool enabled) {
+        if (enabled && !m_gpuSupported) {
+            KleinLogger::Logger::EngineWarn("GPU-driven rendering needs OpenGL 4.3, staying on the CPU path");
+            return;
+        }
+        // Stored before the rescan is requested, so the rescan sees the new mode
+        if (m_gpuDriven.exchange(enabled) != enabled) {
+            m_renderablesDirty = true;
+        }
+    }
+
+    void Renderer::SubmitDrawItems() {
+        KLEIN_PROFILE_SCOPE("Renderer::SubmitDrawItems");
+        // Group identical material/mesh pairs (or just meshes, when batched) so each
+        // group becomes one instanced draw
+        std::sort(m_drawItems.begin(), m_drawItems.end(), [](const DrawPacket& a, const DrawPacket& b) {
+            return a.sortKey < b.sortKey;
+        });
+
+        if (m_materialBatching && m_materialTable) {
+            SubmitBatchedItems();
+            DrawMaterialGroups(m_unbatchedItems);
         } else {
-            shader->SetInt("u_UseAlbedoMap", 0);
+            DrawMaterialGroups(m_drawItems);
         }
 
-        // Draw mesh
-        meshRenderer.mesh->Draw();
+        // Later passes reuse these units with textures that carry their own parameters
+        glBindSampler(TextureSlot::Albedo, 0);
+        glBindSampler(TextureSlot::Normal, 0);
+    }
 
-        m_stats.drawCalls++;
-        m_stats.triangles += meshRenderer.mesh->indices.size() / 3;
-        m_stats.vertices += meshRenderer.mesh->vertices.size();
+    void Renderer::SubmitBatchedItems() {
+        m_batchedItems.clear();
+        m_batchedMaterials.clear();
+        m_unbatchedItems.clear();
+
+        // Everything takes the regular path until the batched shader links
+        auto shader = ShaderLibrary::Get().Get("batched");
+        bool ready = shader && shader->IsReady();
+
+        // Materials whose textures fit no array stay unbatched
+        m_materialTable->BeginFrame();
+        for (const DrawPacket& item : m_drawItems) {
+            uint32_t index = MaterialTable::kInvalidIndex;
+            if (ready && item.batched) {
+                index = m_materialTable->Add(item.material, item.materialBlock,
+                                             IfReady(item.albedoMap), IfReady(item.normalMap),
+                                             item.material->sampler);
+            }
+            if (index == MaterialTable::kInvalidIndex) {
+                m_unbatchedItems.push_back(item);
+            } else {
+                m_batchedItems.push_back(item);
+                m_batchedMaterials.push_back(index);
+            }
+        }
+        if (m_batchedItems.empty()) return;
+
+        m_materialTable->Bind();
+        shader->Bind();
+        m_stats.batchedMaterials += m_materialTable->GetMaterialCount();
+
+        size_t first = 0;
+        while (first < m_batchedItems.size()) {
+            size_t last = first + 1;
+            while (last < m_batchedItems.size() && m_batchedItems[last].mesh == m_batchedItems[first].mesh) {
+                last++;
+            }
+            if (!DrawInstances(m_batchedItems, first, last, m_stats.drawCalls, m_batchedMaterials.data())) {
+                return;
+            }
+            first = last;
+        }
     }
 
-    void Renderer::SetupLighting(Scene* scene, std::shared_ptr<Shader> shader, const glm::vec3& cameraPos) {
-        auto lights = scene->GetLights();
+    void Renderer::DrawMaterialGroups(const std::vector<DrawPacket>& items) {
+        Shader* boundShader = nullptr;
+        size_t first = 0;
+        while (first < items.size()) {
+            const DrawPacket& head = items[first];
+
+            size_t last = first + 1;
+            while (last < items.size() &&
+                   items[last].mesh == head.mesh &&
+                   items[last].material == head.material &&
+                   items[last].receiveShadows == head.receiveShadows) {
+                last++;
+            }
+
+            // Branch-free variant for this material's textures; the uber shader stands
+            // in while it compiles
+            Material* material = head.material;
+            const Texture* albedoMap = IfReady(head.albedoMap);
+            const Texture* normalMap = IfReady(head.normalMap);
+            uint32_t features = ShaderFeature::Instanced;
+            if (albedoMap) features |= ShaderFeature::AlbedoMap;
+            if (normalMap) features |= ShaderFeature::NormalMap;
+            if (head.receiveShadows) features |= ShaderFeature::Shadows;
+            auto shader = ShaderLibrary::Get().GetVariant(material->shaderName, features);
+            if (shader.get() != boundShader) {
+                shader->Bind();
+                boundShader = shader.get();
+            }
+
+            // Only the uber shader has this uniform; elsewhere the lookup misses and nothing is sent
+            shader->SetInt("u_ReceiveShadows", head.receiveShadows ? 1 : 0);
+
+            // Material properties live in the material's own uniform buffer
+            MaterialBlock materialBlock = head.materialBlock;
+            materialBlock.useAlbedoMap = albedoMap ? 1 : 0;
+            material->BindUniforms(materialBlock);
+            GLuint sampler = SamplerCache::Get().GetSampler(material->sampler);
+            if (albedoMap) {
+                albedoMap->Bind(TextureSlot::Albedo, sampler);
+            }
+            if (normalMap) {
+                normalMap->Bind(TextureSlot::Normal, sampler);
+            }
+
+            if (!DrawInstances(items, first, last, m_stats.drawCalls)) {
+                return;
+            }
+            first = last;
+        }
+    }
 
-        int dirLightCount = 0;
-        int pointLightCount = 0;
+    bool Renderer::DrawInstances(const std::vector<DrawPacket>& items, size_t first, size_t last, uint32_t& drawCalls,
+                                 const uint32_t* materialIndices) {
+        const Mesh* mesh = items[first].mesh;
+
+        // Batched instances follow the matrix with their material index and flags
+        struct BatchedInstance {
+            glm::mat4 model;
+            glm::uvec4 info;
+        };
+        size_t stride = materialIndices ? sizeof(BatchedInstance) : sizeof(glm::mat4);
+
+        // Stream the group's instance data through the ring buffer, splitting
+        // only if the frame's region can't hold the whole group
+        while (first < last) {
+            GLsizei capacity = (GLsizei)(m_dynamicBuffer->GetFrameRemaining() / stride) - 1;
+            GLsizei count = std::min((GLsizei)(last - first), capacity);
+
+            auto allocation = count > 0
+                ? m_dynamicBuffer->Allocate(count * stride, sizeof(glm::vec4))
+                : RingBuffer::Allocation{};
+            if (!allocation) {
+                KleinLogger::Logger::EngineWarn("Dynamic buffer exhausted, %zu instance(s) dropped",
+                    items.size() - first);
+                return false;
+            }
+
+            if (materialIndices) {
+                auto* instances = static_cast<BatchedInstance*>(allocation.data);
+                for (GLsizei i = 0; i < count; i++) {
+                    const DrawPacket& item = items[first + i];
+                    BatchedInstance instance = { item.model,
+                        glm::uvec4(materialIndices[first + i], item.receiveShadows ? 1u : 0u, 0u, 0u) };
+                    std::memcpy(&instances[i], &instance, sizeof(instance));
+                }
+            } else {
+                auto* instances = static_cast<glm::mat4*>(allocation.data);
+                for (GLsizei i = 0; i < count; i++) {
+                    std::memcpy(&instances[i], &items[first + i].model, sizeof(glm::mat4));
+                }
+            }
+            m_dynamicBuffer->Flush(allocation);
+
+            mesh->BindInstanceBuffer(m_dynamicBuffer->GetBuffer(), allocation.offset, (GLsizei)stride,
+                                     materialIndices != nullptr);
+            mesh->DrawInstanced(count);
+
+            drawCalls++;
+            m_stats.triangles += mesh->GetIndexCount() / 3 * count;
+            m_stats.vertices += mesh->GetVertexCount() * count;
+
+            first += count;
+        }
+        return true;
+    }
+
+    void Renderer::RenderShadows(const FrameSnapshot& snapshot) {
+        KLEIN_PROFILE_SCOPE("Renderer::RenderShadows");
+        // The first directional light casts shadows
+        m_shadowMapper->UpdateCascades(snapshot.view, snapshot.camera, snapshot.aspectRatio,
+                                       snapshot.dirLights[0].direction);
+
+        auto depthShader = ShaderLibrary::Get().Get("depth");
+        if (!depthShader) return;
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLint framebuffer = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+
+        // GPU-driven objects are all static; any change to them invalidates every cascade
+        bool gpuCasters = HasGPUObjects();
+
+        bool stateSet = false;
+        for (int cascade = 0; cascade < ShadowMapper::kCascadeCount; cascade++) {
+            const glm::mat4& cascadeViewProj = m_shadowMapper->GetCascadeViewProj(cascade);
+            Frustum frustum(cascadeViewProj);
+
+            // Static casters are identified by mesh and transform, so the hash changes
+            // whenever one appears, disappears, moves or switches LOD
+            m_staticCasters.clear();
+            m_dynamicCasters.clear();
+            uint64_t staticHash = 14695981039346656037ull;
+            if (gpuCasters) {
+                staticHash ^= m_gpuScene->GetVersion() * 1099511628211ull;
+            }
+            for (const auto& item : snapshot.packets) {
+                if (!item.castShadows || !frustum.IntersectsSphere(item.center, item.radius)) continue;
+
+                if (item.isStatic) {
+                    m_staticCasters.push_back(item);
+                    auto hashBytes = [&staticHash](const void* data, size_t size) {
+                        const auto* bytes = static_cast<const unsigned char*>(data);
+                        for (size_t i = 0; i < size; i++) {
+                            staticHash = (staticHash ^ bytes[i]) * 1099511628211ull;
+                        }
+                    };
+                    hashBytes(&item.mesh, sizeof(item.mesh));
+                    hashBytes(&item.model, sizeof(item.model));
+                } else {
+                    m_dynamicCasters.push_back(item);
+                }
+            }
+
+            auto plan = m_shadowMapper->PlanCascade(cascade, staticHash, !m_dynamicCasters.empty());
+            if (!plan.composite) continue;
+
+            if (!stateSet) {
+                // Depth-only state, restored after the last cascade
+                depthShader->Bind();
+                glEnable(GL_POLYGON_OFFSET_FILL);
+                glPolygonOffset(2.0f, 4.0f);
+                if (m_wireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+                stateSet = true;
+            }
+
+            CameraBlock cascadeBlock;
+            cascadeBlock.viewProjection = cascadeViewProj;
+            UploadUniformBlock(UniformBinding::Camera, &cascadeBlock, sizeof(cascadeBlock));
+
+            if (plan.renderStatic) {
+                m_shadowMapper->BeginStaticPass(cascade);
+                DrawDepthOnly(m_staticCasters, m_stats.shadowDrawCalls);
+
+                if (gpuCasters) {
+                    m_gpuScene->Cull(cascadeViewProj, snapshot.cameraPosition, snapshot.lodProjScale,
+                                     snapshot.lodPerspective, GPUScene::CastShadows);
+                    DrawGPUScene("gpu_driven_depth", m_stats.shadowDrawCalls);
+                    depthShader->Bind();
+                }
+            }
+
+            m_shadowMapper->BeginDynamicPass(cascade);
+            DrawDepthOnly(m_dynamicCasters, m_stats.shadowDrawCalls);
+            m_stats.shadowCascadeUpdates++;
+        }
+
+        if (stateSet) {
+            glDisable(GL_POLYGON_OFFSET_FILL);
+            if (m_wireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            m_shadowMapper->EndPasses((GLuint)framebuffer, viewport);
+        }
+    }
+
+    void Renderer::DrawDepthOnly(std::vector<DrawPacket>& items, uint32_t& drawCalls) {
+        // Depth only, so the material doesn't matter and one draw covers each mesh
+        std::sort(items.begin(), items.end(), [](const DrawPacket& a, const DrawPacket& b) {
+            return a.mesh < b.mesh;
+        });
+
+        size_t first = 0;
+        while (first < items.size()) {
+            size_t last = first + 1;
+            while (last < items.size() && items[last].mesh == items[first].mesh) {
+                last++;
+            }
+            if (!DrawInstances(items, first, last, drawCalls)) {
+                return;
+            }
+            first = last;
+        }
+    }
+
+    void Renderer::RenderDepthPrepass() {
+        KLEIN_PROFILE_SCOPE("Renderer::RenderDepthPrepass");
+        auto depthShader = ShaderLibrary::Get().Get("depth");
+        if (!depthShader) return;
+
+        // Lay down final depth first so the lit pass shades every pixel once
+        depthShader->Bind();
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        DrawDepthOnly(m_drawItems, m_stats.depthPrepassDrawCalls);
+        if (HasGPUObjects()) {
+            DrawGPUScene("gpu_driven_depth", m_stats.depthPrepassDrawCalls);
+        }
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+        // Lit pass only needs to test against it; restored after SubmitDrawItems
+        glDepthFunc(GL_LEQUAL);
+        glDepthMask(GL_FALSE);
+    }
+
+    void Renderer::BeginOverdrawQuery() {
+        // Reuse the oldest query; its result is normally ready by now
+        int index = m_overdrawQueryIndex;
+        if (m_overdrawQueryPending[index]) {
+            GLuint available = 0;
+            glGetQueryObjectuiv(m_overdrawQueries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint64 samples = 0;
+                glGetQueryObjectui64v(m_overdrawQueries[index], GL_QUERY_RESULT, &samples);
+                m_lastShadedSamples = samples;
+            }
+            m_overdrawQueryPending[index] = false;
+        }
+
+        glBeginQuery(GL_SAMPLES_PASSED, m_overdrawQueries[index]);
+    }
+
+    void Renderer::EndOverdrawQuery(const GLint viewport[4]) {
+        glEndQuery(GL_SAMPLES_PASSED);
+        m_overdrawQueryPending[m_overdrawQueryIndex] = true;
+        m_overdrawQueryIndex = (m_overdrawQueryIndex + 1) % kOverdrawQueryCount;
+
+        uint64_t pixels = (uint64_t)std::max(viewport[2], 1) * (uint64_t)std::max(viewport[3], 1);
+        m_lastOverdraw = (float)((double)m_lastShadedSamples / (double)pixels);
+
+        m_stats.shadedSamples = m_lastShadedSamples;
+        m_stats.overdraw = m_lastOverdraw;
+    }
+
+    int Renderer::SelectLOD(const Mesh& mesh, const MeshRendererComponent& meshRenderer,
+                            const glm::vec3& center, float radius, const glm::vec3& cameraPos) const {
+        int lodCount = mesh.GetLODCount();
+        if (lodCount <= 1) return 0;
+
+        // Projected bounding sphere diameter as a fraction of the viewport height
+        float screenSize = radius * m_lodProjScale;
+        if (m_lodPerspective) {
+            float distance = glm::length(center - cameraPos);
+            if (distance <= radius) return 0; // Camera inside the bounds
+            screenSize /= distance;
+        }
+        screenSize *= meshRenderer.lodBias;
+
+        // Step from the current level so objects near a threshold don't flicker between LODs
+        int lod = std::clamp(meshRenderer.lod, 0, lodCount - 1);
+        while (lod + 1 < lodCount && screenSize < mesh.GetLODScreenSize(lod + 1) * (1.0f - kLODHysteresis)) {
+            lod++;
+        }
+        while (lod > 0 && screenSize > mesh.GetLODScreenSize(lod) * (1.0f + kLODHysteresis)) {
+            lod--;
+        }
+        return lod;
+    }
+
+    void Renderer::CollectLights(Scene* scene, FrameSnapshot& out) {
+        auto lights = scene->GetLights();
 
         for (auto& lightEntity : lights) {
             auto& light = lightEntity.GetComponent<LightComponent>();
             auto& transform = lightEntity.GetComponent<TransformComponent>();
 
-            if (light.type == LightComponent::Type::Directional && dirLightCount < 4) {
-                std::string base = "u_DirLights[" + std::to_string(dirLightCount) + "]";
-                shader->SetVec3(base + ".direction", transform.GetForward());
-                shader->SetVec3(base + ".color", light.color);
-                shader->SetFloat(base + ".intensity", light.intensity);
-                dirLightCount++;
+            if (light.type == LightComponent::Type::Directional) {
+                out.dirLights.push_back({ transform.GetForward(), light.color, light.intensity });
             }
-            else if (light.type == LightComponent::Type::Point && pointLightCount < 8) {
-                std::string base = "u_PointLights[" + std::to_string(pointLightCount) + "]";
-                shader->SetVec3(base + ".position", transform.position);
-                shader->SetVec3(base + ".color", light.color);
-                shader->SetFloat(base + ".intensity", light.intensity);
-                shader->SetFloat(base + ".range", light.range);
-                pointLightCount++;
+            else if (light.type == LightComponent::Type::Point) {
+                out.pointLights.push_back({ transform.position, light.range, light.color, light.intensity });
             }
         }
+    }
+
+    void Renderer::SetupLighting(const FrameSnapshot& snapshot) {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        m_clusteredLighting->Update(snapshot.dirLights, snapshot.pointLights, snapshot.view, snapshot.projection,
+            snapshot.camera.nearClip, snapshot.camera.farClip, viewport[2], viewport[3]);
+        m_clusteredLighting->Bind();
+
+        LightsBlock block;
+        m_clusteredLighting->FillBlock(block);
+        UploadUniformBlock(UniformBinding::Lights, &block, sizeof(block));
+    }
 
-        shader->SetInt("u_DirLightCount", dirLightCount);
-        shader->SetInt("u_PointLightCount", pointLightCount);
+    RenderStats Renderer::GetStats() const {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        return m_publishedStats;
     }
 
     void Renderer::ResetStats() {
@@ -0,0 +1,96 @@
+#include "RingBuffer.h"
+#include "Logger.h"
+
+namespace Klein {
+
+    RingBuffer::RingBuffer(GLsizeiptr frameSize, int frameCount)
+        : m_frameSize(frameSize)
+        , m_frameCount(frameCount)
+        , m_fences(frameCount, nullptr)
+    {
+        GLsizeiptr totalSize = m_frameSize * m_frameCount;
+
+        glGenBuffers(1, &m_buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+
+        if (GLAD_GL_VERSION_4_4) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, totalSize, nullptr, flags);
+            m_mapped = static_cast<uint8_t*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, totalSize, flags));
+            m_persistent = m_mapped != nullptr;
+        }
+
+        if (!m_persistent) {
+            glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, GL_DYNAMIC_DRAW);
+            m_staging.resize(totalSize);
+            m_mapped = m_staging.data();
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        KleinLogger::Logger::EngineLog("Ring buffer created: %d x %lld KB (%s)",
+            m_frameCount, (long long)(m_frameSize / 1024), m_persistent ? "persistent" : "staged");
+    }
+
+    RingBuffer::~RingBuffer() {
+        for (GLsync fence : m_fences) {
+            if (fence) glDeleteSync(fence);
+        }
+
+        if (m_persistent) {
+            glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &m_buffer);
+    }
+
+    void RingBuffer::BeginFrame() {
+        m_frameIndex = (m_frameIndex + 1) % m_frameCount;
+        m_head = 0;
+
+        GLsync& fence = m_fences[m_frameIndex];
+        if (!fence) return;
+
+        // Normally already signalled: the region was last used frameCount-1 frames ago
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        while (result == GL_TIMEOUT_EXPIRED) {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+        }
+        if (result == GL_WAIT_FAILED) {
+            KleinLogger::Logger::EngineError("Ring buffer fence wait failed");
+        }
+
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    void RingBuffer::EndFrame() {
+        if (m_head == 0) return;
+        m_fences[m_frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    RingBuffer::Allocation RingBuffer::Allocate(GLsizeiptr size, GLsizeiptr alignment) {
+        GLsizeiptr aligned = (m_head + alignment - 1) / alignment * alignment;
+        if (aligned + size > m_frameSize) {
+            return {};
+        }
+
+        m_head = aligned + size;
+
+        Allocation allocation;
+        allocation.offset = m_frameIndex * m_frameSize + aligned;
+        allocation.data = m_mapped + allocation.offset;
+        allocation.size = size;
+        return allocation;
+    }
+
+    void RingBuffer::Flush(const Allocation& allocation) {
+        if (m_persistent || !allocation) return;
+
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        glBufferSubData(GL_ARRAY_BUFFER, allocation.offset, allocation.size, allocation.data);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+} // namespace Klein
@@ -0,0 +1,68 @@
+#include "SamplerCache.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace Klein {
+
+    SamplerCache& SamplerCache::Get() {
+        static SamplerCache instance;
+        return instance;
+    }
+
+    size_t SamplerCache::DescHash::operator()(const SamplerDesc& desc) const {
+        uint32_t anisotropyBits;
+        std::memcpy(&anisotropyBits, &desc.anisotropy, sizeof(anisotropyBits));
+
+        size_t hash = std::hash<uint32_t>()(desc.minFilter);
+        auto combine = [&hash](uint32_t value) {
+            hash ^= std::hash<uint32_t>()(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        };
+        combine(desc.magFilter);
+        combine(desc.wrapS);
+        combine(desc.wrapT);
+        combine(anisotropyBits);
+        return hash;
+    }
+
+    GLuint SamplerCache::GetSampler(const SamplerDesc& desc) {
+        auto it = m_samplers.find(desc);
+        if (it != m_samplers.end()) {
+            return it->second;
+        }
+
+        GLuint sampler = 0;
+        glGenSamplers(1, &sampler);
+        glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, (GLint)desc.minFilter);
+        glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, (GLint)desc.magFilter);
+        glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, (GLint)desc.wrapS);
+        glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, (GLint)desc.wrapT);
+        if (desc.anisotropy > 1.0f && GetMaxAnisotropy() > 1.0f) {
+            glSamplerParameterf(sampler, GL_TEXTURE_MAX_ANISOTROPY, std::min(desc.anisotropy, GetMaxAnisotropy()));
+        }
+
+        m_samplers.emplace(desc, sampler);
+        return sampler;
+    }
+
+    float SamplerCache::GetMaxAnisotropy() {
+        if (m_maxAnisotropy == 0.0f) {
+            m_maxAnisotropy = 1.0f;
+            // Core in 4.6, same enums as the ARB/EXT extensions
+            if (GLAD_GL_VERSION_4_6 || GLAD_GL_ARB_texture_filter_anisotropic ||
+                GLAD_GL_EXT_texture_filter_anisotropic) {
+                glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &m_maxAnisotropy);
+            }
+        }
+        return m_maxAnisotropy;
+    }
+
+    void SamplerCache::Clear() {
+        for (const auto& [desc, sampler] : m_samplers) {
+            glDeleteSamplers(1, &sampler);
+        }
+        m_samplers.clear();
+        m_maxAnisotropy = 0.0f;
+    }
+
+} // namespace Klein
@@ -1,5 +1,6 @@
 #include "Scene.h"
 #include "Logger.h"
+#include "Profiler.h"
 #include <algorithm>
 
 namespace Klein {
@@ -11,6 +12,8 @@ namespace Klein {
     }
 
     Scene::~Scene() {
+        m_renderableChanges.clear();
+        m_componentIndex.clear();
         m_entities.clear();
         KleinLogger::Logger::EngineLog("Scene destroyed: %s", m_name.c_str());
     }
@@ -22,7 +25,10 @@ namespace Klein {
         // Every entity gets a Tag and Transform by default
         entityData->AddComponent<TagComponent>(name);
         entityData->AddComponent<TransformComponent>();
+        IndexComponent(entityData, typeid(TagComponent));
+        IndexComponent(entityData, typeid(TransformComponent));
 
+        m_entityPositions[entityData->id] = m_entities.size();
         m_entities.push_back(entityData);
 
         Entity entity(entityData, this);
@@ -33,23 +39,35 @@ namespace Klein {
     void Scene::DestroyEntity(Entity entity) {
         if (!entity.IsValid()) return;
 
-        auto it = std::find_if(m_entities.begin(), m_entities.end(),
-            [&entity](const std::shared_ptr<EntityData>& data) {
-                return data->id == entity.GetID();
-            });
+        auto it = m_entityPositions.find(entity.GetID());
+        if (it == m_entityPositions.end()) return;
 
-        if (it != m_entities.end()) {
-            KleinLogger::Logger::EngineLog("Entity destroyed (ID: %u)", entity.GetID());
-            m_entities.erase(it);
+        KleinLogger::Logger::EngineLog("Entity destroyed (ID: %u)", entity.GetID());
+        if (entity.HasComponent<MeshRendererComponent>()) {
+            RecordRenderableChange(entity, false);
         }
+        for (const auto& [type, component] : entity.m_data->components) {
+            UnindexComponent(entity.GetID(), type);
+        }
+
+        // Swap with the last entity so removal doesn't shift the whole list
+        size_t position = it->second;
+        m_entityPositions.erase(it);
+        if (position + 1 != m_entities.size()) {
+            m_entities[position] = std::move(m_entities.back());
+            m_entityPositions[m_entities[position]->id] = position;
+        }
+        m_entities.pop_back();
     }
 
     std::vector<Entity> Scene::GetEntitiesWithComponent(std::type_index componentType) {
         std::vector<Entity> result;
-        for (auto& entityData : m_entities) {
-            if (entityData->components.find(componentType) != entityData->components.end()) {
-                result.emplace_back(entityData, this);
-            }
+        auto it = m_componentIndex.find(componentType);
+        if (it == m_componentIndex.end()) return result;
+
+        result.reserve(it->second.entities.size());
+        for (auto& entityData : it->second.entities) {
+            result.emplace_back(entityData, this);
         }
         return result;
     }
@@ -62,6 +80,74 @@ namespace Klein {
         return result;
     }
 
+    bool Scene::TakeRenderableChanges(std::vector<RenderableChange>& out) {
+        out.clear();
+        if (!m_recordRenderables) {
+            m_recordRenderables = true;
+            return false;
+        }
+        out.swap(m_renderableChanges);
+        return true;
+    }
+
+    void Scene::RefreshRenderable(Entity entity) {
+        if (!entity.IsValid() || !entity.HasComponent<MeshRendererComponent>()) return;
+        RecordRenderableChange(entity, false);
+        RecordRenderableChange(entity, true);
+    }
+
+    void Scene::IndexComponent(const std::shared_ptr<EntityData>& data, std::type_index type) {
+        ComponentIndex& index = m_componentIndex[type];
+        if (index.positions.try_emplace(data->id, index.entities.size()).second) {
+            index.entities.push_back(data);
+        }
+    }
+
+    void Scene::UnindexComponent(uint32_t entityID, std::type_index type) {
+        auto indexIt = m_componentIndex.find(type);
+        if (indexIt == m_componentIndex.end()) return;
+
+        ComponentIndex& index = indexIt->second;
+        auto it = index.positions.find(entityID);
+        if (it == index.positions.end()) return;
+
+        size_t position = it->second;
+        index.positions.erase(it);
+        if (position + 1 != index.entities.size()) {
+            index.entities[position] = std::move(index.entities.back());
+            index.positions[index.entities[position]->id] = position;
+        }
+        index.entities.pop_back();
+    }
+
+    void Scene::RecordRenderableChange(const Entity& entity, bool added) {
+        if (m_recordRenderables) {
+            m_renderableChanges.push_back({ entity, added });
+        }
+    }
+
+    void NotifyComponentAdded(const Entity& entity, std::type_index type, bool replaced) {
+        // Destroyed entities are no longer indexed
+        Scene* scene = entity.m_scene;
+        if (scene->m_entityPositions.find(entity.GetID()) == scene->m_entityPositions.end()) return;
+        scene->IndexComponent(entity.m_data, type);
+
+        // A replaced renderable may differ in everything, so it leaves and re-enters
+        if (type == typeid(MeshRendererComponent)) {
+            if (replaced) scene->RecordRenderableChange(entity, false);
+            scene->RecordRenderableChange(entity, true);
+        }
+    }
+
+    void NotifyComponentRemoved(const Entity& entity, std::type_index type) {
+        Scene* scene = entity.m_scene;
+        if (scene->m_entityPositions.find(entity.GetID()) == scene->m_entityPositions.end()) return;
+        scene->UnindexComponent(entity.GetID(), type);
+        if (type == typeid(MeshRendererComponent)) {
+            scene->RecordRenderableChange(entity, false);
+        }
+    }
+
     Entity Scene::GetPrimaryCamera() {
         auto cameras = GetEntitiesWithComponent<CameraComponent>();
         for (auto& entity : cameras) {
@@ -77,6 +163,7 @@ namespace Klein {
     }
 
     void Scene::OnUpdate(float deltaTime) {
+        KLEIN_PROFILE_SCOPE("Scene::OnUpdate");
         // Update all script components
         auto scriptEntities = GetEntitiesWithComponent<ScriptComponent>();
         for (auto& entity : scriptEntities) {
@@ -0,0 +1,932 @@
+#include "Shader.h"
+#include "Logger.h"
+#include "UniformBuffer.h"
+#include "ProgramBinaryCache.h"
+#include "MaterialTable.h"
+#include "RenderThread.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace Klein {
+
+    // ===== Default shader sources =====
+    // The default shader is a permutation family: ALBEDO_MAP, NORMAL_MAP, SHADOWS and
+    // INSTANCED select specialised code. RUNTIME_FEATURES builds the uber variant that
+    // branches on uniforms instead; it stands in while a variant compiles
+    static const char* s_defaultVertexSrc = R"(
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+layout(location = 1) in vec3 a_Normal;
+layout(location = 2) in vec2 a_TexCoords;
+layout(location = 3) in vec3 a_Tangent;
+layout(location = 4) in vec3 a_Bitangent;
+#ifdef INSTANCED
+layout(location = 5) in mat4 a_Model; // Per instance
+#else
+uniform mat4 u_Model;
+#define a_Model u_Model
+#endif
+
+layout(std140) uniform Camera {
+    mat4 viewProjection;
+    mat4 view;
+    mat4 projection;
+    vec3 position;
+} u_Camera;
+
+out vec3 v_WorldPos;
+out vec3 v_Normal;
+out vec2 v_TexCoords;
+out float v_ViewDepth;
+#ifdef NORMAL_MAP
+out vec3 v_Tangent;
+out vec3 v_Bitangent;
+#endif
+#ifdef MATERIAL_TABLE
+layout(location = 9) in uvec2 a_InstanceInfo; // Per instance: material index, flags
+flat out uvec2 v_InstanceInfo;
+#endif
+
+invariant gl_Position; // Must match the depth pre-pass exactly
+
+void main() {
+    vec4 worldPos = a_Model * vec4(a_Position, 1.0);
+    v_WorldPos = worldPos.xyz;
+    v_ViewDepth = -(u_Camera.view * worldPos).z;
+    v_Normal = mat3(transpose(inverse(a_Model))) * a_Normal;
+#ifdef NORMAL_MAP
+    v_Tangent = mat3(a_Model) * a_Tangent;
+    v_Bitangent = mat3(a_Model) * a_Bitangent;
+#endif
+    v_TexCoords = a_TexCoords;
+#ifdef MATERIAL_TABLE
+    v_InstanceInfo = a_InstanceInfo;
+#endif
+    gl_Position = u_Camera.viewProjection * worldPos;
+}
+)";
+
+    // Lighting shared by every lit fragment shader: engine blocks, shadows, and the
+    // directional + clustered point light loops. Concatenated in front of a main()
+    static const char* s_litFragmentCommonSrc = R"(
+#version 410 core
+layout(std140) uniform Camera {
+    mat4 viewProjection;
+    mat4 view;
+    mat4 projection;
+    vec3 position;
+} u_Camera;
+
+layout(std140) uniform Lights {
+    uvec4 u_ClusterCounts; // w = 1: depth slices are linear (orthographic view)
+    vec4 u_ClusterParams;  // xy = tile size, z = slice scale, w = slice bias
+    int u_DirLightCount;
+    int u_PointLightCount;
+};
+
+layout(std140) uniform Shadow {
+    mat4 u_CascadeViewProj[4];
+    vec4 u_CascadeSplits;  // View depth at the far end of each cascade
+    vec4 u_ShadowParams;   // x = enabled, y = depth bias, z = texel size
+};
+
+uniform samplerBuffer u_LightData;     // 2 texels per light: (position|direction, range), (color, intensity)
+uniform usamplerBuffer u_ClusterGrid;  // (offset, count) per cluster
+uniform usamplerBuffer u_LightIndices;
+uniform sampler2DArrayShadow u_ShadowMap;
+
+in vec3 v_WorldPos;
+in vec3 v_Normal;
+in vec2 v_TexCoords;
+in float v_ViewDepth;
+
+out vec4 FragColor;
+
+struct Surface {
+    vec3 albedo;
+    float metallic;
+    float roughness;
+    float ao;
+    vec3 N;
+    vec3 V;
+};
+
+vec3 Shade(Surface s, vec3 L, vec3 radiance) {
+    float NdotL = max(dot(s.N, L), 0.0);
+    vec3 H = normalize(L + s.V);
+    float shininess = mix(128.0, 4.0, s.roughness);
+    float spec = pow(max(dot(s.N, H), 0.0), shininess) * (1.0 - s.roughness);
+    vec3 specColor = mix(vec3(0.04), s.albedo, s.metallic);
+    vec3 diffuse = s.albedo * (1.0 - s.metallic);
+    return (diffuse + specColor * spec) * radiance * NdotL;
+}
+
+float ShadowFactor(vec3 N, vec3 L) {
+    if (u_ShadowParams.x == 0.0 || v_ViewDepth > u_CascadeSplits.w) {
+        return 1.0;
+    }
+
+    int cascade = 0;
+    for (int i = 0; i < 3; i++) {
+        if (v_ViewDepth > u_CascadeSplits[i]) cascade = i + 1;
+    }
+
+    vec4 clip = u_CascadeViewProj[cascade] * vec4(v_WorldPos, 1.0);
+    vec3 coords = clip.xyz / clip.w * 0.5 + 0.5;
+    float bias = u_ShadowParams.y * (1.0 + 2.0 * (1.0 - max(dot(N, L), 0.0)));
+
+    // 3x3 PCF on top of the hardware 2x2 comparison filter
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            vec2 offset = vec2(x, y) * u_ShadowParams.z;
+            lit += texture(u_ShadowMap, vec4(coords.xy + offset, float(cascade), coords.z - bias));
+        }
+    }
+    return lit / 9.0;
+}
+
+vec3 ComputeLighting(Surface s, bool receiveShadows) {
+    vec3 color = vec3(0.0);
+    for (int i = 0; i < u_DirLightCount; i++) {
+        vec4 direction = texelFetch(u_LightData, i * 2);
+        vec4 light = texelFetch(u_LightData, i * 2 + 1);
+        vec3 L = normalize(-direction.xyz);
+        float shadow = (i == 0 && receiveShadows) ? ShadowFactor(s.N, L) : 1.0;
+        color += Shade(s, L, light.rgb * light.a * shadow);
+    }
+
+    // Only the point lights assigned to this fragment's cluster
+    float sliceDepth = u_ClusterCounts.w != 0u ? v_ViewDepth : log(max(v_ViewDepth, 1e-3));
+    uvec3 cluster = uvec3(
+        uvec2(gl_FragCoord.xy / u_ClusterParams.xy),
+        uint(max(sliceDepth * u_ClusterParams.z + u_ClusterParams.w, 0.0))
+    );
+    cluster = min(cluster, u_ClusterCounts.xyz - 1u);
+    int clusterIndex = int(cluster.x + cluster.y * u_ClusterCounts.x + cluster.z * u_ClusterCounts.x * u_ClusterCounts.y);
+    uvec2 cell = texelFetch(u_ClusterGrid, clusterIndex).xy;
+
+    for (uint i = 0u; i < cell.y; i++) {
+        int index = int(texelFetch(u_LightIndices, int(cell.x + i)).r);
+        vec4 positionRange = texelFetch(u_LightData, index * 2);
+        vec4 light = texelFetch(u_LightData, index * 2 + 1);
+
+        vec3 toLight = positionRange.xyz - v_WorldPos;
+        float dist = length(toLight);
+        float falloff = clamp(1.0 - dist / positionRange.w, 0.0, 1.0);
+        vec3 radiance = light.rgb * light.a * falloff * falloff;
+        color += Shade(s, toLight / max(dist, 1e-4), radiance);
+    }
+
+    vec3 ambient = vec3(0.03) * s.albedo * s.ao;
+    return ambient + color;
+}
+)";
+
+    static const char* s_defaultFragmentMainSrc = R"(
+layout(std140) uniform MaterialBlock {
+    vec3 albedo;
+    float metallic;
+    float roughness;
+    float ao;
+    int useAlbedoMap;
+} u_Material;
+
+uniform sampler2D u_AlbedoMap;
+#ifdef NORMAL_MAP
+uniform sampler2D u_NormalMap;
+in vec3 v_Tangent;
+in vec3 v_Bitangent;
+#endif
+#ifdef RUNTIME_FEATURES
+uniform int u_ReceiveShadows;
+#endif
+
+void main() {
+    Surface s;
+    s.albedo = u_Material.albedo;
+#if defined(ALBEDO_MAP)
+    s.albedo *= texture(u_AlbedoMap, v_TexCoords).rgb;
+#elif defined(RUNTIME_FEATURES)
+    if (u_Material.useAlbedoMap == 1) {
+        s.albedo *= texture(u_AlbedoMap, v_TexCoords).rgb;
+    }
+#endif
+    s.metallic = u_Material.metallic;
+    s.roughness = u_Material.roughness;
+    s.ao = u_Material.ao;
+    s.N = normalize(v_Normal);
+#ifdef NORMAL_MAP
+    mat3 tbn = mat3(normalize(v_Tangent), normalize(v_Bitangent), s.N);
+    // z is rebuilt from xy so two-channel (BC5) normal maps work too
+    vec3 tangentNormal;
+    tangentNormal.xy = texture(u_NormalMap, v_TexCoords).xy * 2.0 - 1.0;
+    tangentNormal.z = sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
+    s.N = normalize(tbn * tangentNormal);
+#endif
+    s.V = normalize(u_Camera.position - v_WorldPos);
+
+#if defined(SHADOWS)
+    bool receiveShadows = true;
+#elif defined(RUNTIME_FEATURES)
+    bool receiveShadows = u_ReceiveShadows != 0;
+#else
+    bool receiveShadows = false;
+#endif
+    FragColor = vec4(ComputeLighting(s, receiveShadows), 1.0);
+}
+)";
+
+    // Batched path (GL 4.3): materials come from the MaterialTable SSBO, indexed per
+    // instance, so one draw covers every material using a mesh. Built from the default
+    // vertex shader with MATERIAL_TABLE and NORMAL_MAP defined
+    static const char* s_batchedFragmentMainSrc = R"(
+struct MaterialData {
+    vec4 albedoMetallic;
+    vec4 roughnessAo;   // x = roughness, y = ao
+    uvec4 albedoMap;    // w = present; BINDLESS: xy = handle, otherwise x = array, y = layer
+    uvec4 normalMap;
+};
+
+layout(std430, binding = 3) readonly buffer Materials { MaterialData materials[]; };
+
+flat in uvec2 v_InstanceInfo;   // x = material, y = flags (1 = receive shadows)
+in vec3 v_Tangent;
+in vec3 v_Bitangent;
+
+#ifdef BINDLESS
+vec4 SampleMap(uvec4 map, vec2 uv, vec2 dx, vec2 dy) {
+    return textureGrad(sampler2D(map.xy), uv, dx, dy);
+}
+#else
+uniform sampler2DArray u_MaterialArrays[8];
+
+// Sampler arrays need dynamically uniform indices, so the array is picked by branch
+vec4 SampleMap(uvec4 map, vec2 uv, vec2 dx, vec2 dy) {
+    vec3 coord = vec3(uv, float(map.y));
+    switch (map.x) {
+        case 0u: return textureGrad(u_MaterialArrays[0], coord, dx, dy);
+        case 1u: return textureGrad(u_MaterialArrays[1], coord, dx, dy);
+        case 2u: return textureGrad(u_MaterialArrays[2], coord, dx, dy);
+        case 3u: return textureGrad(u_MaterialArrays[3], coord, dx, dy);
+        case 4u: return textureGrad(u_MaterialArrays[4], coord, dx, dy);
+        case 5u: return textureGrad(u_MaterialArrays[5], coord, dx, dy);
+        case 6u: return textureGrad(u_MaterialArrays[6], coord, dx, dy);
+        case 7u: return textureGrad(u_MaterialArrays[7], coord, dx, dy);
+    }
+    return vec4(1.0);
+}
+#endif
+
+void main() {
+    MaterialData material = materials[v_InstanceInfo.x];
+
+    // Lookups below sit in non-uniform control flow, so gradients are taken here
+    vec2 dx = dFdx(v_TexCoords);
+    vec2 dy = dFdy(v_TexCoords);
+
+    Surface s;
+    s.albedo = material.albedoMetallic.rgb;
+    if (material.albedoMap.w != 0u) {
+        s.albedo *= SampleMap(material.albedoMap, v_TexCoords, dx, dy).rgb;
+    }
+    s.metallic = material.albedoMetallic.a;
+    s.roughness = material.roughnessAo.x;
+    s.ao = material.roughnessAo.y;
+    s.N = normalize(v_Normal);
+    if (material.normalMap.w != 0u) {
+        mat3 tbn = mat3(normalize(v_Tangent), normalize(v_Bitangent), s.N);
+        vec3 tangentNormal;
+        tangentNormal.xy = SampleMap(material.normalMap, v_TexCoords, dx, dy).xy * 2.0 - 1.0;
+        tangentNormal.z = sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
+        s.N = normalize(tbn * tangentNormal);
+    }
+    s.V = normalize(u_Camera.position - v_WorldPos);
+
+    FragColor = vec4(ComputeLighting(s, (v_InstanceInfo.y & 1u) != 0u), 1.0);
+}
+)";
+
+    // Depth-only pass (shadow maps and the depth pre-pass). Same position math as the
+    // default shader so pre-pass depth matches the lit pass bit for bit
+    static const char* s_depthVertexSrc = R"(
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+layout(location = 5) in mat4 a_Model; // Per instance
+
+layout(std140) uniform Camera {
+    mat4 viewProjection;
+    mat4 view;
+    mat4 projection;
+    vec3 position;
+} u_Camera;
+
+invariant gl_Position;
+
+void main() {
+    vec4 worldPos = a_Model * vec4(a_Position, 1.0);
+    gl_Position = u_Camera.viewProjection * worldPos;
+}
+)";
+
+    static const char* s_depthFragmentSrc = R"(
+#version 410 core
+void main() {
+}
+)";
+
+    // GPU-driven path (GL 4.3): per-object data comes from the Objects SSBO, indexed by
+    // an instanced ID attribute that each indirect command's baseInstance offsets
+    static const char* s_gpuDrivenObjectsSrc = R"(
+#version 430 core
+layout(location = 0) in vec3 a_Position;
+layout(location = 1) in vec3 a_Normal;
+layout(location = 2) in vec2 a_TexCoords;
+layout(location = 9) in uint a_ObjectID;
+
+struct ObjectData {
+    mat4 model;
+    vec4 boundsSphere;
+    vec4 albedoMetallic;
+    vec4 roughnessAo;
+    uvec4 info;  // x = mesh, y = flags, z = LOD bias bits, w = alive
+};
+
+layout(std430, binding = 0) readonly buffer Objects { ObjectData objects[]; };
+
+layout(std140) uniform Camera {
+    mat4 viewProjection;
+    mat4 view;
+    mat4 projection;
+    vec3 position;
+} u_Camera;
+
+invariant gl_Position;
+)";
+
+    static const char* s_gpuDrivenVertexMainSrc = R"(
+out vec3 v_WorldPos;
+out vec3 v_Normal;
+out vec2 v_TexCoords;
+out float v_ViewDepth;
+flat out vec4 v_AlbedoMetallic;
+flat out vec3 v_RoughnessAoShadows;
+
+void main() {
+    ObjectData object = objects[a_ObjectID];
+    vec4 worldPos = object.model * vec4(a_Position, 1.0);
+    v_WorldPos = worldPos.xyz;
+    v_ViewDepth = -(u_Camera.view * worldPos).z;
+    v_Normal = mat3(transpose(inverse(object.model))) * a_Normal;
+    v_TexCoords = a_TexCoords;
+    v_AlbedoMetallic = object.albedoMetallic;
+    v_RoughnessAoShadows = vec3(object.roughnessAo.xy, (object.info.y & 2u) != 0u ? 1.0 : 0.0);
+    gl_Position = u_Camera.viewProjection * worldPos;
+}
+)";
+
+    static const char* s_gpuDrivenDepthMainSrc = R"(
+void main() {
+    vec4 worldPos = objects[a_ObjectID].model * vec4(a_Position, 1.0);
+    gl_Position = u_Camera.viewProjection * worldPos;
+}
+)";
+
+    static const char* s_gpuDrivenFragmentMainSrc = R"(
+flat in vec4 v_AlbedoMetallic;
+flat in vec3 v_RoughnessAoShadows;
+
+void main() {
+    Surface s;
+    s.albedo = v_AlbedoMetallic.rgb;
+    s.metallic = v_AlbedoMetallic.a;
+    s.roughness = v_RoughnessAoShadows.x;
+    s.ao = v_RoughnessAoShadows.y;
+    s.N = normalize(v_Normal);
+    s.V = normalize(u_Camera.position - v_WorldPos);
+
+    FragColor = vec4(ComputeLighting(s, v_RoughnessAoShadows.z != 0.0), 1.0);
+}
+)";
+
+    // ===== Shader Implementation =====
+    Shader::Shader(const std::string& vertexSrc, const std::string& fragmentSrc, bool async) {
+        ProgramBinaryCache& cache = ProgramBinaryCache::Get();
+        m_cacheKey = cache.IsEnabled() ? cache.MakeKey(vertexSrc, fragmentSrc) : 0;
+
+        m_program = glCreateProgram();
+        if (cache.IsEnabled() && cache.Load(m_cacheKey, m_program)) {
+            // Block bindings and sampler units aren't part of the binary
+            BindEngineSlots();
+            Reflect();
+            m_status = Status::Ready;
+            return;
+        }
+
+        // A program whose binary was rejected starts over from a fresh object
+        glDeleteProgram(m_program);
+        m_program = glCreateProgram();
+        BeginCompile(vertexSrc, fragmentSrc);
+        if (!async) {
+            Finish();
+        }
+    }
+
+    Shader::~Shader() {
+        GLuint vertexShader = m_vertexShader, fragmentShader = m_fragmentShader, program = m_program;
+        RenderThread::RunOnContext([vertexShader, fragmentShader, program] {
+            if (vertexShader) glDeleteShader(vertexShader);
+            if (fragmentShader) glDeleteShader(fragmentShader);
+            glDeleteProgram(program);
+        });
+    }
+
+    bool Shader::HasParallelCompile() {
+        return GLAD_GL_KHR_parallel_shader_compile || GLAD_GL_ARB_parallel_shader_compile;
+    }
+
+    void Shader::BeginCompile(const std::string& vertexSrc, const std::string& fragmentSrc) {
+        // No status queries here: they would wait for the driver's compiler threads
+        m_vertexShader = CompileShader(GL_VERTEX_SHADER, vertexSrc);
+        m_fragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentSrc);
+
+        glAttachShader(m_program, m_vertexShader);
+        glAttachShader(m_program, m_fragmentShader);
+        if (ProgramBinaryCache::Get().IsEnabled()) {
+            glProgramParameteri(m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glLinkProgram(m_program);
+        m_status = Status::Compiling;
+    }
+
+    bool Shader::PollReady() {
+        if (m_status == Status::Compiling && HasParallelCompile()) {
+            GLint completed = 0;
+            glGetProgramiv(m_program, GL_COMPLETION_STATUS_KHR, &completed);
+            if (!completed) return false;
+        }
+        Finish();
+        return m_status == Status::Ready;
+    }
+
+    void Shader::Finish() {
+        if (m_status != Status::Compiling) return;
+
+        bool compiled = CheckShader(m_vertexShader, GL_VERTEX_SHADER);
+        compiled = CheckShader(m_fragmentShader, GL_FRAGMENT_SHADER) && compiled;
+
+        GLint linked = 0;
+        glGetProgramiv(m_program, GL_LINK_STATUS, &linked);
+        if (!linked && compiled) {
+            GLint length = 0;
+            glGetProgramiv(m_program, GL_INFO_LOG_LENGTH, &length);
+            std::vector<char> log(length + 1, '\0');
+            glGetProgramInfoLog(m_program, length, nullptr, log.data());
+            KleinLogger::Logger::EngineError("Shader link failed: %s", log.data());
+        }
+
+        glDetachShader(m_program, m_vertexShader);
+        glDetachShader(m_program, m_fragmentShader);
+        glDeleteShader(m_vertexShader);
+        glDeleteShader(m_fragmentShader);
+        m_vertexShader = 0;
+        m_fragmentShader = 0;
+
+        if (!linked) {
+            m_status = Status::Failed;
+            return;
+        }
+
+        ProgramBinaryCache::Get().Store(m_cacheKey, m_program);
+        BindEngineSlots();
+        Reflect();
+        m_status = Status::Ready;
+    }
+
+    void Shader::Bind() const {
+        glUseProgram(m_program);
+    }
+
+    void Shader::Unbind() const {
+        glUseProgram(0);
+    }
+
+    GLuint Shader::CompileShader(GLenum type, const std::string& source) {
+        GLuint shader = glCreateShader(type);
+        const char* src = source.c_str();
+        glShaderSource(shader, 1, &src, nullptr);
+        glCompileShader(shader);
+        return shader;
+    }
+
+    bool Shader::CheckShader(GLuint shader, GLenum type) {
+        GLint compiled = 0;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            GLint length = 0;
+            glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+            std::vector<char> log(length + 1, '\0');
+            glGetShaderInfoLog(shader, length, nullptr, log.data());
+            KleinLogger::Logger::EngineError("%s shader compilation failed: %s",
+                type == GL_VERTEX_SHADER ? "Vertex" : "Fragment", log.data());
+        }
+        return compiled != 0;
+    }
+
+    void Shader::BindEngineSlots() {
+        // GLSL 4.1 has no layout(binding = N), so attach the engine's blocks and samplers here
+        static const struct { const char* name; GLuint binding; } kBlocks[] = {
+            { "Camera", UniformBinding::Camera },
+            { "Lights", UniformBinding::Lights },
+            { "MaterialBlock", UniformBinding::Material },
+            { "Shadow", UniformBinding::Shadow },
+        };
+        static const struct { const char* name; GLuint slot; } kSamplers[] = {
+            { "u_AlbedoMap", TextureSlot::Albedo },
+            { "u_NormalMap", TextureSlot::Normal },
+            { "u_LightData", TextureSlot::LightData },
+            { "u_ClusterGrid", TextureSlot::ClusterGrid },
+            { "u_LightIndices", TextureSlot::LightIndices },
+            { "u_ShadowMap", TextureSlot::ShadowMap },
+        };
+
+        for (const auto& block : kBlocks) {
+            GLuint index = glGetUniformBlockIndex(m_program, block.name);
+            if (index != GL_INVALID_INDEX) {
+                glUniformBlockBinding(m_program, index, block.binding);
+            }
+        }
+
+        for (const auto& sampler : kSamplers) {
+            GLint location = glGetUniformLocation(m_program, sampler.name);
+            if (location != -1) {
+                glProgramUniform1i(m_program, location, (GLint)sampler.slot);
+            }
+        }
+
+        GLint arrays = glGetUniformLocation(m_program, "u_MaterialArrays");
+        if (arrays != -1) {
+            GLint units[MaterialTable::kMaxArrays];
+            for (GLuint i = 0; i < MaterialTable::kMaxArrays; i++) {
+                units[i] = (GLint)(TextureSlot::MaterialArrays + i);
+            }
+            glProgramUniform1iv(m_program, arrays, MaterialTable::kMaxArrays, units);
+        }
+    }
+
+    void Shader::Reflect() {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(m_program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+        // Power of two with at least twice the entries (arrays may add a second name)
+        uint32_t size = 8;
+        while (size < (uint32_t)count * 4) {
+            size <<= 1;
+        }
+        m_uniformTable.assign(size, UniformSlot{});
+        m_uniformMask = size - 1;
+
+        std::vector<char> name(maxLength + 1, '\0');
+        for (GLint i = 0; i < count; i++) {
+            GLsizei length = 0;
+            GLint arraySize = 0;
+            GLenum type = 0;
+            glGetActiveUniform(m_program, (GLuint)i, (GLsizei)name.size(), &length, &arraySize, &type, name.data());
+
+            // Uniform block members have no location
+            GLint location = glGetUniformLocation(m_program, name.data());
+            if (location == -1) continue;
+
+            std::string_view uniformName(name.data(), length);
+            m_uniforms.push_back({ std::string(uniformName), location, type, arraySize });
+
+            uint32_t state = (uint32_t)m_uniformStates.size();
+            m_uniformStates.push_back(UniformState{ location });
+            InsertUniform(HashUniformName(uniformName), state);
+
+            // Arrays are reported as "name[0]"; setters use the bare name
+            if (uniformName.size() > 3 && uniformName.substr(uniformName.size() - 3) == "[0]") {
+                InsertUniform(HashUniformName(uniformName.substr(0, uniformName.size() - 3)), state);
+            }
+        }
+
+        glGetProgramiv(m_program, GL_ACTIVE_ATTRIBUTES, &count);
+        glGetProgramiv(m_program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+        name.assign(maxLength + 1, '\0');
+        for (GLint i = 0; i < count; i++) {
+            GLsizei length = 0;
+            GLint arraySize = 0;
+            GLenum type = 0;
+            glGetActiveAttrib(m_program, (GLuint)i, (GLsizei)name.size(), &length, &arraySize, &type, name.data());
+            m_attributes.push_back({ std::string(name.data(), length), glGetAttribLocation(m_program, name.data()),
+                                     type, arraySize });
+        }
+
+        glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+        name.assign(maxLength + 1, '\0');
+        for (GLint i = 0; i < count; i++) {
+            GLsizei length = 0;
+            GLint binding = 0, dataSize = 0;
+            glGetActiveUniformBlockName(m_program, (GLuint)i, (GLsizei)name.size(), &length, name.data());
+            glGetActiveUniformBlockiv(m_program, (GLuint)i, GL_UNIFORM_BLOCK_BINDING, &binding);
+            glGetActiveUniformBlockiv(m_program, (GLuint)i, GL_UNIFORM_BLOCK_DATA_SIZE, &dataSize);
+            m_uniformBlocks.push_back({ std::string(name.data(), length), (GLuint)i, binding, dataSize });
+        }
+    }
+
+    void Shader::InsertUniform(uint32_t hash, uint32_t state) {
+        uint32_t index = hash & m_uniformMask;
+        while (m_uniformTable[index].state != kEmptySlot) {
+            if (m_uniformTable[index].hash == hash) {
+                KleinLogger::Logger::EngineError("Uniform name hash collision in program %u (0x%08x)", m_program, hash);
+                return;
+            }
+            index = (index + 1) & m_uniformMask;
+        }
+        m_uniformTable[index] = { hash, state };
+    }
+
+    Shader::UniformState* Shader::FindUniform(UniformID id) {
+        if (m_uniformTable.empty()) return nullptr;
+
+        uint32_t index = id.hash & m_uniformMask;
+        while (m_uniformTable[index].state != kEmptySlot) {
+            if (m_uniformTable[index].hash == id.hash) {
+                return &m_uniformStates[m_uniformTable[index].state];
+            }
+            index = (index + 1) & m_uniformMask;
+        }
+        return nullptr;
+    }
+
+    GLint Shader::GetUniformLocation(UniformID id) const {
+        UniformState* state = const_cast<Shader*>(this)->FindUniform(id);
+        return state ? state->location : -1;
+    }
+
+    GLint Shader::PrepareWrite(UniformID id, const void* value, size_t size) {
+        // -1 skips the GL call: the uniform is missing or already holds this value
+        UniformState* state = FindUniform(id);
+        if (!state) return -1;
+
+        if (state->valid && std::memcmp(state->value, value, size) == 0) {
+            m_redundantUniformWrites++;
+            return -1;
+        }
+        std::memcpy(state->value, value, size);
+        state->valid = true;
+        m_uniformWrites++;
+        return state->location;
+    }
+
+    void Shader::SetInt(UniformID id, int value) {
+        GLint location = PrepareWrite(id, &value, sizeof(value));
+        if (location != -1) glUniform1i(location, value);
+    }
+
+    void Shader::SetFloat(UniformID id, float value) {
+        GLint location = PrepareWrite(id, &value, sizeof(value));
+        if (location != -1) glUniform1f(location, value);
+    }
+
+    void Shader::SetVec2(UniformID id, const glm::vec2& value) {
+        GLint location = PrepareWrite(id, &value, sizeof(value));
+        if (location != -1) glUniform2fv(location, 1, glm::value_ptr(value));
+    }
+
+    void Shader::SetVec3(UniformID id, const glm::vec3& value) {
+        GLint location = PrepareWrite(id, &value, sizeof(value));
+        if (location != -1) glUniform3fv(location, 1, glm::value_ptr(value));
+    }
+
+    void Shader::SetVec4(UniformID id, const glm::vec4& value) {
+        GLint location = PrepareWrite(id, &value, sizeof(value));
+        if (location != -1) glUniform4fv(location, 1, glm::value_ptr(value));
+    }
+
+    void Shader::SetMat3(UniformID id, const glm::mat3& value) {
+        GLint location = PrepareWrite(id, &value, sizeof(value));
+        if (location != -1) glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+
+    void Shader::SetMat4(UniformID id, const glm::mat4& value) {
+        GLint location = PrepareWrite(id, &value, sizeof(value));
+        if (location != -1) glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+
+    std::shared_ptr<Shader> Shader::LoadFromFiles(const std::string& vertexPath, const std::string& fragmentPath) {
+        auto readFile = [](const std::string& path, std::string& out) {
+            std::ifstream file(path);
+            if (!file) {
+                KleinLogger::Logger::EngineError("Failed to open shader file: %s", path.c_str());
+                return false;
+            }
+            std::stringstream ss;
+            ss << file.rdbuf();
+            out = ss.str();
+            return true;
+        };
+
+        std::string vertexSrc, fragmentSrc;
+        if (!readFile(vertexPath, vertexSrc) || !readFile(fragmentPath, fragmentSrc)) {
+            return nullptr;
+        }
+
+        return std::make_shared<Shader>(vertexSrc, fragmentSrc);
+    }
+
+    // ===== ShaderLibrary Implementation =====
+    ShaderLibrary& ShaderLibrary::Get() {
+        static ShaderLibrary instance;
+        return instance;
+    }
+
+    void ShaderLibrary::Add(const std::string& name, std::shared_ptr<Shader> shader) {
+        if (m_shaders.contains(name)) {
+            KleinLogger::Logger::EngineWarn("Shader '%s' already exists, replacing", name.c_str());
+        }
+        m_shaders[name] = shader;
+    }
+
+    std::shared_ptr<Shader> ShaderLibrary::Load(const std::string& name,
+                                                const std::string& vertPath,
+                                                const std::string& fragPath) {
+        auto shader = Shader::LoadFromFiles(vertPath, fragPath);
+        if (shader) {
+            Add(name, shader);
+        }
+        return shader;
+    }
+
+    std::shared_ptr<Shader> ShaderLibrary::Get(const std::string& name) {
+        auto it = m_shaders.find(name);
+        if (it == m_shaders.end()) {
+            return nullptr;
+        }
+        return it->second;
+    }
+
+    std::shared_ptr<Shader> ShaderLibrary::AddAsync(const std::string& name,
+                                                    const std::string& vertexSrc,
+                                                    const std::string& fragmentSrc) {
+        auto shader = std::make_shared<Shader>(vertexSrc, fragmentSrc, true);
+        Add(name, shader);
+        if (!shader->IsReady()) {
+            m_pending.push_back(shader);
+        }
+        return shader;
+    }
+
+    void ShaderLibrary::AddPermutations(const std::string& name,
+                                        const std::string& vertexSrc,
+                                        const std::string& fragmentSrc) {
+        Permutations& permutations = m_permutations[name];
+        permutations.vertexSrc = vertexSrc;
+        permutations.fragmentSrc = fragmentSrc;
+        permutations.variants.clear();
+    }
+
+    std::shared_ptr<Shader> ShaderLibrary::GetVariant(const std::string& name, uint32_t features) {
+        auto it = m_permutations.find(name);
+        if (it == m_permutations.end()) {
+            return GetOrFallback(name);
+        }
+
+        auto& variants = it->second.variants;
+        auto variant = variants.find(features);
+        if (variant == variants.end()) {
+            std::string defines;
+            std::string keywords;
+            for (uint32_t i = 0; i < ShaderFeature::Count; i++) {
+                if (features & (1u << i)) {
+                    defines += "#define ";
+                    defines += ShaderFeature::kNames[i];
+                    defines += '\n';
+                    keywords += keywords.empty() ? "" : "|";
+                    keywords += ShaderFeature::kNames[i];
+                }
+            }
+
+            auto shader = std::make_shared<Shader>(InjectDefines(it->second.vertexSrc, defines),
+                                                   InjectDefines(it->second.fragmentSrc, defines), true);
+            if (!shader->IsReady()) {
+                m_pending.push_back(shader);
+            }
+            variant = variants.emplace(features, shader).first;
+
+            // Listed like any other shader, e.g. "default[ALBEDO_MAP|INSTANCED]"
+            m_shaders[name + "[" + keywords + "]"] = shader;
+        }
+
+        return variant->second->IsReady() ? variant->second : GetOrFallback(name);
+    }
+
+    std::string ShaderLibrary::InjectDefines(const std::string& source, const std::string& defines) {
+        // #define lines have to follow the #version directive
+        size_t lineEnd = source.find('\n', source.find("#version"));
+        if (lineEnd == std::string::npos) {
+            return defines + source;
+        }
+        std::string result = source;
+        result.insert(lineEnd + 1, defines);
+        return result;
+    }
+
+    std::string ShaderLibrary::SetVersion(const std::string& source, const std::string& header) {
+        size_t start = source.find("#version");
+        if (start == std::string::npos) {
+            return header + source;
+        }
+        size_t end = source.find('\n', start);
+        std::string result = source;
+        result.replace(start, end == std::string::npos ? std::string::npos : end - start + 1, header);
+        return result;
+    }
+
+    std::shared_ptr<Shader> ShaderLibrary::GetOrFallback(const std::string& name) {
+        auto it = m_shaders.find(name);
+        if (it != m_shaders.end() && it->second->IsReady()) {
+            return it->second;
+        }
+        return Get("default");
+    }
+
+    void ShaderLibrary::Clear() {
+        m_pending.clear();
+        m_permutations.clear();
+        m_shaders.clear();
+    }
+
+    void ShaderLibrary::Update() {
+        if (m_pending.empty()) return;
+
+        if (Shader::HasParallelCompile()) {
+            std::erase_if(m_pending, [](const std::shared_ptr<Shader>& shader) {
+                shader->PollReady();
+                return shader->IsReady() || shader->HasFailed();
+            });
+        } else {
+            // Each one had at least a frame to compile; don't stall on more than one
+            m_pending.front()->Finish();
+            m_pending.erase(m_pending.begin());
+        }
+
+        if (m_pending.empty()) {
+            KleinLogger::Logger::EngineLog("All pending shaders compiled");
+        }
+    }
+
+    void ShaderLibrary::CreateDefaultShaders() {
+        if (GLAD_GL_KHR_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu); // Let the driver pick
+        } else if (GLAD_GL_ARB_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+        }
+
+        // Issue every compile first so the driver can work on them together
+        std::string litCommon = s_litFragmentCommonSrc;
+        std::string litFragment = litCommon + s_defaultFragmentMainSrc;
+        std::string uberDefines = "#define RUNTIME_FEATURES\n#define INSTANCED\n";
+        auto defaultShader = AddAsync("default", InjectDefines(s_defaultVertexSrc, uberDefines),
+                                      InjectDefines(litFragment, uberDefines));
+        auto depthShader = AddAsync("depth", s_depthVertexSrc, s_depthFragmentSrc);
+
+        if (GLAD_GL_VERSION_4_3) {
+            std::string objects = s_gpuDrivenObjectsSrc;
+            AddAsync("gpu_driven", objects + s_gpuDrivenVertexMainSrc, litCommon + s_gpuDrivenFragmentMainSrc);
+            AddAsync("gpu_driven_depth", objects + s_gpuDrivenDepthMainSrc, s_depthFragmentSrc);
+        }
+
+        if (MaterialTable::IsSupported()) {
+            // SSBOs need GLSL 430; the extension must precede everything but #version
+            std::string version = "#version 430 core\n";
+            std::string defines = "#define MATERIAL_TABLE\n#define INSTANCED\n#define NORMAL_MAP\n";
+            if (MaterialTable::HasBindless()) {
+                version += "#extension GL_ARB_bindless_texture : require\n";
+                defines += "#define BINDLESS\n";
+            }
+            AddAsync("batched", SetVersion(InjectDefines(s_defaultVertexSrc, defines), version),
+                     SetVersion(InjectDefines(litCommon + s_batchedFragmentMainSrc, defines), version));
+        }
+
+        // Specialised variants replace the uber shader as they finish; the two most
+        // common ones are started right away
+        AddPermutations("default", s_defaultVertexSrc, litFragment);
+        GetVariant("default", ShaderFeature::Instanced);
+        GetVariant("default", ShaderFeature::Instanced | ShaderFeature::Shadows);
+
+        // The fallback and depth passes are needed from the first frame
+        defaultShader->Finish();
+        depthShader->Finish();
+        std::erase_if(m_pending, [](const std::shared_ptr<Shader>& shader) {
+            return shader->IsReady() || shader->HasFailed();
+        });
+        KleinLogger::Logger::EngineLog("Default shaders created");
+    }
+
+} // namespace Klein
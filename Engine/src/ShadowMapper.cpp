@@ -0,0 +1,200 @@
+#include "ShadowMapper.h"
+#include "Logger.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace Klein {
+
+    ShadowMapper::ShadowMapper(int resolution)
+        : m_resolution(resolution)
+    {
+        m_shadowMap = CreateDepthArray(true);
+        m_staticCache = CreateDepthArray(false);
+
+        glGenFramebuffers(1, &m_drawFBO);
+        glGenFramebuffers(1, &m_readFBO);
+
+        KleinLogger::Logger::EngineLog("Shadow mapper created: %d cascades at %dx%d",
+            kCascadeCount, m_resolution, m_resolution);
+    }
+
+    ShadowMapper::~ShadowMapper() {
+        glDeleteFramebuffers(1, &m_drawFBO);
+        glDeleteFramebuffers(1, &m_readFBO);
+        glDeleteTextures(1, &m_shadowMap);
+        glDeleteTextures(1, &m_staticCache);
+    }
+
+    GLuint ShadowMapper::CreateDepthArray(bool comparison) const {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, m_resolution, m_resolution,
+            kCascadeCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+
+        GLenum filter = comparison ? GL_LINEAR : GL_NEAREST;
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        const float border[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+
+        if (comparison) {
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        }
+
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        return texture;
+    }
+
+    void ShadowMapper::UpdateCascades(const glm::mat4& view, const CameraComponent& camera,
+                                      float aspectRatio, const glm::vec3& lightDirection) {
+        glm::mat4 viewProj[kCascadeCount];
+        float splitFar[kCascadeCount];
+        FitCascades(view, camera, aspectRatio, lightDirection, m_resolution, m_shadowDistance, m_splitLambda,
+                    viewProj, splitFar);
+        for (int i = 0; i < kCascadeCount; i++) {
+            m_cascades[i].viewProj = viewProj[i];
+            m_cascades[i].splitFar = splitFar[i];
+        }
+    }
+
+    void ShadowMapper::FitCascades(const glm::mat4& view, const CameraComponent& camera, float aspectRatio,
+                                   const glm::vec3& lightDirection, int resolution, float shadowDistance,
+                                   float splitLambda, glm::mat4 outViewProj[kCascadeCount],
+                                   float outSplitFar[kCascadeCount]) {
+        float nearClip = camera.nearClip;
+        float farClip = std::min(camera.farClip, shadowDistance);
+
+        glm::vec3 lightDir = glm::normalize(lightDirection);
+        glm::vec3 up = std::abs(lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDir, up);
+
+        float splitNear = nearClip;
+        for (int i = 0; i < kCascadeCount; i++) {
+            // Practical split scheme: blend of logarithmic and uniform distribution
+            float p = (float)(i + 1) / kCascadeCount;
+            float logSplit = nearClip * std::pow(farClip / nearClip, p);
+            float uniformSplit = nearClip + (farClip - nearClip) * p;
+            float splitFar = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+
+            // World space corners of this slice of the camera frustum
+            CameraComponent slice = camera;
+            slice.nearClip = splitNear;
+            slice.farClip = splitFar;
+            glm::mat4 invViewProj = glm::inverse(slice.GetProjection(aspectRatio) * view);
+
+            glm::vec3 corners[8];
+            glm::vec3 center(0.0f);
+            for (int c = 0; c < 8; c++) {
+                glm::vec4 ndc((c & 1) ? 1.0f : -1.0f, (c & 2) ? 1.0f : -1.0f, (c & 4) ? 1.0f : -1.0f, 1.0f);
+                glm::vec4 world = invViewProj * ndc;
+                corners[c] = glm::vec3(world) / world.w;
+                center += corners[c];
+            }
+            center /= 8.0f;
+
+            // Bounding sphere keeps the cascade size constant as the camera rotates
+            float radius = 0.0f;
+            for (const auto& corner : corners) {
+                radius = std::max(radius, glm::length(corner - center));
+            }
+            radius = std::ceil(radius * 16.0f) / 16.0f;
+
+            // Snap the center to whole shadow texels in light space to stop shimmering.
+            // Depth only sets the near/far planes, so it snaps to a much coarser step;
+            // the range grows by that step so the slice stays covered wherever it sits
+            float texelSize = 2.0f * radius / (float)resolution;
+            float depthStep = radius;
+            glm::vec3 centerLS = glm::vec3(lightView * glm::vec4(center, 1.0f));
+            centerLS.x = std::floor(centerLS.x / texelSize) * texelSize;
+            centerLS.y = std::floor(centerLS.y / texelSize) * texelSize;
+            centerLS.z = std::floor(centerLS.z / depthStep) * depthStep;
+
+            // Extend towards the light so casters outside the slice still land in the map
+            float casterMargin = radius * 2.0f;
+            glm::mat4 projection = glm::ortho(
+                centerLS.x - radius, centerLS.x + radius,
+                centerLS.y - radius, centerLS.y + radius,
+                -(centerLS.z + radius + depthStep + casterMargin), -(centerLS.z - radius)
+            );
+
+            outViewProj[i] = projection * lightView;
+            outSplitFar[i] = splitFar;
+            splitNear = splitFar;
+        }
+    }
+
+    ShadowMapper::CascadePlan ShadowMapper::PlanCascade(int cascade, uint64_t staticCasterHash, bool hasDynamicCasters) {
+        Cascade& c = m_cascades[cascade];
+        CascadePlan plan;
+
+        plan.renderStatic = !c.cacheValid
+            || c.cachedViewProj != c.viewProj
+            || c.cachedStaticHash != staticCasterHash;
+
+        // Dynamic casters from last frame must be erased even if none are left now
+        plan.composite = plan.renderStatic || hasDynamicCasters || c.hadDynamic;
+
+        c.cachedViewProj = c.viewProj;
+        c.cachedStaticHash = staticCasterHash;
+        c.cacheValid = true;
+        c.hadDynamic = hasDynamicCasters;
+        return plan;
+    }
+
+    void ShadowMapper::BeginStaticPass(int cascade) {
+        glBindFramebuffer(GL_FRAMEBUFFER, m_drawFBO);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_staticCache, 0, cascade);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+
+        glViewport(0, 0, m_resolution, m_resolution);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    void ShadowMapper::BeginDynamicPass(int cascade) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_readFBO);
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_staticCache, 0, cascade);
+        glReadBuffer(GL_NONE);
+
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_drawFBO);
+        glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_shadowMap, 0, cascade);
+        glDrawBuffer(GL_NONE);
+
+        glBlitFramebuffer(0, 0, m_resolution, m_resolution, 0, 0, m_resolution, m_resolution,
+            GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, m_drawFBO);
+        glViewport(0, 0, m_resolution, m_resolution);
+    }
+
+    void ShadowMapper::EndPasses(GLuint framebuffer, const GLint viewport[4]) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+
+    void ShadowMapper::InvalidateCache() {
+        for (auto& cascade : m_cascades) {
+            cascade.cacheValid = false;
+        }
+    }
+
+    void ShadowMapper::Bind() const {
+        glActiveTexture(GL_TEXTURE0 + TextureSlot::ShadowMap);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_shadowMap);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void ShadowMapper::FillBlock(ShadowBlock& block, bool enabled) const {
+        for (int i = 0; i < kCascadeCount; i++) {
+            block.cascadeViewProj[i] = m_cascades[i].viewProj;
+            block.cascadeSplits[i] = m_cascades[i].splitFar;
+        }
+        block.params = glm::vec4(enabled ? 1.0f : 0.0f, 0.0015f, 1.0f / (float)m_resolution, 0.0f);
+    }
+
+} // namespace Klein
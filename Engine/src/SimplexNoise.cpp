@@ -0,0 +1,299 @@
+#include "SimplexNoise.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KLEIN_NOISE_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// Lets one function use AVX2 without building the whole engine for it
+#if defined(KLEIN_NOISE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define KLEIN_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define KLEIN_TARGET_AVX2
+#endif
+
+namespace Klein {
+
+    namespace {
+
+        constexpr float kF3 = 1.0f / 3.0f;
+        constexpr float kG3 = 1.0f / 6.0f;
+        constexpr float kScale = 32.0f;            // Brings the sum of corners to about [-1, 1]
+
+        std::atomic<int> s_simdEnabled{-1};        // -1 until first queried
+
+        // Ken Perlin's hash-to-gradient: one of 12 cube edge directions (4 repeated)
+        float Gradient(int32_t hash, float x, float y, float z) {
+            int32_t h = hash & 15;
+            float u = h < 8 ? x : y;
+            float v = h < 4 ? y : (h == 12 || h == 14 ? x : z);
+            return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+        }
+
+        float Corner(int32_t hash, float x, float y, float z) {
+            float t = std::max(0.6f - x * x - y * y - z * z, 0.0f);
+            t *= t;
+            return t * t * Gradient(hash, x, y, z);
+        }
+
+        float SampleScalar(const int32_t* perm, float x, float y, float z) {
+            // Skew into simplex cell space and find the cell's origin
+            float s = (x + y + z) * kF3;
+            float fi = std::floor(x + s);
+            float fj = std::floor(y + s);
+            float fk = std::floor(z + s);
+            float t = (fi + fj + fk) * kG3;
+            float x0 = x - (fi - t);
+            float y0 = y - (fj - t);
+            float z0 = z - (fk - t);
+
+            // Which of the six tetrahedra; written as masks so the AVX2 path matches
+            bool xy = x0 >= y0, xz = x0 >= z0, yz = y0 >= z0;
+            float i1 = (xy && xz) ? 1.0f : 0.0f;
+            float j1 = (!xy && yz) ? 1.0f : 0.0f;
+            float k1 = (!xz && !yz) ? 1.0f : 0.0f;
+            float i2 = (xy || xz) ? 1.0f : 0.0f;
+            float j2 = (!xy || yz) ? 1.0f : 0.0f;
+            float k2 = !(xz && yz) ? 1.0f : 0.0f;
+
+            float x1 = x0 - i1 + kG3, y1 = y0 - j1 + kG3, z1 = z0 - k1 + kG3;
+            float x2 = x0 - i2 + 2.0f * kG3, y2 = y0 - j2 + 2.0f * kG3, z2 = z0 - k2 + 2.0f * kG3;
+            float x3 = x0 - 1.0f + 3.0f * kG3, y3 = y0 - 1.0f + 3.0f * kG3, z3 = z0 - 1.0f + 3.0f * kG3;
+
+            int32_t ii = (int32_t)fi & 255, jj = (int32_t)fj & 255, kk = (int32_t)fk & 255;
+            auto hash = [perm, ii, jj, kk](float oi, float oj, float ok) {
+                return perm[ii + (int32_t)oi + perm[jj + (int32_t)oj + perm[kk + (int32_t)ok]]];
+            };
+
+            float n = Corner(hash(0, 0, 0), x0, y0, z0) +
+                      Corner(hash(i1, j1, k1), x1, y1, z1) +
+                      Corner(hash(i2, j2, k2), x2, y2, z2) +
+                      Corner(hash(1, 1, 1), x3, y3, z3);
+            return n * kScale;
+        }
+
+#ifdef KLEIN_NOISE_X86
+        KLEIN_TARGET_AVX2
+        inline __m256 GradientAVX2(__m256i hash, __m256 x, __m256 y, __m256 z) {
+            __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+            __m256 lt8 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+            __m256 lt4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+            __m256 is12or14 = _mm256_castsi256_ps(_mm256_or_si256(_mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)),
+                                                                  _mm256_cmpeq_epi32(h, _mm256_set1_epi32(14))));
+            __m256 u = _mm256_blendv_ps(y, x, lt8);
+            __m256 v = _mm256_blendv_ps(_mm256_blendv_ps(z, x, is12or14), y, lt4);
+
+            // Bits 0 and 1 of the hash become the sign bits of u and v
+            __m256 signU = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1)), 31));
+            __m256 signV = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), 30));
+            return _mm256_add_ps(_mm256_xor_ps(u, signU), _mm256_xor_ps(v, signV));
+        }
+
+        KLEIN_TARGET_AVX2
+        inline __m256 CornerAVX2(__m256i hash, __m256 x, __m256 y, __m256 z) {
+            __m256 t = _mm256_sub_ps(_mm256_set1_ps(0.6f), _mm256_mul_ps(x, x));
+            t = _mm256_sub_ps(t, _mm256_mul_ps(y, y));
+            t = _mm256_sub_ps(t, _mm256_mul_ps(z, z));
+            t = _mm256_max_ps(t, _mm256_setzero_ps());
+            t = _mm256_mul_ps(t, t);
+            return _mm256_mul_ps(_mm256_mul_ps(t, t), GradientAVX2(hash, x, y, z));
+        }
+
+        KLEIN_TARGET_AVX2
+        inline __m256i HashAVX2(const int32_t* perm, __m256i ii, __m256i jj, __m256i kk) {
+            __m256i h = _mm256_i32gather_epi32(perm, kk, 4);
+            h = _mm256_i32gather_epi32(perm, _mm256_add_epi32(jj, h), 4);
+            return _mm256_i32gather_epi32(perm, _mm256_add_epi32(ii, h), 4);
+        }
+
+        KLEIN_TARGET_AVX2
+        void SampleAVX2(const int32_t* perm, const float* px, const float* py, const float* pz, float* out) {
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256 allSet = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            const __m256 g3 = _mm256_set1_ps(kG3);
+
+            __m256 x = _mm256_loadu_ps(px);
+            __m256 y = _mm256_loadu_ps(py);
+            __m256 z = _mm256_loadu_ps(pz);
+
+            __m256 s = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(x, y), z), _mm256_set1_ps(kF3));
+            __m256 fi = _mm256_floor_ps(_mm256_add_ps(x, s));
+            __m256 fj = _mm256_floor_ps(_mm256_add_ps(y, s));
+            __m256 fk = _mm256_floor_ps(_mm256_add_ps(z, s));
+            __m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(fi, fj), fk), g3);
+            __m256 x0 = _mm256_sub_ps(x, _mm256_sub_ps(fi, t));
+            __m256 y0 = _mm256_sub_ps(y, _mm256_sub_ps(fj, t));
+            __m256 z0 = _mm256_sub_ps(z, _mm256_sub_ps(fk, t));
+
+            __m256 xy = _mm256_cmp_ps(x0, y0, _CMP_GE_OQ);
+            __m256 xz = _mm256_cmp_ps(x0, z0, _CMP_GE_OQ);
+            __m256 yz = _mm256_cmp_ps(y0, z0, _CMP_GE_OQ);
+            __m256 i1 = _mm256_and_ps(_mm256_and_ps(xy, xz), one);
+            __m256 j1 = _mm256_and_ps(_mm256_andnot_ps(xy, yz), one);
+            __m256 k1 = _mm256_andnot_ps(_mm256_or_ps(xz, yz), one);
+            __m256 i2 = _mm256_and_ps(_mm256_or_ps(xy, xz), one);
+            __m256 j2 = _mm256_and_ps(_mm256_or_ps(_mm256_xor_ps(xy, allSet), yz), one);
+            __m256 k2 = _mm256_andnot_ps(_mm256_and_ps(xz, yz), one);
+
+            __m256 x1 = _mm256_add_ps(_mm256_sub_ps(x0, i1), g3);
+            __m256 y1 = _mm256_add_ps(_mm256_sub_ps(y0, j1), g3);
+            __m256 z1 = _mm256_add_ps(_mm256_sub_ps(z0, k1), g3);
+            __m256 g3x2 = _mm256_set1_ps(2.0f * kG3);
+            __m256 x2 = _mm256_add_ps(_mm256_sub_ps(x0, i2), g3x2);
+            __m256 y2 = _mm256_add_ps(_mm256_sub_ps(y0, j2), g3x2);
+            __m256 z2 = _mm256_add_ps(_mm256_sub_ps(z0, k2), g3x2);
+            __m256 g3x3 = _mm256_set1_ps(3.0f * kG3);
+            __m256 x3 = _mm256_add_ps(_mm256_sub_ps(x0, one), g3x3);
+            __m256 y3 = _mm256_add_ps(_mm256_sub_ps(y0, one), g3x3);
+            __m256 z3 = _mm256_add_ps(_mm256_sub_ps(z0, one), g3x3);
+
+            const __m256i mask = _mm256_set1_epi32(255);
+            __m256i ii = _mm256_and_si256(_mm256_cvttps_epi32(fi), mask);
+            __m256i jj = _mm256_and_si256(_mm256_cvttps_epi32(fj), mask);
+            __m256i kk = _mm256_and_si256(_mm256_cvttps_epi32(fk), mask);
+            const __m256i oneI = _mm256_set1_epi32(1);
+
+            __m256 n = CornerAVX2(HashAVX2(perm, ii, jj, kk), x0, y0, z0);
+            n = _mm256_add_ps(n, CornerAVX2(HashAVX2(perm,
+                _mm256_add_epi32(ii, _mm256_cvttps_epi32(i1)),
+                _mm256_add_epi32(jj, _mm256_cvttps_epi32(j1)),
+                _mm256_add_epi32(kk, _mm256_cvttps_epi32(k1))), x1, y1, z1));
+            n = _mm256_add_ps(n, CornerAVX2(HashAVX2(perm,
+                _mm256_add_epi32(ii, _mm256_cvttps_epi32(i2)),
+                _mm256_add_epi32(jj, _mm256_cvttps_epi32(j2)),
+                _mm256_add_epi32(kk, _mm256_cvttps_epi32(k2))), x2, y2, z2));
+            n = _mm256_add_ps(n, CornerAVX2(HashAVX2(perm,
+                _mm256_add_epi32(ii, oneI), _mm256_add_epi32(jj, oneI), _mm256_add_epi32(kk, oneI)), x3, y3, z3));
+
+            _mm256_storeu_ps(out, _mm256_mul_ps(n, _mm256_set1_ps(kScale)));
+        }
+#endif
+
+    } // namespace
+
+    SimplexNoise::SimplexNoise(uint32_t seed) {
+        // Fisher-Yates shuffle driven by a PCG-style generator; table is doubled so
+        // hashes can add offsets without wrapping
+        for (int32_t i = 0; i < 256; i++) m_perm[i] = i;
+        uint64_t state = seed * 6364136223846793005ull + 1442695040888963407ull;
+        for (int i = 255; i > 0; i--) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            int j = (int)((state >> 33) % (uint64_t)(i + 1));
+            std::swap(m_perm[i], m_perm[j]);
+        }
+        for (int i = 0; i < 256; i++) m_perm[256 + i] = m_perm[i];
+    }
+
+    float SimplexNoise::Sample(float x, float y, float z) const {
+        return SampleScalar(m_perm, x, y, z);
+    }
+
+    void SimplexNoise::SampleBatch(const float* x, const float* y, const float* z, float* out, size_t count) const {
+        size_t i = 0;
+#ifdef KLEIN_NOISE_X86
+        if (IsSIMDEnabled()) {
+            for (; i + 8 <= count; i += 8) {
+                SampleAVX2(m_perm, x + i, y + i, z + i, out + i);
+            }
+
+            // The tail goes through the same path, so neighbouring batches agree exactly
+            if (i < count) {
+                float tx[8] = {}, ty[8] = {}, tz[8] = {}, tout[8];
+                std::copy(x + i, x + count, tx);
+                std::copy(y + i, y + count, ty);
+                std::copy(z + i, z + count, tz);
+                SampleAVX2(m_perm, tx, ty, tz, tout);
+                std::copy_n(tout, count - i, out + i);
+                return;
+            }
+        }
+#endif
+        for (; i < count; i++) {
+            out[i] = SampleScalar(m_perm, x[i], y[i], z[i]);
+        }
+    }
+
+    float SimplexNoise::Fractal(float x, float y, float z, int octaves, float lacunarity, float gain) const {
+        float sum = 0.0f, amplitude = 1.0f, total = 0.0f;
+        for (int octave = 0; octave < octaves; octave++) {
+            sum += Sample(x, y, z) * amplitude;
+            total += amplitude;
+            x *= lacunarity;
+            y *= lacunarity;
+            z *= lacunarity;
+            amplitude *= gain;
+        }
+        return sum / total;
+    }
+
+    void SimplexNoise::FractalBatch(const float* x, const float* y, const float* z, float* out, size_t count,
+                                    int octaves, float lacunarity, float gain) const {
+        // Scaled coordinates go through small stack blocks
+        constexpr size_t kBlock = 256;
+        float sx[kBlock], sy[kBlock], sz[kBlock], layer[kBlock];
+
+        for (size_t begin = 0; begin < count; begin += kBlock) {
+            size_t n = std::min(kBlock, count - begin);
+            std::copy_n(x + begin, n, sx);
+            std::copy_n(y + begin, n, sy);
+            std::copy_n(z + begin, n, sz);
+            std::fill_n(out + begin, n, 0.0f);
+
+            float amplitude = 1.0f, total = 0.0f;
+            for (int octave = 0; octave < octaves; octave++) {
+                SampleBatch(sx, sy, sz, layer, n);
+                for (size_t i = 0; i < n; i++) {
+                    out[begin + i] += layer[i] * amplitude;
+                    sx[i] *= lacunarity;
+                    sy[i] *= lacunarity;
+                    sz[i] *= lacunarity;
+                }
+                total += amplitude;
+                amplitude *= gain;
+            }
+            for (size_t i = 0; i < n; i++) {
+                out[begin + i] /= total;
+            }
+        }
+    }
+
+    bool SimplexNoise::HasAVX2() {
+#if defined(KLEIN_NOISE_X86) && (defined(__GNUC__) || defined(__clang__))
+        static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return supported;
+#elif defined(KLEIN_NOISE_X86) && defined(_MSC_VER)
+        static const bool supported = [] {
+            int info[4];
+            __cpuid(info, 1);
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool fma = (info[2] & (1 << 12)) != 0;
+            if (!osxsave || !fma || (_xgetbv(0) & 6) != 6) return false;   // OS saves YMM state
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+        }();
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    void SimplexNoise::SetSIMDEnabled(bool enabled) {
+        s_simdEnabled.store(enabled && HasAVX2() ? 1 : 0, std::memory_order_relaxed);
+    }
+
+    bool SimplexNoise::IsSIMDEnabled() {
+        int enabled = s_simdEnabled.load(std::memory_order_relaxed);
+        if (enabled < 0) {
+            enabled = HasAVX2() ? 1 : 0;
+            s_simdEnabled.store(enabled, std::memory_order_relaxed);
+        }
+        return enabled != 0;
+    }
+
+} // namespace Klein
@@ -0,0 +1,248 @@
+#include "TerrainGenerator.h"
+#include "JobSystem.h"
+#include "VoxelWorld.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace Klein {
+
+    namespace {
+
+        struct BiomeParams {
+            glm::vec2 climate;                 // Temperature, humidity where the biome peaks
+            float baseHeight;
+            float amplitude;
+            float overhang;                    // Strength of the 3D density term, in blocks
+            BlockID top;
+            BlockID filler;
+        };
+
+        const BiomeParams kBiomes[] = {
+            { {  0.0f,  0.2f }, 42.0f,  5.0f,  0.0f, TerrainBlock::Grass, TerrainBlock::Dirt },  // Plains
+            { { -0.3f,  0.5f }, 50.0f, 18.0f,  3.0f, TerrainBlock::Grass, TerrainBlock::Dirt },  // Hills
+            { { -0.6f, -0.2f }, 66.0f, 40.0f, 10.0f, TerrainBlock::Stone, TerrainBlock::Stone }, // Mountains
+            { {  0.6f, -0.5f }, 40.0f,  4.0f,  0.0f, TerrainBlock::Sand,  TerrainBlock::Sand },  // Desert
+        };
+
+        constexpr float kBiomeSharpness = 6.0f;    // Higher = narrower transitions
+        constexpr float kHeightFrequency = 0.008f;
+        constexpr float kDetailFrequency = 0.04f;
+        constexpr float kCaveFrequency = 0.045f;
+        constexpr int kFillerDepth = 4;
+
+    } // namespace
+
+    TerrainGenerator::TerrainGenerator(const Settings& settings)
+        : m_settings(settings),
+          m_temperature(settings.seed),
+          m_humidity(settings.seed + 1),
+          m_height(settings.seed + 2),
+          m_detail(settings.seed + 3),
+          m_caves(settings.seed + 4)
+    {
+        static_assert(sizeof(kBiomes) / sizeof(kBiomes[0]) == kBiomeCount, "One entry per biome");
+    }
+
+    void TerrainGenerator::ComputeColumns(int originX, int originZ, ColumnData& out) const {
+        constexpr int kColumns = kSize * kSize;
+        float x[kColumns], z[kColumns], zero[kColumns];
+        for (int i = 0; i < kColumns; i++) {
+            x[i] = (float)(originX + i % kSize);
+            z[i] = (float)(originZ + i / kSize);
+            zero[i] = 0.0f;
+        }
+
+        auto scaled = [](const float* in, float scale, float* result) {
+            for (int i = 0; i < kColumns; i++) result[i] = in[i] * scale;
+        };
+        float sx[kColumns], sz[kColumns], temperature[kColumns], humidity[kColumns], shape[kColumns];
+        scaled(x, m_settings.climateScale, sx);
+        scaled(z, m_settings.climateScale, sz);
+        m_temperature.FractalBatch(sx, zero, sz, temperature, kColumns, 2);
+        m_humidity.FractalBatch(sx, zero, sz, humidity, kColumns, 2);
+        scaled(x, kHeightFrequency, sx);
+        scaled(z, kHeightFrequency, sz);
+        m_height.FractalBatch(sx, zero, sz, shape, kColumns, 5);
+
+        for (int i = 0; i < kColumns; i++) {
+            glm::vec2 climate(temperature[i], humidity[i]);
+            float weights[kBiomeCount];
+            float total = 0.0f;
+            int strongest = 0;
+            for (int b = 0; b < kBiomeCount; b++) {
+                glm::vec2 offset = climate - kBiomes[b].climate;
+                weights[b] = std::exp(-kBiomeSharpness * glm::dot(offset, offset));
+                total += weights[b];
+                if (weights[b] > weights[strongest]) strongest = b;
+            }
+
+            float height = 0.0f, overhang = 0.0f;
+            for (int b = 0; b < kBiomeCount; b++) {
+                float w = weights[b] / total;
+                height += w * (kBiomes[b].baseHeight + kBiomes[b].amplitude * shape[i]);
+                overhang += w * kBiomes[b].overhang;
+            }
+            out.height[i] = height;
+            out.overhang[i] = overhang;
+            out.biome[i] = (Biome)strongest;
+        }
+    }
+
+    VoxelChunk TerrainGenerator::GenerateChunk(const glm::ivec3& chunkCoord) const {
+        KLEIN_PROFILE_SCOPE("TerrainGenerator::GenerateChunk");
+        constexpr int kColumns = kSize * kSize;
+        glm::ivec3 origin = chunkCoord * kSize;
+
+        ColumnData columns;
+        ComputeColumns(origin.x, origin.z, columns);
+
+        float lowest = columns.height[0], highest = columns.height[0], maxOverhang = 0.0f;
+        for (int i = 0; i < kColumns; i++) {
+            lowest = std::min(lowest, columns.height[i] - columns.overhang[i]);
+            highest = std::max(highest, columns.height[i] + columns.overhang[i]);
+            maxOverhang = std::max(maxOverhang, columns.overhang[i]);
+        }
+
+        // Entirely above the terrain and the sea
+        if (origin.y > highest && origin.y > m_settings.seaLevel) {
+            return VoxelChunk();
+        }
+
+        // Density for the chunk's layers plus the one above, which decides the top layer's surface
+        constexpr int kLayers = kSize + 1;
+        constexpr int kSamples = kColumns * kLayers;
+        std::vector<float> density(kSamples);
+        for (int layer = 0; layer < kLayers; layer++) {
+            float wy = (float)(origin.y + layer);
+            for (int i = 0; i < kColumns; i++) {
+                density[layer * kColumns + i] = columns.height[i] - wy;
+            }
+        }
+
+        bool nearSurface = origin.y <= highest + maxOverhang && origin.y + kLayers >= lowest - maxOverhang;
+        std::vector<float> sx, sy, sz, noise;
+        auto fillCoordinates = [&](int layers, float frequency, float offset) {
+            sx.resize(kColumns * layers);
+            sy.resize(kColumns * layers);
+            sz.resize(kColumns * layers);
+            noise.resize(kColumns * layers);
+            for (int layer = 0; layer < layers; layer++) {
+                for (int i = 0; i < kColumns; i++) {
+                    int index = layer * kColumns + i;
+                    sx[index] = (float)(origin.x + i % kSize) * frequency + offset;
+                    sy[index] = (float)(origin.y + layer) * frequency;
+                    sz[index] = (float)(origin.z + i / kSize) * frequency;
+                }
+            }
+        };
+
+        if (maxOverhang > 0.5f && nearSurface) {
+            fillCoordinates(kLayers, kDetailFrequency, 0.0f);
+            m_detail.FractalBatch(sx.data(), sy.data(), sz.data(), noise.data(), kSamples, 2);
+            for (int index = 0; index < kSamples; index++) {
+                density[index] += columns.overhang[index % kColumns] * noise[index];
+            }
+        }
+
+        // Tunnels where two noise fields are both near zero
+        std::vector<uint8_t> cave(kColumns * kSize, 0);
+        if (m_settings.caveThreshold > 0.0f && origin.y < highest) {
+            constexpr int kCaveSamples = kColumns * kSize;
+            fillCoordinates(kSize, kCaveFrequency, 0.0f);
+            std::vector<float> first(kCaveSamples);
+            m_caves.SampleBatch(sx.data(), sy.data(), sz.data(), first.data(), kCaveSamples);
+            fillCoordinates(kSize, kCaveFrequency, 512.0f);
+            m_caves.SampleBatch(sx.data(), sy.data(), sz.data(), noise.data(), kCaveSamples);
+            for (int index = 0; index < kCaveSamples; index++) {
+                int wy = origin.y + index / kColumns;
+                bool underground = wy > 1 && (float)wy < columns.height[index % kColumns] - 4.0f;
+                cave[index] = underground && std::abs(first[index]) < m_settings.caveThreshold &&
+                              std::abs(noise[index]) < m_settings.caveThreshold;
+            }
+        }
+
+        // Walk each column down from the top, counting solid blocks since the last air
+        std::vector<BlockID> blocks(VoxelChunk::kVolume);
+        for (int i = 0; i < kColumns; i++) {
+            const BiomeParams& biome = kBiomes[(int)columns.biome[i]];
+            float height = columns.height[i];
+            int x = i % kSize, z = i / kSize;
+
+            int depth = 0;
+            if (density[kSize * kColumns + i] > 0.0f) {
+                depth = std::max(1, (int)(height - (float)(origin.y + kSize)));
+            }
+
+            for (int y = kSize - 1; y >= 0; y--) {
+                int wy = origin.y + y;
+                int index = y * kColumns + i;
+                BlockID block = kAirBlock;
+                if (density[index] > 0.0f && !cave[index]) {
+                    if (depth == 0) {
+                        block = wy >= m_settings.snowLine ? TerrainBlock::Snow : biome.top;
+                        if (block == TerrainBlock::Grass && wy <= m_settings.seaLevel + 1) block = TerrainBlock::Sand;
+                    } else if (depth < kFillerDepth) {
+                        block = wy <= m_settings.seaLevel + 1 && biome.filler == TerrainBlock::Dirt
+                              ? TerrainBlock::Sand : biome.filler;
+                    } else {
+                        block = TerrainBlock::Stone;
+                    }
+                    depth++;
+                } else {
+                    depth = 0;
+                    if (!cave[index] && wy <= m_settings.seaLevel) block = TerrainBlock::Water;
+                }
+                blocks[VoxelChunk::Index(x, y, z)] = block;
+            }
+        }
+
+        VoxelChunk chunk;
+        chunk.Assign(blocks.data());
+        return chunk;
+    }
+
+    size_t TerrainGenerator::GenerateRegion(VoxelWorld& world, const glm::ivec3& minChunk,
+                                            const glm::ivec3& maxChunk) const {
+        std::vector<glm::ivec3> coords;
+        for (int y = minChunk.y; y < maxChunk.y; y++) {
+            for (int z = minChunk.z; z < maxChunk.z; z++) {
+                for (int x = minChunk.x; x < maxChunk.x; x++) {
+                    coords.emplace_back(x, y, z);
+                }
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<VoxelChunk> chunks(coords.size());
+        JobSystem::Get().ParallelFor(coords.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                chunks[i] = GenerateChunk(coords[i]);
+            }
+        });
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        size_t generated = 0;
+        for (size_t i = 0; i < coords.size(); i++) {
+            if (chunks[i].IsEmpty()) continue;
+            world.SetChunk(coords[i], std::move(chunks[i]));
+            generated++;
+        }
+
+        KleinLogger::Logger::EngineLog("Generated %zu chunks (%zu non-empty) in %.1f ms, %s noise",
+            coords.size(), generated, seconds * 1000.0, SimplexNoise::IsSIMDEnabled() ? "AVX2" : "scalar");
+        return generated;
+    }
+
+    void TerrainGenerator::ApplyDefaultColors(VoxelWorld& world) {
+        world.SetBlockColor(TerrainBlock::Grass, glm::vec3(0.3f, 0.6f, 0.3f));
+        world.SetBlockColor(TerrainBlock::Dirt, glm::vec3(0.45f, 0.32f, 0.2f));
+        world.SetBlockColor(TerrainBlock::Stone, glm::vec3(0.5f, 0.5f, 0.52f));
+        world.SetBlockColor(TerrainBlock::Sand, glm::vec3(0.86f, 0.8f, 0.55f));
+        world.SetBlockColor(TerrainBlock::Water, glm::vec3(0.2f, 0.35f, 0.7f));
+        world.SetBlockColor(TerrainBlock::Snow, glm::vec3(0.95f, 0.95f, 0.97f));
+    }
+
+} // namespace Klein
@@ -0,0 +1,536 @@
+#include "TextureLoader.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#ifndef STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#endif
+
+// sRGB S3TC tokens come from EXT_texture_sRGB, which GL headers don't always carry
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+namespace Klein {
+
+    namespace {
+        // Largest width or height accepted from a container header
+        constexpr uint32_t kMaxDimension = 1u << 16;
+
+        struct FormatInfo {
+            GLenum internalFormat;
+            int blockBytes;     // Per 4x4 block, or per pixel when uncompressed
+            int channels;
+            bool compressed;
+        };
+
+        constexpr FormatInfo kRGBA8 = { GL_RGBA8, 4, 4, false };
+        constexpr FormatInfo kSRGBA8 = { GL_SRGB8_ALPHA8, 4, 4, false };
+        constexpr FormatInfo kBC1 = { GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 8, 3, true };
+        constexpr FormatInfo kBC1Alpha = { GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 8, 4, true };
+        constexpr FormatInfo kBC1SRGB = { GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, 8, 3, true };
+        constexpr FormatInfo kBC1AlphaSRGB = { GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 8, 4, true };
+        constexpr FormatInfo kBC3 = { GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 16, 4, true };
+        constexpr FormatInfo kBC3SRGB = { GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 16, 4, true };
+        constexpr FormatInfo kBC4 = { GL_COMPRESSED_RED_RGTC1, 8, 1, true };
+        constexpr FormatInfo kBC5 = { GL_COMPRESSED_RG_RGTC2, 16, 2, true };
+        constexpr FormatInfo kBC7 = { GL_COMPRESSED_RGBA_BPTC_UNORM, 16, 4, true };
+        constexpr FormatInfo kBC7SRGB = { GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, 16, 4, true };
+        constexpr FormatInfo kETC2 = { GL_COMPRESSED_RGB8_ETC2, 8, 3, true };
+        constexpr FormatInfo kETC2SRGB = { GL_COMPRESSED_SRGB8_ETC2, 8, 3, true };
+        constexpr FormatInfo kETC2Alpha = { GL_COMPRESSED_RGBA8_ETC2_EAC, 16, 4, true };
+        constexpr FormatInfo kETC2AlphaSRGB = { GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, 16, 4, true };
+        constexpr FormatInfo kASTC4x4 = { GL_COMPRESSED_RGBA_ASTC_4x4_KHR, 16, 4, true };
+        constexpr FormatInfo kASTC4x4SRGB = { GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR, 16, 4, true };
+
+        const FormatInfo* FromVkFormat(uint32_t vkFormat) {
+            switch (vkFormat) {
+                case 37:  return &kRGBA8;
+                case 43:  return &kSRGBA8;
+                case 131: return &kBC1;
+                case 132: return &kBC1SRGB;
+                case 133: return &kBC1Alpha;
+                case 134: return &kBC1AlphaSRGB;
+                case 137: return &kBC3;
+                case 138: return &kBC3SRGB;
+                case 139: return &kBC4;
+                case 141: return &kBC5;
+                case 145: return &kBC7;
+                case 146: return &kBC7SRGB;
+                case 147: return &kETC2;
+                case 148: return &kETC2SRGB;
+                case 151: return &kETC2Alpha;
+                case 152: return &kETC2AlphaSRGB;
+                case 157: return &kASTC4x4;
+                case 158: return &kASTC4x4SRGB;
+                default:  return nullptr;
+            }
+        }
+
+        const FormatInfo* FromDXGIFormat(uint32_t dxgiFormat) {
+            switch (dxgiFormat) {
+                case 28: return &kRGBA8;
+                case 29: return &kSRGBA8;
+                case 71: return &kBC1Alpha;
+                case 72: return &kBC1AlphaSRGB;
+                case 77: return &kBC3;
+                case 78: return &kBC3SRGB;
+                case 80: return &kBC4;
+                case 83: return &kBC5;
+                case 98: return &kBC7;
+                case 99: return &kBC7SRGB;
+                default: return nullptr;
+            }
+        }
+
+        size_t LevelSize(const FormatInfo& format, int width, int height) {
+            if (!format.compressed) {
+                return (size_t)width * height * format.blockBytes;
+            }
+            return (size_t)((width + 3) / 4) * ((height + 3) / 4) * format.blockBytes;
+        }
+
+        bool ReadFile(const std::string& path, std::vector<unsigned char>& out) {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if (!file) return false;
+
+            std::streamsize size = file.tellg();
+            file.seekg(0);
+            out.resize((size_t)size);
+            return (bool)file.read(reinterpret_cast<char*>(out.data()), size);
+        }
+
+        template<typename T>
+        T Read(const unsigned char* data) {
+            T value;
+            std::memcpy(&value, data, sizeof(T));
+            return value;
+        }
+
+        void SetFormat(TextureData& out, const FormatInfo& format) {
+            out.internalFormat = format.internalFormat;
+            out.format = GL_RGBA;
+            out.channels = format.channels;
+            out.compressed = format.compressed;
+            out.generateMips = false;
+        }
+
+        // Appends one mip level, taking 'size' bytes from 'source'
+        void AddLevel(TextureData& out, const unsigned char* source, size_t size, int width, int height) {
+            out.levels.push_back({ out.data.size(), size, width, height });
+            out.data.insert(out.data.end(), source, source + size);
+        }
+
+        // ===== BC1-BC5 decoding =====
+        // How a colour block reads c0 <= c1: BC1 switches to three colours plus black
+        // (transparent in the alpha format), BC2/BC3 colour blocks always use four
+        enum class ColorBlockMode { BC1, BC1Alpha, FourColor };
+
+        void DecodeColorBlock(const unsigned char* block, unsigned char* rgba, ColorBlockMode mode) {
+            uint16_t c0 = Read<uint16_t>(block);
+            uint16_t c1 = Read<uint16_t>(block + 2);
+            uint32_t indices = Read<uint32_t>(block + 4);
+
+            unsigned char palette[4][4];
+            auto expand = [](uint16_t c, unsigned char* out) {
+                out[0] = (unsigned char)(((c >> 11) & 31) * 255 / 31);
+                out[1] = (unsigned char)(((c >> 5) & 63) * 255 / 63);
+                out[2] = (unsigned char)((c & 31) * 255 / 31);
+                out[3] = 255;
+            };
+            expand(c0, palette[0]);
+            expand(c1, palette[1]);
+
+            bool fourColor = c0 > c1 || mode == ColorBlockMode::FourColor;
+            for (int i = 0; i < 3; i++) {
+                if (fourColor) {
+                    palette[2][i] = (unsigned char)((2 * palette[0][i] + palette[1][i]) / 3);
+                    palette[3][i] = (unsigned char)((palette[0][i] + 2 * palette[1][i]) / 3);
+                } else {
+                    palette[2][i] = (unsigned char)((palette[0][i] + palette[1][i]) / 2);
+                    palette[3][i] = 0;
+                }
+            }
+            palette[2][3] = 255;
+            palette[3][3] = (fourColor || mode == ColorBlockMode::BC1) ? 255 : 0;
+
+            for (int i = 0; i < 16; i++) {
+                std::memcpy(rgba + i * 4, palette[(indices >> (i * 2)) & 3], 4);
+            }
+        }
+
+        // BC4 block (also BC3 alpha and each BC5 channel) into every 'stride'th byte
+        void DecodeChannelBlock(const unsigned char* block, unsigned char* out, int stride) {
+            unsigned char values[8];
+            values[0] = block[0];
+            values[1] = block[1];
+            if (values[0] > values[1]) {
+                for (int i = 1; i < 7; i++) {
+                    values[i + 1] = (unsigned char)(((7 - i) * values[0] + i * values[1]) / 7);
+                }
+            } else {
+                for (int i = 1; i < 5; i++) {
+                    values[i + 1] = (unsigned char)(((5 - i) * values[0] + i * values[1]) / 5);
+                }
+                values[6] = 0;
+                values[7] = 255;
+            }
+
+            uint64_t indices = 0;
+            for (int i = 0; i < 6; i++) {
+                indices |= (uint64_t)block[2 + i] << (8 * i);
+            }
+            for (int i = 0; i < 16; i++) {
+                out[i * stride] = values[(indices >> (i * 3)) & 7];
+            }
+        }
+    }
+
+    bool TextureLoader::IsContainerFile(const std::string& path) {
+        auto endsWith = [&path](const char* suffix) {
+            size_t length = std::strlen(suffix);
+            if (path.size() < length) return false;
+            return std::equal(path.end() - length, path.end(), suffix, [](char a, char b) {
+                return (char)std::tolower((unsigned char)a) == b;
+            });
+        };
+        return endsWith(".ktx2") || endsWith(".dds");
+    }
+
+    bool TextureLoader::Load(const std::string& path, TextureData& out) {
+        std::string lower = path;
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        if (lower.size() >= 5 && lower.compare(lower.size() - 5, 5, ".ktx2") == 0) {
+            return LoadKTX2(path, out);
+        }
+        return LoadDDS(path, out);
+    }
+
+    bool TextureLoader::LoadAny(const std::string& path, TextureData& out) {
+        if (IsContainerFile(path)) {
+            return Load(path, out);
+        }
+
+        // Per thread: streamed decodes run on several job workers at once
+        stbi_set_flip_vertically_on_load_thread(true);
+
+        int width = 0, height = 0, channels = 0;
+        unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+        if (!pixels) {
+            return false;
+        }
+
+        FromPixels(pixels, width, height, channels, out);
+        stbi_image_free(pixels);
+        return true;
+    }
+
+    void TextureLoader::FromPixels(const unsigned char* pixels, int width, int height, int channels,
+                                   TextureData& out) {
+        out = TextureData();
+        out.width = width;
+        out.height = height;
+        out.channels = channels;
+        out.generateMips = true;
+        switch (channels) {
+            case 1:  out.internalFormat = GL_R8;    out.format = GL_RED;  break;
+            case 2:  out.internalFormat = GL_RG8;   out.format = GL_RG;   break;
+            case 3:  out.internalFormat = GL_RGB8;  out.format = GL_RGB;  break;
+            default: out.internalFormat = GL_RGBA8; out.format = GL_RGBA; break;
+        }
+
+        size_t size = (size_t)width * height * channels;
+        out.levels = { { 0, size, width, height } };
+        out.data.assign(pixels, pixels + size);
+    }
+
+    bool TextureLoader::LoadKTX2(const std::string& path, TextureData& out) {
+        static const unsigned char kIdentifier[12] = {
+            0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+        };
+        constexpr size_t kHeaderSize = 80;
+        constexpr size_t kLevelIndexEntrySize = 24;
+
+        std::vector<unsigned char> file;
+        if (!ReadFile(path, file) || file.size() < kHeaderSize || std::memcmp(file.data(), kIdentifier, 12) != 0) {
+            KleinLogger::Logger::EngineError("Not a KTX2 file: %s", path.c_str());
+            return false;
+        }
+
+        const unsigned char* header = file.data() + 12;
+        uint32_t vkFormat = Read<uint32_t>(header);
+        uint32_t width = Read<uint32_t>(header + 8);
+        uint32_t height = Read<uint32_t>(header + 12);
+        uint32_t depth = Read<uint32_t>(header + 16);
+        uint32_t levelCount = std::max(Read<uint32_t>(header + 28), 1u);
+        uint32_t supercompression = Read<uint32_t>(header + 32);
+
+        const FormatInfo* format = FromVkFormat(vkFormat);
+        if (!format) {
+            KleinLogger::Logger::EngineError("Unsupported KTX2 format %u: %s", vkFormat, path.c_str());
+            return false;
+        }
+        if (supercompression != 0) {
+            KleinLogger::Logger::EngineError("KTX2 supercompression scheme %u not supported: %s",
+                supercompression, path.c_str());
+            return false;
+        }
+        if (depth > 1 || width == 0 || height == 0) {
+            KleinLogger::Logger::EngineError("Only 2D KTX2 textures are supported: %s", path.c_str());
+            return false;
+        }
+        if (width > kMaxDimension || height > kMaxDimension) {
+            KleinLogger::Logger::EngineError("KTX2 texture too large (%ux%u): %s", width, height, path.c_str());
+            return false;
+        }
+        // Levels past a 1x1 one don't exist
+        levelCount = std::min(levelCount, (uint32_t)FullMipCount((int)width, (int)height));
+        if (kHeaderSize + levelCount * kLevelIndexEntrySize > file.size()) {
+            KleinLogger::Logger::EngineError("Truncated KTX2 level index: %s", path.c_str());
+            return false;
+        }
+
+        out = TextureData();
+        out.width = (int)width;
+        out.height = (int)height;
+        SetFormat(out, *format);
+
+        // Level 0 is the largest; array layers and cube faces past the first are ignored
+        for (uint32_t level = 0; level < levelCount; level++) {
+            const unsigned char* entry = file.data() + kHeaderSize + level * kLevelIndexEntrySize;
+            uint64_t offset = Read<uint64_t>(entry);
+            uint64_t length = Read<uint64_t>(entry + 8);
+
+            int levelWidth = std::max(1, (int)width >> level);
+            int levelHeight = std::max(1, (int)height >> level);
+            size_t size = LevelSize(*format, levelWidth, levelHeight);
+            // Offsets come from the file; written so a huge one can't wrap around
+            if (size > length || offset > file.size() || size > file.size() - offset) {
+                KleinLogger::Logger::EngineError("Truncated KTX2 level %u: %s", level, path.c_str());
+                return false;
+            }
+            AddLevel(out, file.data() + offset, size, levelWidth, levelHeight);
+        }
+
+        // Uncompressed files without a chain still get runtime mips
+        out.generateMips = !out.compressed && levelCount == 1;
+        return true;
+    }
+
+    bool TextureLoader::LoadDDS(const std::string& path, TextureData& out) {
+        constexpr size_t kHeaderSize = 4 + 124;
+        constexpr size_t kDX10HeaderSize = 20;
+        constexpr uint32_t kPixelFormatAlpha = 0x1;
+        constexpr uint32_t kPixelFormatFourCC = 0x4;
+        constexpr uint32_t kPixelFormatRGB = 0x40;
+        auto fourCC = [](const char (&code)[5]) {
+            return (uint32_t)code[0] | ((uint32_t)code[1] << 8) | ((uint32_t)code[2] << 16) | ((uint32_t)code[3] << 24);
+        };
+
+        std::vector<unsigned char> file;
+        if (!ReadFile(path, file) || file.size() < kHeaderSize || Read<uint32_t>(file.data()) != fourCC("DDS ")) {
+            KleinLogger::Logger::EngineError("Not a DDS file: %s", path.c_str());
+            return false;
+        }
+
+        const unsigned char* header = file.data() + 4;
+        uint32_t height = Read<uint32_t>(header + 8);
+        uint32_t width = Read<uint32_t>(header + 12);
+        uint32_t levelCount = std::max(Read<uint32_t>(header + 24), 1u);
+        const unsigned char* pixelFormat = header + 72;
+        uint32_t flags = Read<uint32_t>(pixelFormat + 4);
+        uint32_t code = Read<uint32_t>(pixelFormat + 8);
+
+        const FormatInfo* format = nullptr;
+        size_t dataOffset = kHeaderSize;
+        bool bgra = false;
+        if (flags & kPixelFormatFourCC) {
+            if (code == fourCC("DX10")) {
+                if (file.size() < kHeaderSize + kDX10HeaderSize) {
+                    KleinLogger::Logger::EngineError("Truncated DDS header: %s", path.c_str());
+                    return false;
+                }
+                format = FromDXGIFormat(Read<uint32_t>(file.data() + kHeaderSize));
+                dataOffset += kDX10HeaderSize;
+            } else if (code == fourCC("DXT1")) {
+                format = (flags & kPixelFormatAlpha) ? &kBC1Alpha : &kBC1;
+            } else if (code == fourCC("DXT5")) {
+                format = &kBC3;
+            } else if (code == fourCC("ATI1") || code == fourCC("BC4U")) {
+                format = &kBC4;
+            } else if (code == fourCC("ATI2") || code == fourCC("BC5U")) {
+                format = &kBC5;
+            }
+        } else if ((flags & kPixelFormatRGB) && Read<uint32_t>(pixelFormat + 12) == 32) {
+            // 8-bit RGBA in either channel order
+            uint32_t redMask = Read<uint32_t>(pixelFormat + 16);
+            if (redMask == 0x000000FF || redMask == 0x00FF0000) {
+                format = &kRGBA8;
+                bgra = redMask == 0x00FF0000;
+            }
+        }
+
+        if (!format) {
+            KleinLogger::Logger::EngineError("Unsupported DDS pixel format: %s", path.c_str());
+            return false;
+        }
+        if (width == 0 || height == 0 || width > kMaxDimension || height > kMaxDimension) {
+            KleinLogger::Logger::EngineError("Unsupported DDS size (%ux%u): %s", width, height, path.c_str());
+            return false;
+        }
+        levelCount = std::min(levelCount, (uint32_t)FullMipCount((int)width, (int)height));
+
+        out = TextureData();
+        out.width = (int)width;
+        out.height = (int)height;
+        SetFormat(out, *format);
+        if (bgra) out.format = GL_BGRA;
+
+        // Mip levels follow each other, largest first
+        size_t offset = dataOffset;
+        for (uint32_t level = 0; level < levelCount; level++) {
+            int levelWidth = std::max(1, (int)width >> level);
+            int levelHeight = std::max(1, (int)height >> level);
+            size_t size = LevelSize(*format, levelWidth, levelHeight);
+            if (offset + size > file.size()) {
+                KleinLogger::Logger::EngineError("Truncated DDS level %u: %s", level, path.c_str());
+                return false;
+            }
+            AddLevel(out, file.data() + offset, size, levelWidth, levelHeight);
+            offset += size;
+        }
+
+        out.generateMips = !out.compressed && levelCount == 1;
+        return true;
+    }
+
+    bool TextureLoader::IsFormatSupported(GLenum internalFormat) {
+        switch (internalFormat) {
+            case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+                return GLAD_GL_EXT_texture_compression_s3tc != 0;
+            case GL_COMPRESSED_RED_RGTC1:
+            case GL_COMPRESSED_RG_RGTC2:
+                return true; // Core since 3.0
+            case GL_COMPRESSED_RGBA_BPTC_UNORM:
+            case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+                return GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_compression_bptc;
+            case GL_COMPRESSED_RGB8_ETC2:
+            case GL_COMPRESSED_SRGB8_ETC2:
+            case GL_COMPRESSED_RGBA8_ETC2_EAC:
+            case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+                return GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_ES3_compatibility;
+            case GL_COMPRESSED_RGBA_ASTC_4x4_KHR:
+            case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR:
+                return GLAD_GL_KHR_texture_compression_astc_ldr != 0;
+            default:
+                return true;
+        }
+    }
+
+    bool TextureLoader::HasImmutableStorage() {
+        return GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_storage;
+    }
+
+    int TextureLoader::FullMipCount(int width, int height) {
+        int levels = 1;
+        for (int size = std::max(width, height); size > 1; size >>= 1) {
+            levels++;
+        }
+        return levels;
+    }
+
+    bool TextureLoader::Decompress(TextureData& data) {
+        enum class Codec { BC1, BC1Alpha, BC3, BC4, BC5 };
+        Codec codec;
+        bool srgb = false;
+        switch (data.internalFormat) {
+            case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:         srgb = true; [[fallthrough]];
+            case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:          codec = Codec::BC1; break;
+            case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:   srgb = true; [[fallthrough]];
+            case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:         codec = Codec::BC1Alpha; break;
+            case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:   srgb = true; [[fallthrough]];
+            case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:         codec = Codec::BC3; break;
+            case GL_COMPRESSED_RED_RGTC1:                  codec = Codec::BC4; break;
+            case GL_COMPRESSED_RG_RGTC2:                   codec = Codec::BC5; break;
+            default: return false;
+        }
+        int blockBytes = (codec == Codec::BC3 || codec == Codec::BC5) ? 16 : 8;
+
+        TextureData decoded;
+        decoded.width = data.width;
+        decoded.height = data.height;
+        decoded.channels = 4;
+        decoded.internalFormat = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+        decoded.format = GL_RGBA;
+
+        size_t total = 0;
+        for (const auto& level : data.levels) {
+            total += (size_t)level.width * level.height * 4;
+        }
+        decoded.data.resize(total);
+
+        size_t offset = 0;
+        for (const auto& level : data.levels) {
+            decoded.levels.push_back({ offset, (size_t)level.width * level.height * 4, level.width, level.height });
+            unsigned char* pixels = decoded.data.data() + offset;
+            const unsigned char* block = data.data.data() + level.offset;
+
+            int blocksX = (level.width + 3) / 4;
+            int blocksY = (level.height + 3) / 4;
+            for (int by = 0; by < blocksY; by++) {
+                for (int bx = 0; bx < blocksX; bx++, block += blockBytes) {
+                    unsigned char texels[16 * 4];
+                    switch (codec) {
+                        case Codec::BC1:
+                        case Codec::BC1Alpha:
+                            DecodeColorBlock(block, texels, codec == Codec::BC1Alpha ? ColorBlockMode::BC1Alpha
+                                                                                     : ColorBlockMode::BC1);
+                            break;
+                        case Codec::BC3:
+                            DecodeColorBlock(block + 8, texels, ColorBlockMode::FourColor);
+                            DecodeChannelBlock(block, texels + 3, 4);
+                            break;
+                        case Codec::BC4:
+                        case Codec::BC5:
+                            // Matches what GL returns for RED/RG textures
+                            for (int i = 0; i < 16; i++) {
+                                texels[i * 4 + 1] = 0;
+                                texels[i * 4 + 2] = 0;
+                                texels[i * 4 + 3] = 255;
+                            }
+                            DecodeChannelBlock(block, texels, 4);
+                            if (codec == Codec::BC5) {
+                                DecodeChannelBlock(block + 8, texels + 1, 4);
+                            }
+                            break;
+                    }
+
+                    // Blocks on the right/bottom edge may hang over the level
+                    for (int y = 0; y < 4 && by * 4 + y < level.height; y++) {
+                        for (int x = 0; x < 4 && bx * 4 + x < level.width; x++) {
+                            size_t index = ((size_t)(by * 4 + y) * level.width + (bx * 4 + x)) * 4;
+                            std::memcpy(pixels + index, texels + (y * 4 + x) * 4, 4);
+                        }
+                    }
+                }
+            }
+            offset += decoded.levels.back().size;
+        }
+
+        data = std::move(decoded);
+        return true;
+    }
+
+} // namespace Klein
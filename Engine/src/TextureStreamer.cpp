@@ -0,0 +1,424 @@
+#include "TextureStreamer.h"
+#include "TextureLoader.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Klein {
+
+    TextureStreamer& TextureStreamer::Get() {
+        static TextureStreamer instance;
+        return instance;
+    }
+
+    std::shared_ptr<Texture> TextureStreamer::Load(const std::string& path, Texture::Type type) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        std::weak_ptr<Texture>& cached = m_cache[path];
+        if (auto texture = cached.lock()) {
+            return texture;
+        }
+
+        std::shared_ptr<Texture> texture(new Texture(path, type, Texture::DeferredLoad{}));
+        cached = texture;
+        m_decoding++;
+
+        std::weak_ptr<Texture> weak = texture;
+        JobSystem::Get().Submit([this, path, weak] {
+            KLEIN_PROFILE_SCOPE("TextureStreamer::Decode");
+            auto data = std::make_unique<TextureData>();
+            if (!TextureLoader::LoadAny(path, *data)) {
+                KleinLogger::Logger::EngineError("Failed to load texture: %s", path.c_str());
+                data.reset();
+            } else if (data->compressed && !TextureLoader::IsFormatSupported(data->internalFormat)) {
+                // Only reads the GLAD flags, so no context is needed here
+                if (TextureLoader::Decompress(*data)) {
+                    KleinLogger::Logger::EngineWarn("Compressed format not supported, decoded on the CPU: %s",
+                        path.c_str());
+                } else {
+                    KleinLogger::Logger::EngineError("Compressed format 0x%X not supported by the driver: %s",
+                        data->internalFormat, path.c_str());
+                    data.reset();
+                }
+            }
+            if (data && data->generateMips) {
+                BuildMipChain(*data);
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_decoded.push_back({ weak, std::move(data) });
+            m_decoding--;
+        }, &m_decodeJobs);
+
+        return texture;
+    }
+
+    void TextureStreamer::Update() {
+        KLEIN_PROFILE_SCOPE("TextureStreamer::Update");
+        m_frame++;
+        AcceptDecoded();
+        UpdateResidency();
+        ProcessUploads();
+        RemoveExpired();
+    }
+
+    void TextureStreamer::Shutdown() {
+        JobSystem::Get().Wait(m_decodeJobs);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_decoded.clear();
+            m_cache.clear();
+        }
+
+        for (const Upload& upload : m_uploads) {
+            glDeleteTextures(1, &upload.texture);
+        }
+        m_uploads.clear();
+        m_entries.clear();
+        m_committedBytes = 0;
+
+        for (int i = 0; i < kStagingCount; i++) {
+            if (m_stagingFences[i]) {
+                glDeleteSync(m_stagingFences[i]);
+                m_stagingFences[i] = nullptr;
+            }
+        }
+        if (m_staging[0]) {
+            glDeleteBuffers(kStagingCount, m_staging);
+            std::fill(std::begin(m_staging), std::end(m_staging), 0u);
+        }
+    }
+
+    size_t TextureStreamer::GetPendingCount() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_decoding + m_decoded.size() + m_uploads.size();
+    }
+
+    void TextureStreamer::AcceptDecoded() {
+        std::vector<Decoded> decoded;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            decoded.swap(m_decoded);
+        }
+
+        for (Decoded& item : decoded) {
+            auto texture = item.texture.lock();
+            if (!texture || !item.data) continue;
+
+            auto entry = std::make_unique<Entry>();
+            entry->texture = item.texture;
+            entry->data = std::move(item.data);
+            entry->lastUsed = m_frame;
+
+            const TextureData& data = *entry->data;
+            texture->m_width = data.width;
+            texture->m_height = data.height;
+            texture->m_channels = data.channels;
+
+            // The tail starts at the first level no larger than kTailSize
+            int tail = (int)data.levels.size() - 1;
+            while (tail > 0 && std::max(data.levels[tail - 1].width, data.levels[tail - 1].height) <= kTailSize) {
+                tail--;
+            }
+            entry->tailBase = tail;
+
+            // Tails are small and always loaded, regardless of the budget
+            Entry& added = *entry;
+            m_entries.push_back(std::move(entry));
+            QueueUpload(added, added.tailBase);
+        }
+    }
+
+    void TextureStreamer::UpdateResidency() {
+        for (auto& entry : m_entries) {
+            auto texture = entry->texture.lock();
+            if (!texture) continue;
+
+            uint32_t requested = texture->m_requestedSize.exchange(0, std::memory_order_relaxed);
+            if (requested == 0) continue;
+
+            entry->lastUsed = m_frame;
+            if (HasUpload(entry.get())) continue;
+
+            // One texel per pixel: every halving of the on-screen size drops a level
+            const TextureData::Level& top = entry->data->levels[0];
+            float ratio = (float)std::max(top.width, top.height) / (float)requested;
+            int desired = ratio > 1.0f ? (int)std::floor(std::log2(ratio)) : 0;
+            desired = std::clamp(desired, 0, entry->tailBase);
+
+            // Settle for fewer levels when the budget can't fit them all
+            size_t current = BytesFrom(*entry, entry->committedBase);
+            while (desired < entry->committedBase && !MakeRoom(BytesFrom(*entry, desired) - current, entry.get())) {
+                desired++;
+            }
+            if (desired < entry->committedBase) {
+                QueueUpload(*entry, desired);
+            }
+        }
+    }
+
+    void TextureStreamer::ProcessUploads() {
+        m_uploadedBytes = 0;
+        if (m_uploads.empty()) return;
+
+        if (!m_staging[0]) {
+            CreateStaging();
+        }
+
+        // If the GPU is still reading this buffer, try again next frame rather than stall
+        int index = m_stagingIndex;
+        if (m_stagingFences[index]) {
+            if (glClientWaitSync(m_stagingFences[index], 0, 0) == GL_TIMEOUT_EXPIRED) return;
+            glDeleteSync(m_stagingFences[index]);
+            m_stagingFences[index] = nullptr;
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_staging[index]);
+        auto* mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, kStagingSize,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+        if (!mapped) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return;
+        }
+
+        // A level is copied in whole rows (rows of blocks when compressed), so large
+        // levels spread over several frames
+        struct Copy {
+            GLuint texture;
+            const TextureData* data;
+            int level;
+            int y;
+            int width;
+            int rows;
+            size_t offset;
+            size_t size;
+        };
+        std::vector<Copy> copies;
+        std::vector<Upload> finished;
+
+        size_t budget = std::min(m_uploadBudget, kStagingSize);
+        size_t used = 0;
+        while (!m_uploads.empty() && used < budget) {
+            Upload& upload = m_uploads.front();
+            const TextureData& data = *upload.entry->data;
+            const TextureData::Level& level = data.levels[upload.level];
+
+            int unitRows = data.compressed ? 4 : 1;
+            int unitCount = (level.height + unitRows - 1) / unitRows;
+            size_t unitBytes = level.size / unitCount;
+            size_t units = std::min((size_t)(unitCount - upload.nextUnit), (budget - used) / unitBytes);
+            if (units == 0) {
+                // Always make progress, even with a budget smaller than one row
+                if (used > 0 || unitBytes > kStagingSize) break;
+                units = 1;
+            }
+
+            size_t size = units * unitBytes;
+            std::memcpy(mapped + used, data.data.data() + level.offset + upload.nextUnit * unitBytes, size);
+
+            int y = upload.nextUnit * unitRows;
+            copies.push_back({ upload.texture, &data, upload.level - upload.base, y, level.width,
+                               std::min((int)units * unitRows, level.height - y), used, size });
+            used += size;
+
+            upload.nextUnit += (int)units;
+            if (upload.nextUnit == unitCount) {
+                upload.nextUnit = 0;
+                if (upload.level == upload.base) {
+                    finished.push_back(upload);
+                    m_uploads.pop_front();
+                } else {
+                    upload.level--;
+                }
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (const Copy& copy : copies) {
+            const void* source = reinterpret_cast<const void*>(copy.offset);
+            glBindTexture(GL_TEXTURE_2D, copy.texture);
+            if (copy.data->compressed) {
+                glCompressedTexSubImage2D(GL_TEXTURE_2D, copy.level, 0, copy.y, copy.width, copy.rows,
+                                          copy.data->internalFormat, (GLsizei)copy.size, source);
+            } else {
+                glTexSubImage2D(GL_TEXTURE_2D, copy.level, 0, copy.y, copy.width, copy.rows,
+                                copy.data->format, GL_UNSIGNED_BYTE, source);
+            }
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        m_stagingFences[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_stagingIndex = (index + 1) % kStagingCount;
+        m_uploadedBytes = used;
+
+        // Complete textures replace the live ones; draws already issued keep the old
+        // object alive until the GPU is done with it
+        for (const Upload& upload : finished) {
+            auto texture = upload.entry->texture.lock();
+            if (!texture) {
+                glDeleteTextures(1, &upload.texture);
+                continue;
+            }
+            GLuint replaced = texture->m_textureID;
+            texture->SetTextureID(upload.texture);
+            if (replaced != 0) {
+                glDeleteTextures(1, &replaced);
+            }
+            upload.entry->residentBase = upload.base;
+        }
+    }
+
+    void TextureStreamer::RemoveExpired() {
+        // Decided once per entry: the texture can expire on another thread between two
+        // checks, which would free an entry an upload still points at
+        bool removed = false;
+        for (auto& entry : m_entries) {
+            entry->expired = entry->texture.expired();
+            removed |= entry->expired;
+        }
+        if (!removed) return;
+
+        for (auto it = m_uploads.begin(); it != m_uploads.end();) {
+            if (it->entry->expired) {
+                glDeleteTextures(1, &it->texture);
+                it = m_uploads.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        std::erase_if(m_entries, [this](const std::unique_ptr<Entry>& entry) {
+            if (!entry->expired) return false;
+            m_committedBytes -= BytesFrom(*entry, entry->committedBase);
+            return true;
+        });
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::erase_if(m_cache, [](const auto& item) { return item.second.expired(); });
+    }
+
+    void TextureStreamer::QueueUpload(Entry& entry, int base) {
+        m_committedBytes -= BytesFrom(entry, entry.committedBase);
+        m_committedBytes += BytesFrom(entry, base);
+        entry.committedBase = base;
+
+        // Storage for levels [base, count); filled in by ProcessUploads
+        const TextureData& data = *entry.data;
+        int levelCount = (int)data.levels.size();
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        if (TextureLoader::HasImmutableStorage()) {
+            const TextureData::Level& top = data.levels[base];
+            glTexStorage2D(GL_TEXTURE_2D, levelCount - base, data.internalFormat, top.width, top.height);
+        } else {
+            for (int level = base; level < levelCount; level++) {
+                const TextureData::Level& source = data.levels[level];
+                if (data.compressed) {
+                    glCompressedTexImage2D(GL_TEXTURE_2D, level - base, data.internalFormat, source.width,
+                                           source.height, 0, (GLsizei)source.size, nullptr);
+                } else {
+                    glTexImage2D(GL_TEXTURE_2D, level - base, (GLint)data.internalFormat, source.width,
+                                 source.height, 0, data.format, GL_UNSIGNED_BYTE, nullptr);
+                }
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1 - base);
+        }
+
+        m_uploads.push_back({ &entry, texture, base, levelCount - 1 });
+    }
+
+    // Drops the least recently seen textures to their tail until 'bytes' more fit.
+    // Textures seen this frame, or with an upload in flight, are left alone
+    bool TextureStreamer::MakeRoom(size_t bytes, const Entry* keep) {
+        if (m_committedBytes + bytes <= m_memoryBudget) return true;
+
+        std::vector<Entry*> candidates;
+        for (auto& entry : m_entries) {
+            if (entry.get() != keep && entry->lastUsed < m_frame &&
+                entry->committedBase < entry->tailBase && !HasUpload(entry.get())) {
+                candidates.push_back(entry.get());
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Entry* a, const Entry* b) {
+            return a->lastUsed < b->lastUsed;
+        });
+
+        for (Entry* entry : candidates) {
+            QueueUpload(*entry, entry->tailBase);
+            if (m_committedBytes + bytes <= m_memoryBudget) return true;
+        }
+        return false;
+    }
+
+    size_t TextureStreamer::BytesFrom(const Entry& entry, int base) const {
+        if (base < 0) return 0;
+
+        size_t bytes = 0;
+        for (size_t level = base; level < entry.data->levels.size(); level++) {
+            bytes += entry.data->levels[level].size;
+        }
+        return bytes;
+    }
+
+    bool TextureStreamer::HasUpload(const Entry* entry) const {
+        return std::any_of(m_uploads.begin(), m_uploads.end(), [entry](const Upload& upload) {
+            return upload.entry == entry;
+        });
+    }
+
+    void TextureStreamer::CreateStaging() {
+        glGenBuffers(kStagingCount, m_staging);
+        for (GLuint buffer : m_staging) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, kStagingSize, nullptr, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // 2x2 box filter down to 1x1; odd edges reuse the last row/column
+    void TextureStreamer::BuildMipChain(TextureData& data) {
+        const TextureData::Level base = data.levels[0];
+        size_t pixelSize = base.size / ((size_t)base.width * base.height);
+        data.levels.resize(1);
+        data.data.reserve(base.size + base.size / 3 + 64);
+
+        int width = base.width;
+        int height = base.height;
+        while (width > 1 || height > 1) {
+            const TextureData::Level source = data.levels.back();
+            int levelWidth = std::max(1, width / 2);
+            int levelHeight = std::max(1, height / 2);
+            size_t offset = data.data.size();
+            size_t size = (size_t)levelWidth * levelHeight * pixelSize;
+            data.data.resize(offset + size);
+
+            const unsigned char* src = data.data.data() + source.offset;
+            unsigned char* dst = data.data.data() + offset;
+            for (int y = 0; y < levelHeight; y++) {
+                int y0 = std::min(y * 2, height - 1);
+                int y1 = std::min(y * 2 + 1, height - 1);
+                for (int x = 0; x < levelWidth; x++) {
+                    int x0 = std::min(x * 2, width - 1);
+                    int x1 = std::min(x * 2 + 1, width - 1);
+                    for (size_t c = 0; c < pixelSize; c++) {
+                        unsigned sum = src[((size_t)y0 * width + x0) * pixelSize + c] +
+                                       src[((size_t)y0 * width + x1) * pixelSize + c] +
+                                       src[((size_t)y1 * width + x0) * pixelSize + c] +
+                                       src[((size_t)y1 * width + x1) * pixelSize + c];
+                        dst[((size_t)y * levelWidth + x) * pixelSize + c] = (unsigned char)((sum + 2) / 4);
+                    }
+                }
+            }
+
+            data.levels.push_back({ offset, size, levelWidth, levelHeight });
+            width = levelWidth;
+            height = levelHeight;
+        }
+        data.generateMips = false;
+    }
+
+} // namespace Klein
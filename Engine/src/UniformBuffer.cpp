@@ -0,0 +1,31 @@
+#include "UniformBuffer.h"
+#include "RenderThread.h"
+
+namespace Klein {
+
+    UniformBuffer::UniformBuffer(GLsizeiptr size)
+        : m_size(size)
+    {
+        glGenBuffers(1, &m_buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    UniformBuffer::~UniformBuffer() {
+        // Materials can be released from the update thread
+        GLuint buffer = m_buffer;
+        RenderThread::RunOnContext([buffer] { glDeleteBuffers(1, &buffer); });
+    }
+
+    void UniformBuffer::SetData(const void* data, GLsizeiptr size, GLintptr offset) {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void UniformBuffer::Bind(GLuint binding) const {
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, m_buffer);
+    }
+
+} // namespace Klein
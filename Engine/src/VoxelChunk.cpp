@@ -0,0 +1,183 @@
+#include "VoxelChunk.h"
+#include <cstring>
+
+namespace Klein {
+
+    VoxelChunk::VoxelChunk(BlockID fill) {
+        Fill(fill);
+    }
+
+    void VoxelChunk::Set(int x, int y, int z, BlockID block) {
+        int index = Index(x, y, z);
+        uint32_t oldEntry = ReadIndex(index);
+        if (m_palette[oldEntry] == block) return;
+
+        // Widening keeps existing indices, so oldEntry stays valid
+        uint32_t newEntry = FindOrAddEntry(block);
+        m_counts[oldEntry]--;
+        m_counts[newEntry]++;
+
+        // Back to a single type; drop the index storage
+        if (m_counts[newEntry] == (uint32_t)kVolume) {
+            Fill(block);
+            return;
+        }
+        WriteIndex(index, newEntry);
+    }
+
+    void VoxelChunk::Decode(BlockID* out) const {
+        if (IsUniform()) {
+            for (int i = 0; i < kVolume; i++) out[i] = m_palette[0];
+            return;
+        }
+        for (int i = 0; i < kVolume; i++) {
+            out[i] = m_palette[ReadIndex(i)];
+        }
+    }
+
+    void VoxelChunk::Assign(const BlockID* blocks) {
+        m_palette.clear();
+        m_counts.clear();
+
+        // Generated volumes come in runs, so remembering the last entry skips most searches
+        std::vector<uint16_t> entries(kVolume);
+        BlockID lastBlock = blocks[0];
+        uint32_t lastEntry = UINT32_MAX;
+        for (int i = 0; i < kVolume; i++) {
+            if (blocks[i] != lastBlock || lastEntry == UINT32_MAX) {
+                lastBlock = blocks[i];
+                lastEntry = 0;
+                while (lastEntry < m_palette.size() && m_palette[lastEntry] != lastBlock) lastEntry++;
+                if (lastEntry == m_palette.size()) {
+                    m_palette.push_back(lastBlock);
+                    m_counts.push_back(0);
+                }
+            }
+            m_counts[lastEntry]++;
+            entries[i] = (uint16_t)lastEntry;
+        }
+
+        if (m_palette.size() == 1) {
+            Fill(m_palette[0]);
+            return;
+        }
+
+        m_bitsPerBlock = BitsFor(m_palette.size());
+        m_bits.assign(((size_t)kVolume * m_bitsPerBlock + 63) / 64, 0);
+        for (int i = 0; i < kVolume; i++) {
+            WriteIndex(i, entries[i]);
+        }
+    }
+
+    void VoxelChunk::Fill(BlockID block) {
+        m_palette.assign(1, block);
+        m_counts.assign(1, (uint32_t)kVolume);
+        m_bits.clear();
+        m_bits.shrink_to_fit();
+        m_bitsPerBlock = 0;
+    }
+
+    // Layout: u16 palette size, u8 bits per block, u8 unused, palette (u16 each), index words (u64 each)
+    void VoxelChunk::Serialize(std::vector<uint8_t>& out) const {
+        size_t paletteBytes = m_palette.size() * sizeof(BlockID);
+        size_t bitBytes = m_bits.size() * sizeof(uint64_t);
+        out.resize(4 + paletteBytes + bitBytes);
+
+        auto paletteSize = (uint16_t)m_palette.size();
+        std::memcpy(out.data(), &paletteSize, sizeof(paletteSize));
+        out[2] = (uint8_t)m_bitsPerBlock;
+        out[3] = 0;
+        std::memcpy(out.data() + 4, m_palette.data(), paletteBytes);
+        std::memcpy(out.data() + 4 + paletteBytes, m_bits.data(), bitBytes);
+    }
+
+    bool VoxelChunk::Deserialize(const uint8_t* data, size_t size) {
+        if (size < 4) return false;
+        uint16_t paletteSize;
+        std::memcpy(&paletteSize, data, sizeof(paletteSize));
+        uint32_t bitsPerBlock = data[2];
+        if (paletteSize == 0 || bitsPerBlock != BitsFor(paletteSize)) return false;
+
+        size_t paletteBytes = paletteSize * sizeof(BlockID);
+        size_t words = ((size_t)kVolume * bitsPerBlock + 63) / 64;
+        if (size != 4 + paletteBytes + words * sizeof(uint64_t)) return false;
+
+        VoxelChunk chunk;
+        chunk.m_palette.resize(paletteSize);
+        std::memcpy(chunk.m_palette.data(), data + 4, paletteBytes);
+        chunk.m_bits.resize(words);
+        std::memcpy(chunk.m_bits.data(), data + 4 + paletteBytes, words * sizeof(uint64_t));
+        chunk.m_bitsPerBlock = bitsPerBlock;
+
+        // Counts aren't stored; rebuilding them also checks every index
+        chunk.m_counts.assign(paletteSize, 0);
+        for (int i = 0; i < kVolume; i++) {
+            uint32_t index = chunk.ReadIndex(i);
+            if (index >= paletteSize) return false;
+            chunk.m_counts[index]++;
+        }
+
+        *this = std::move(chunk);
+        return true;
+    }
+
+    size_t VoxelChunk::GetMemoryUsage() const {
+        return sizeof(*this) + m_palette.capacity() * sizeof(BlockID) +
+               m_counts.capacity() * sizeof(uint32_t) + m_bits.capacity() * sizeof(uint64_t);
+    }
+
+    void VoxelChunk::WriteIndex(int block, uint32_t index) {
+        uint32_t bit = (uint32_t)block * m_bitsPerBlock;
+        uint64_t mask = ((1ull << m_bitsPerBlock) - 1) << (bit & 63);
+        uint64_t& word = m_bits[bit >> 6];
+        word = (word & ~mask) | ((uint64_t)index << (bit & 63));
+    }
+
+    uint32_t VoxelChunk::FindOrAddEntry(BlockID block) {
+        uint32_t freeSlot = UINT32_MAX;
+        for (uint32_t i = 0; i < m_palette.size(); i++) {
+            if (m_counts[i] == 0) {
+                if (freeSlot == UINT32_MAX) freeSlot = i;
+            } else if (m_palette[i] == block) {
+                return i;
+            }
+        }
+
+        // Entries whose last block was overwritten are reused before the palette grows
+        if (freeSlot != UINT32_MAX) {
+            m_palette[freeSlot] = block;
+            return freeSlot;
+        }
+
+        m_palette.push_back(block);
+        m_counts.push_back(0);
+        uint32_t bits = BitsFor(m_palette.size());
+        if (bits != m_bitsPerBlock) {
+            Repack(bits);
+        }
+        return (uint32_t)m_palette.size() - 1;
+    }
+
+    void VoxelChunk::Repack(uint32_t bitsPerBlock) {
+        std::vector<uint32_t> indices(kVolume);
+        for (int i = 0; i < kVolume; i++) {
+            indices[i] = ReadIndex(i);
+        }
+
+        m_bitsPerBlock = bitsPerBlock;
+        m_bits.assign(((size_t)kVolume * bitsPerBlock + 63) / 64, 0);
+        for (int i = 0; i < kVolume; i++) {
+            WriteIndex(i, indices[i]);
+        }
+    }
+
+    uint32_t VoxelChunk::BitsFor(size_t paletteSize) {
+        if (paletteSize <= 1) return 0;
+        if (paletteSize <= 2) return 1;
+        if (paletteSize <= 4) return 2;
+        if (paletteSize <= 16) return 4;
+        if (paletteSize <= 256) return 8;
+        return 16;
+    }
+
+} // namespace Klein
@@ -0,0 +1,158 @@
+#include "VoxelMesher.h"
+#include "Profiler.h"
+#include <algorithm>
+
+namespace Klein {
+
+    namespace {
+
+        constexpr int kSize = VoxelChunk::kSize;
+        constexpr int kPadded = kSize + 2;
+
+        // The chunk with a one block border taken from its neighbours
+        struct PaddedVolume {
+            std::vector<BlockID> blocks;
+
+            BlockID At(int x, int y, int z) const {
+                return blocks[(x + 1) + (z + 1) * kPadded + (y + 1) * kPadded * kPadded];
+            }
+            BlockID& At(int x, int y, int z) {
+                return blocks[(x + 1) + (z + 1) * kPadded + (y + 1) * kPadded * kPadded];
+            }
+        };
+
+        void FillPadded(const VoxelMesher::Neighborhood& input, PaddedVolume& volume,
+                        std::vector<BlockID>& scratch) {
+            volume.blocks.assign((size_t)kPadded * kPadded * kPadded, kAirBlock);
+
+            scratch.resize(VoxelChunk::kVolume);
+            input.center->Decode(scratch.data());
+            for (int y = 0; y < kSize; y++) {
+                for (int z = 0; z < kSize; z++) {
+                    std::copy_n(&scratch[VoxelChunk::Index(0, y, z)], kSize, &volume.At(0, y, z));
+                }
+            }
+
+            // Border faces only; edges and corners don't affect face visibility
+            const int last = kSize - 1;
+            for (int a = 0; a < kSize; a++) {
+                for (int b = 0; b < kSize; b++) {
+                    if (const VoxelChunk* n = input.neighbors[0].get()) volume.At(-1, a, b) = n->Get(last, a, b);
+                    if (const VoxelChunk* n = input.neighbors[1].get()) volume.At(kSize, a, b) = n->Get(0, a, b);
+                    if (const VoxelChunk* n = input.neighbors[2].get()) volume.At(a, -1, b) = n->Get(a, last, b);
+                    if (const VoxelChunk* n = input.neighbors[3].get()) volume.At(a, kSize, b) = n->Get(a, 0, b);
+                    if (const VoxelChunk* n = input.neighbors[4].get()) volume.At(a, b, -1) = n->Get(a, b, last);
+                    if (const VoxelChunk* n = input.neighbors[5].get()) volume.At(a, b, kSize) = n->Get(a, b, 0);
+                }
+            }
+        }
+
+    } // namespace
+
+    glm::vec2 VoxelMesher::TexCoordFor(BlockID block) {
+        return glm::vec2(((float)(block % kPaletteWidth) + 0.5f) / (float)kPaletteWidth, 0.5f);
+    }
+
+    void VoxelMesher::Build(const Neighborhood& input, std::vector<Vertex>& outVertices,
+                            std::vector<unsigned int>& outIndices) {
+        KLEIN_PROFILE_SCOPE("VoxelMesher::Build");
+        outVertices.clear();
+        outIndices.clear();
+        if (!input.center || input.center->IsEmpty()) return;
+
+        // Workers mesh many chunks; keep their scratch memory around
+        thread_local PaddedVolume volume;
+        thread_local std::vector<BlockID> scratch;
+        thread_local std::vector<BlockID> mask;
+        FillPadded(input, volume, scratch);
+        mask.resize((size_t)kSize * kSize);
+
+        for (int d = 0; d < 3; d++) {
+            int u = (d + 1) % 3;
+            int v = (d + 2) % 3;
+
+            for (int side = -1; side <= 1; side += 2) {
+                glm::vec3 normal(0.0f);
+                normal[d] = (float)side;
+                glm::vec3 tangent(0.0f);
+                tangent[u] = 1.0f;
+                glm::vec3 bitangent(0.0f);
+                bitangent[v] = (float)side;     // Keeps tangent x bitangent = normal
+
+                for (int slice = 0; slice < kSize; slice++) {
+                    // Faces of this slice that look into air
+                    int pos[3];
+                    pos[d] = slice;
+                    for (int b = 0; b < kSize; b++) {
+                        for (int a = 0; a < kSize; a++) {
+                            pos[u] = a;
+                            pos[v] = b;
+                            BlockID block = volume.At(pos[0], pos[1], pos[2]);
+                            int next[3] = { pos[0], pos[1], pos[2] };
+                            next[d] += side;
+                            bool visible = block != kAirBlock && volume.At(next[0], next[1], next[2]) == kAirBlock;
+                            mask[a + b * kSize] = visible ? block : kAirBlock;
+                        }
+                    }
+
+                    // Grow each face along u, then along v while whole rows match
+                    for (int b = 0; b < kSize; b++) {
+                        for (int a = 0; a < kSize;) {
+                            BlockID block = mask[a + b * kSize];
+                            if (block == kAirBlock) {
+                                a++;
+                                continue;
+                            }
+
+                            int width = 1;
+                            while (a + width < kSize && mask[a + width + b * kSize] == block) width++;
+
+                            int height = 1;
+                            for (; b + height < kSize; height++) {
+                                const BlockID* row = &mask[a + (b + height) * kSize];
+                                if (!std::all_of(row, row + width, [block](BlockID m) { return m == block; })) break;
+                            }
+                            for (int y = 0; y < height; y++) {
+                                std::fill_n(&mask[a + (b + y) * kSize], width, kAirBlock);
+                            }
+
+                            glm::vec3 base(0.0f);
+                            base[d] = (float)(slice + (side > 0 ? 1 : 0));
+                            base[u] = (float)a;
+                            base[v] = (float)b;
+                            glm::vec3 du(0.0f);
+                            du[u] = (float)width;
+                            glm::vec3 dv(0.0f);
+                            dv[v] = (float)height;
+
+                            // Every corner samples the block's palette texel
+                            glm::vec2 uv = TexCoordFor(block);
+                            auto first = (unsigned int)outVertices.size();
+                            outVertices.push_back({ base, normal, uv, tangent, bitangent });
+                            outVertices.push_back({ base + du, normal, uv, tangent, bitangent });
+                            outVertices.push_back({ base + du + dv, normal, uv, tangent, bitangent });
+                            outVertices.push_back({ base + dv, normal, uv, tangent, bitangent });
+
+                            // u x v points along +d, so flip the winding for faces looking down the axis
+                            if (side > 0) {
+                                outIndices.insert(outIndices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+                            } else {
+                                outIndices.insert(outIndices.end(), { first, first + 2, first + 1, first, first + 3, first + 2 });
+                            }
+                            a += width;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::shared_ptr<Mesh> VoxelMesher::BuildMesh(const Neighborhood& input) {
+        thread_local std::vector<Vertex> vertices;
+        thread_local std::vector<unsigned int> indices;
+        Build(input, vertices, indices);
+        if (indices.empty()) return nullptr;
+        return std::make_shared<Mesh>(vertices, indices);
+    }
+
+} // namespace Klein
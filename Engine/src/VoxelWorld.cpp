@@ -0,0 +1,314 @@
+#include "VoxelWorld.h"
+#include "Components.h"
+#include "Scene.h"
+#include "RegionStore.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <string>
+
+namespace Klein {
+
+    namespace {
+
+        constexpr int kSize = VoxelChunk::kSize;
+
+        const glm::ivec3 kNeighborOffsets[6] = {
+            { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 }
+        };
+
+        int FloorDiv(int value, int divisor) {
+            return (value >= 0 ? value : value - divisor + 1) / divisor;
+        }
+
+    } // namespace
+
+    VoxelWorld::VoxelWorld(Scene* scene)
+        : m_scene(scene)
+    {
+        // Flat colours from the palette texture; nearest filtering keeps texels from bleeding
+        m_material = std::make_shared<Material>();
+        m_material->roughness = 0.9f;
+        m_material->sampler.minFilter = GL_NEAREST;
+        m_material->sampler.magFilter = GL_NEAREST;
+        m_material->sampler.wrapS = GL_CLAMP_TO_EDGE;
+        m_material->sampler.wrapT = GL_CLAMP_TO_EDGE;
+
+        m_colors.assign(VoxelMesher::kPaletteWidth, glm::vec3(0.5f));
+    }
+
+    VoxelWorld::~VoxelWorld() {
+        // Jobs write into m_results
+        JobSystem::Get().Wait(m_jobs);
+        for (auto& [coord, slot] : m_chunks) {
+            if (slot.entity) {
+                m_scene->DestroyEntity(slot.entity);
+            }
+        }
+    }
+
+    glm::ivec3 VoxelWorld::ToChunkCoord(const glm::ivec3& position) {
+        return { FloorDiv(position.x, kSize), FloorDiv(position.y, kSize), FloorDiv(position.z, kSize) };
+    }
+
+    BlockID VoxelWorld::GetBlock(const glm::ivec3& position) const {
+        glm::ivec3 coord = ToChunkCoord(position);
+        auto it = m_chunks.find(coord);
+        if (it == m_chunks.end()) return kAirBlock;
+
+        glm::ivec3 local = position - coord * kSize;
+        return it->second.chunk->Get(local.x, local.y, local.z);
+    }
+
+    void VoxelWorld::SetBlock(const glm::ivec3& position, BlockID block) {
+        glm::ivec3 coord = ToChunkCoord(position);
+        auto it = m_chunks.find(coord);
+        if (it == m_chunks.end()) {
+            if (block == kAirBlock) return;
+            it = m_chunks.emplace(coord, ChunkSlot()).first;
+            it->second.chunk = std::make_shared<VoxelChunk>();
+        }
+
+        glm::ivec3 local = position - coord * kSize;
+        ChunkSlot& slot = it->second;
+        if (slot.chunk->Get(local.x, local.y, local.z) == block) return;
+        Writable(slot).Set(local.x, local.y, local.z, block);
+        slot.unsaved = true;
+
+        // Neighbours only see this block if it sits on their border
+        MarkDirty(coord);
+        for (int axis = 0; axis < 3; axis++) {
+            if (local[axis] == 0 || local[axis] == kSize - 1) {
+                glm::ivec3 neighbor = coord;
+                neighbor[axis] += local[axis] == 0 ? -1 : 1;
+                MarkDirty(neighbor);
+            }
+        }
+    }
+
+    void VoxelWorld::SetChunk(const glm::ivec3& chunkCoord, VoxelChunk chunk) {
+        ChunkSlot& slot = m_chunks[chunkCoord];
+        slot.chunk = std::make_shared<VoxelChunk>(std::move(chunk));
+        slot.unsaved = true;
+        MarkDirty(chunkCoord);
+        for (const glm::ivec3& offset : kNeighborOffsets) {
+            MarkDirty(chunkCoord + offset);
+        }
+    }
+
+    void VoxelWorld::RemoveChunk(const glm::ivec3& chunkCoord) {
+        auto it = m_chunks.find(chunkCoord);
+        if (it == m_chunks.end()) return;
+
+        if (it->second.entity) {
+            m_scene->DestroyEntity(it->second.entity);
+        }
+        m_chunks.erase(it);
+        for (const glm::ivec3& offset : kNeighborOffsets) {
+            MarkDirty(chunkCoord + offset);
+        }
+    }
+
+    const VoxelChunk* VoxelWorld::GetChunk(const glm::ivec3& chunkCoord) const {
+        auto it = m_chunks.find(chunkCoord);
+        return it != m_chunks.end() ? it->second.chunk.get() : nullptr;
+    }
+
+    size_t VoxelWorld::Save(RegionStore& store) {
+        // Edits clone a chunk while 'saving' shares it, so an unchanged pointer means
+        // the chunk is exactly what was written
+        std::vector<RegionStore::SaveResult> results;
+        store.TakeSaveResults(results);
+        for (const RegionStore::SaveResult& result : results) {
+            auto it = m_chunks.find(result.coord);
+            if (it == m_chunks.end() || it->second.saving.get() != result.chunk) continue;
+
+            ChunkSlot& slot = it->second;
+            if (result.saved && slot.chunk == slot.saving) {
+                slot.unsaved = false;
+            }
+            slot.saving.reset();
+        }
+
+        std::vector<RegionStore::ChunkSnapshot> snapshots;
+        for (auto& [coord, slot] : m_chunks) {
+            if (!slot.unsaved || slot.saving == slot.chunk) continue;
+            snapshots.emplace_back(coord, slot.chunk);
+            slot.saving = slot.chunk;
+        }
+
+        size_t count = snapshots.size();
+        store.SaveChunks(std::move(snapshots));
+        return count;
+    }
+
+    bool VoxelWorld::LoadChunk(RegionStore& store, const glm::ivec3& chunkCoord) {
+        VoxelChunk chunk;
+        if (!store.LoadChunk(chunkCoord, chunk)) return false;
+
+        SetChunk(chunkCoord, std::move(chunk));
+        m_chunks[chunkCoord].unsaved = false;
+        return true;
+    }
+
+    void VoxelWorld::SetBlockColor(BlockID block, const glm::vec3& color) {
+        if (block >= m_colors.size()) {
+            KleinLogger::Logger::EngineWarn("Block %u has no palette entry; colours go up to %d",
+                block, VoxelMesher::kPaletteWidth - 1);
+            return;
+        }
+        m_colors[block] = color;
+        m_colorsDirty = true;
+    }
+
+    void VoxelWorld::Update() {
+        KLEIN_PROFILE_SCOPE("VoxelWorld::Update");
+        if (m_colorsDirty) {
+            UpdatePalette();
+        }
+        InstallResults();
+        DispatchMeshing();
+    }
+
+    void VoxelWorld::Flush() {
+        Update();
+        while (GetPendingMeshCount() > 0) {
+            JobSystem::Get().Wait(m_jobs);
+            Update();
+        }
+    }
+
+    size_t VoxelWorld::GetMemoryUsage() const {
+        size_t bytes = 0;
+        for (const auto& [coord, slot] : m_chunks) {
+            bytes += slot.chunk->GetMemoryUsage();
+        }
+        return bytes;
+    }
+
+    VoxelChunk& VoxelWorld::Writable(ChunkSlot& slot) {
+        if (slot.chunk.use_count() > 1) {
+            slot.chunk = std::make_shared<VoxelChunk>(*slot.chunk);
+        }
+        return *slot.chunk;
+    }
+
+    void VoxelWorld::MarkDirty(const glm::ivec3& chunkCoord) {
+        auto it = m_chunks.find(chunkCoord);
+        if (it == m_chunks.end()) return;
+
+        ChunkSlot& slot = it->second;
+        slot.version = ++m_nextVersion;
+        if (!slot.dirty) {
+            slot.dirty = true;
+            m_dirty.push_back(chunkCoord);
+        }
+    }
+
+    void VoxelWorld::DispatchMeshing() {
+        if (m_dirty.empty() || m_inFlight >= kMaxJobsInFlight) return;
+
+        // Nearest first; the rest wait for a later frame
+        glm::vec3 focus = m_focus / (float)kSize - 0.5f;
+        std::sort(m_dirty.begin(), m_dirty.end(), [&focus](const glm::ivec3& a, const glm::ivec3& b) {
+            glm::vec3 da = glm::vec3(a) - focus;
+            glm::vec3 db = glm::vec3(b) - focus;
+            return glm::dot(da, da) < glm::dot(db, db);
+        });
+
+        std::vector<glm::ivec3> waiting;
+        for (const glm::ivec3& coord : m_dirty) {
+            auto it = m_chunks.find(coord);
+            if (it == m_chunks.end()) continue;
+
+            // One job per chunk at a time; a chunk edited while meshing goes again afterwards
+            ChunkSlot& slot = it->second;
+            if (slot.meshingVersion != 0 || m_inFlight >= kMaxJobsInFlight) {
+                waiting.push_back(coord);
+                continue;
+            }
+
+            VoxelMesher::Neighborhood input;
+            input.center = slot.chunk;
+            for (int i = 0; i < 6; i++) {
+                auto neighbor = m_chunks.find(coord + kNeighborOffsets[i]);
+                if (neighbor != m_chunks.end()) {
+                    input.neighbors[i] = neighbor->second.chunk;
+                }
+            }
+
+            slot.dirty = false;
+            slot.meshingVersion = slot.version;
+            m_inFlight++;
+            uint64_t version = slot.version;
+            JobSystem::Get().Submit([this, coord, version, input = std::move(input)] {
+                std::shared_ptr<Mesh> mesh = VoxelMesher::BuildMesh(input);
+                std::lock_guard<std::mutex> lock(m_resultsMutex);
+                m_results.push_back({ coord, version, std::move(mesh) });
+            }, &m_jobs);
+        }
+        m_dirty = std::move(waiting);
+    }
+
+    void VoxelWorld::InstallResults() {
+        std::vector<MeshResult> results;
+        {
+            std::lock_guard<std::mutex> lock(m_resultsMutex);
+            results.swap(m_results);
+        }
+
+        for (MeshResult& result : results) {
+            m_inFlight--;
+            auto it = m_chunks.find(result.coord);
+            if (it == m_chunks.end()) continue;
+
+            // A job for a chunk that was removed since (and maybe added again)
+            ChunkSlot& slot = it->second;
+            if (result.version != slot.meshingVersion) continue;
+            slot.meshingVersion = 0;
+
+            // Edited since the job started; it's dirty again and gets a fresh mesh
+            if (result.version != slot.version) continue;
+
+            InstallMesh(slot, result.coord, std::move(result.mesh));
+        }
+    }
+
+    void VoxelWorld::InstallMesh(ChunkSlot& slot, const glm::ivec3& coord, std::shared_ptr<Mesh> mesh) {
+        if (!mesh) {
+            if (slot.entity) {
+                m_scene->DestroyEntity(slot.entity);
+                slot.entity = Entity();
+            }
+            return;
+        }
+
+        if (slot.entity) {
+            slot.entity.GetComponent<MeshRendererComponent>().mesh = std::move(mesh);
+            // Static renderables on the GPU-driven path aren't re-read otherwise
+            m_scene->RefreshRenderable(slot.entity);
+            return;
+        }
+
+        slot.entity = m_scene->CreateEntity("Chunk_" + std::to_string(coord.x) + "_" +
+                                            std::to_string(coord.y) + "_" + std::to_string(coord.z));
+        slot.entity.GetComponent<TransformComponent>().position = glm::vec3(coord * kSize);
+        auto& meshRenderer = slot.entity.AddComponent<MeshRendererComponent>(std::move(mesh), m_material);
+        meshRenderer.isStatic = true;
+        meshRenderer.autoLOD = false;
+    }
+
+    void VoxelWorld::UpdatePalette() {
+        std::vector<unsigned char> pixels(m_colors.size() * 4);
+        for (size_t i = 0; i < m_colors.size(); i++) {
+            glm::vec3 color = glm::clamp(m_colors[i], 0.0f, 1.0f) * 255.0f + 0.5f;
+            pixels[i * 4 + 0] = (unsigned char)color.r;
+            pixels[i * 4 + 1] = (unsigned char)color.g;
+            pixels[i * 4 + 2] = (unsigned char)color.b;
+            pixels[i * 4 + 3] = 255;
+        }
+        m_material->albedoMap = Texture::CreateFromData(pixels.data(), (int)m_colors.size(), 1, 4);
+        m_colorsDirty = false;
+    }
+
+} // namespace Klein
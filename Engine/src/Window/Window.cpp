@@ -1,15 +1,17 @@
 #include "Window.h"
 #include "Logger.h"
+#include "Profiler.h"
 #include <stdexcept>
 
 namespace Klein {
 
     Window::Window(const WindowProps& props)
-        : m_title(props.title)
+        : m_window(nullptr)
+        , m_title(props.title)
         , m_width(props.width)
         , m_height(props.height)
-        , m_vsync(props.vsync)
-        , m_window(nullptr)
+        , m_vsync(props.vsync && props.headless == HeadlessMode::Off)
+        , m_headless(props.headless)
     {
         Init();
     }
@@ -20,6 +22,8 @@ namespace Klein {
 
     void Window::Init() {
         if (s_windowCount == 0) {
+            // Headless runs never connect to a display server
+            glfwInitHint(GLFW_PLATFORM, m_headless == HeadlessMode::Off ? GLFW_ANY_PLATFORM : GLFW_PLATFORM_NULL);
             if (!glfwInit()) {
                 KleinLogger::Logger::EngineError("Failed to initialize GLFW!");
                 throw std::runtime_error("GLFW initialization failed");
@@ -28,18 +32,52 @@ namespace Klein {
         }
 
         // OpenGL version hints
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
         glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
         
 #ifdef __APPLE__
         glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-        // Create window
-        m_window = glfwCreateWindow(m_width, m_height, m_title.c_str(), nullptr, nullptr);
+        glfwWindowHint(GLFW_VISIBLE, m_headless == HeadlessMode::Off ? GLFW_TRUE : GLFW_FALSE);
+
+        if (m_headless == HeadlessMode::Simulation) {
+            // Still a (null platform) window, so input queries and Close() keep working
+            glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+            m_window = glfwCreateWindow(m_width, m_height, m_title.c_str(), nullptr, nullptr);
+            if (!m_window) {
+                KleinLogger::Logger::EngineError("Failed to create headless window!");
+                glfwTerminate();
+                throw std::runtime_error("Window creation failed");
+            }
+
+            s_windowCount++;
+            SetupCallbacks();
+            glfwSetWindowUserPointer(m_window, this);
+            KleinLogger::Logger::EngineLog("Running headless: simulation only, no GL context");
+            return;
+        }
+
+        // Create window, asking for the newest context first so optional paths
+        // (persistent mapping, compute) can be used. 4.1 is the floor (and macOS' ceiling).
+        // Offscreen prefers EGL (hardware) and falls back to OSMesa (software)
+        static const int kContextVersions[][2] = { {4, 6}, {4, 5}, {4, 3}, {4, 1} };
+        static const int kWindowedAPIs[] = { GLFW_NATIVE_CONTEXT_API };
+        static const int kOffscreenAPIs[] = { GLFW_EGL_CONTEXT_API, GLFW_OSMESA_CONTEXT_API };
+        bool offscreen = m_headless == HeadlessMode::Offscreen;
+        const int* apis = offscreen ? kOffscreenAPIs : kWindowedAPIs;
+        int apiCount = offscreen ? 2 : 1;
+        for (int api = 0; api < apiCount && !m_window; api++) {
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, apis[api]);
+            for (const auto& version : kContextVersions) {
+                glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, version[0]);
+                glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, version[1]);
+                m_window = glfwCreateWindow(m_width, m_height, m_title.c_str(), nullptr, nullptr);
+                if (m_window) break;
+            }
+        }
         if (!m_window) {
-            KleinLogger::Logger::EngineError("Failed to create GLFW window!");
+            KleinLogger::Logger::EngineError(offscreen ? "Failed to create an offscreen GL context (EGL or OSMesa)!"
+                                                       : "Failed to create GLFW window!");
             glfwTerminate();
             throw std::runtime_error("Window creation failed");
         }
@@ -56,6 +94,17 @@ namespace Klein {
         KleinLogger::Logger::EngineLog("OpenGL loaded: %s", glGetString(GL_VERSION));
         KleinLogger::Logger::EngineLog("GPU: %s", glGetString(GL_RENDERER));
 
+        if (offscreen) {
+            if (!CreateOffscreenTarget()) {
+                throw std::runtime_error("Offscreen framebuffer creation failed");
+            }
+            KleinLogger::Logger::EngineLog("Running headless: rendering offscreen at %dx%d", m_width, m_height);
+        } else if (GLFWmonitor* monitor = glfwGetPrimaryMonitor()) {
+            if (const GLFWvidmode* mode = glfwGetVideoMode(monitor)) {
+                m_refreshRate = mode->refreshRate;
+            }
+        }
+
         SetVSync(m_vsync);
         SetupCallbacks();
 
@@ -68,7 +117,37 @@ namespace Klein {
         glfwSetWindowUserPointer(m_window, this);
     }
 
+    bool Window::CreateOffscreenTarget() {
+        glGenRenderbuffers(1, &m_offscreenColor);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_offscreenColor);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_width, m_height);
+        glGenRenderbuffers(1, &m_offscreenDepth);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_offscreenDepth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_width, m_height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        // Passes that switch targets restore whatever was bound, so this stays the
+        // frame's destination as the default framebuffer would
+        glGenFramebuffers(1, &m_offscreenFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_offscreenFBO);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_offscreenColor);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_offscreenDepth);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            KleinLogger::Logger::EngineError("Offscreen framebuffer is incomplete");
+            return false;
+        }
+        glViewport(0, 0, m_width, m_height);
+        return true;
+    }
+
     void Window::Shutdown() {
+        if (m_offscreenFBO != 0 && glfwGetCurrentContext() == m_window) {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glDeleteFramebuffers(1, &m_offscreenFBO);
+            glDeleteRenderbuffers(1, &m_offscreenColor);
+            glDeleteRenderbuffers(1, &m_offscreenDepth);
+        }
+
         if (m_window) {
             glfwDestroyWindow(m_window);
             s_windowCount--;
@@ -93,7 +172,17 @@ namespace Klein {
     }
 
     void Window::SwapBuffers() {
-        glfwSwapBuffers(m_window);
+        KLEIN_PROFILE_SCOPE("Window::SwapBuffers");
+
+        // Nothing to present offscreen; finishing stands in for the swap's back-pressure,
+        // so measured frame times include the GPU
+        if (m_headless == HeadlessMode::Offscreen) {
+            glFinish();
+            return;
+        }
+        if (m_headless == HeadlessMode::Off) {
+            glfwSwapBuffers(m_window);
+        }
     }
 
     bool Window::ShouldClose() const {
@@ -105,6 +194,8 @@ namespace Klein {
     }
 
     void Window::SetVSync(bool enabled) {
+        // Nothing is presented headless, so there is nothing to sync to
+        if (m_headless != HeadlessMode::Off) return;
         glfwSwapInterval(enabled ? 1 : 0);
         m_vsync = enabled;
     }
@@ -130,7 +221,10 @@ namespace Klein {
         Window* win = static_cast<Window*>(glfwGetWindowUserPointer(window));
         win->m_width = width;
         win->m_height = height;
-        glViewport(0, 0, width, height);
+        // With a render thread the context lives there; it applies the size itself
+        if (glfwGetCurrentContext() == window) {
+            glViewport(0, 0, width, height);
+        }
         
         if (win->m_resizeCallback) {
             win->m_resizeCallback(width, height);
@@ -0,0 +1,104 @@
+// Terrain generation throughput: chunks per second per core, scalar vs AVX2 noise.
+//
+// Usage: KleinTerrainBench [chunk columns per side]   (default 8, i.e. 8x8x4 chunks)
+// Built when configured with -DKLEIN_BUILD_BENCHMARKS=ON.
+
+#include "JobSystem.h"
+#include "SimplexNoise.h"
+#include "TerrainGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    double Seconds(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    std::vector<glm::ivec3> MakeCoords(int side) {
+        std::vector<glm::ivec3> coords;
+        for (int y = 0; y < 4; y++) {
+            for (int z = 0; z < side; z++) {
+                for (int x = 0; x < side; x++) {
+                    coords.emplace_back(x - side / 2, y, z - side / 2);
+                }
+            }
+        }
+        return coords;
+    }
+
+    void Run(const char* label, const Klein::TerrainGenerator& generator, const std::vector<glm::ivec3>& coords) {
+        // Warm up tables and caches
+        generator.GenerateChunk(coords[0]);
+
+        auto start = Clock::now();
+        for (const glm::ivec3& coord : coords) {
+            generator.GenerateChunk(coord);
+        }
+        double single = Seconds(start);
+
+        uint32_t threads = Klein::JobSystem::Get().GetThreadSlotCount();
+        std::vector<Klein::VoxelChunk> chunks(coords.size());
+        start = Clock::now();
+        Klein::JobSystem::Get().ParallelFor(coords.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                chunks[i] = generator.GenerateChunk(coords[i]);
+            }
+        });
+        double parallel = Seconds(start);
+
+        double singleRate = (double)coords.size() / single;
+        double parallelRate = (double)coords.size() / parallel;
+        std::printf("%-8s %8zu %14.1f %14.1f %14.1f %9.2fx\n", label, coords.size(), singleRate, parallelRate,
+                    parallelRate / threads, parallelRate / singleRate);
+    }
+
+    void RunNoise(const char* label) {
+        constexpr size_t kPoints = 1 << 20;
+        std::vector<float> x(kPoints), y(kPoints), z(kPoints), out(kPoints);
+        for (size_t i = 0; i < kPoints; i++) {
+            x[i] = (float)(i % 97) * 0.37f;
+            y[i] = (float)(i % 89) * 0.41f;
+            z[i] = (float)(i / 97) * 0.013f;
+        }
+
+        Klein::SimplexNoise noise(7);
+        auto start = Clock::now();
+        noise.SampleBatch(x.data(), y.data(), z.data(), out.data(), kPoints);
+        double seconds = Seconds(start);
+        std::printf("%-8s %10.1f M samples/s on one core\n", label, (double)kPoints / seconds / 1e6);
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int side = argc > 1 ? std::max(1, std::atoi(argv[1])) : 8;
+    std::vector<glm::ivec3> coords = MakeCoords(side);
+    Klein::TerrainGenerator generator;
+
+    std::printf("Threads: %u (%u workers + caller), AVX2: %s\n\n",
+                Klein::JobSystem::Get().GetThreadSlotCount(), Klein::JobSystem::Get().GetWorkerCount(),
+                Klein::SimplexNoise::HasAVX2() ? "yes" : "no");
+
+    std::printf("%-8s %8s %14s %14s %14s %10s\n", "noise", "chunks", "1 core/s", "all cores/s", "per core/s", "scaling");
+    Klein::SimplexNoise::SetSIMDEnabled(false);
+    Run("scalar", generator, coords);
+    if (Klein::SimplexNoise::HasAVX2()) {
+        Klein::SimplexNoise::SetSIMDEnabled(true);
+        Run("avx2", generator, coords);
+    }
+
+    std::printf("\n");
+    Klein::SimplexNoise::SetSIMDEnabled(false);
+    RunNoise("scalar");
+    if (Klein::SimplexNoise::HasAVX2()) {
+        Klein::SimplexNoise::SetSIMDEnabled(true);
+        RunNoise("avx2");
+    }
+    return 0;
+}
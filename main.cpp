@@ -2,8 +2,13 @@
 #include "App.h"
 #include "Components.h"
 #include "Mesh.h"
+#include "RegionStore.h"
+#include "TerrainGenerator.h"
+#include "VoxelWorld.h"
 #include <glm/gtc/quaternion.hpp>
 #include <GLFW/glfw3.h>
+#include <cmath>
+#include <memory>
 
 class MinecraftGame : public Klein::App {
 public:
@@ -14,48 +19,38 @@ public:
 
         // Create a camera
         auto camera = scene->CreateEntity("Main Camera");
-        camera.GetComponent<Klein::TransformComponent>().position = glm::vec3(0.0f, 2.0f, 5.0f);
+        camera.GetComponent<Klein::TransformComponent>().position = glm::vec3(0.0f, 110.0f, 220.0f);
         auto& camComp = camera.AddComponent<Klein::CameraComponent>();
         camComp.fov = 60.0f;
         camComp.primary = true;
 
-        // Create a ground plane
-        auto ground = scene->CreateEntity("Ground");
-        ground.GetComponent<Klein::TransformComponent>().scale = glm::vec3(20.0f, 1.0f, 20.0f);
-        auto groundMaterial = std::make_shared<Klein::Material>();
-        groundMaterial->albedo = glm::vec3(0.3f, 0.6f, 0.3f); // Green grass-like
-        ground.AddComponent<Klein::MeshRendererComponent>(
-            Klein::Mesh::CreatePlane(1.0f, 1.0f),
-            groundMaterial
-        );
-
-        // Create some blocks (cubes)
-        for (int x = -5; x <= 5; x += 2) {
-            for (int z = -5; z <= 5; z += 2) {
-                auto block = scene->CreateEntity("Block_" + std::to_string(x) + "_" + std::to_string(z));
-                auto& transform = block.GetComponent<Klein::TransformComponent>();
-                transform.position = glm::vec3(x, 0.5f, z);
-
-                auto material = std::make_shared<Klein::Material>();
-
-                material->albedo = glm::vec3(
-                    0.5f + (x + 5) * 0.05f,
-                    0.3f + (z + 5) * 0.05f,
-                    0.7f
-                );
-                material->roughness = 0.8f;
-
-                block.AddComponent<Klein::MeshRendererComponent>(
-                    Klein::Mesh::CreateCube(),
-                    material
-                );
+        // Block world, 512x512x128 blocks around the origin; loaded from the last
+        // session's save if there is one, generated otherwise
+        m_world = std::make_unique<Klein::VoxelWorld>(scene.get());
+        m_store = std::make_unique<Klein::RegionStore>("saves/world");
+        Klein::TerrainGenerator::ApplyDefaultColors(*m_world);
+
+        glm::ivec3 minChunk(-kWorldChunksXZ / 2, 0, -kWorldChunksXZ / 2);
+        glm::ivec3 maxChunk(kWorldChunksXZ / 2, kWorldChunksY, kWorldChunksXZ / 2);
+        size_t loaded = 0;
+        for (int y = minChunk.y; y < maxChunk.y; y++) {
+            for (int z = minChunk.z; z < maxChunk.z; z++) {
+                for (int x = minChunk.x; x < maxChunk.x; x++) {
+                    loaded += m_world->LoadChunk(*m_store, glm::ivec3(x, y, z)) ? 1 : 0;
+                }
             }
         }
+        if (loaded > 0) {
+            KleinLogger::Logger::Log("Loaded %zu chunks from saves/world", loaded);
+        } else {
+            Klein::TerrainGenerator terrain;
+            terrain.GenerateRegion(*m_world, minChunk, maxChunk);
+        }
 
         // Directional light (sun)
         auto sun = scene->CreateEntity("Sun");
         auto& sunTransform = sun.GetComponent<Klein::TransformComponent>();
-        sunTransform.position = glm::vec3(0.0f, 10.0f, 0.0f);
+        sunTransform.position = glm::vec3(0.0f, 200.0f, 0.0f);
         sunTransform.rotation = glm::quat(glm::vec3(glm::radians(-45.0f), glm::radians(-30.0f), 0.0f));
 
         auto& light = sun.AddComponent<Klein::LightComponent>();
@@ -81,7 +76,7 @@ public:
 
         // Simple orbit camera with arrow keys
         float rotSpeed = 1.0f * deltaTime;
-        float moveSpeed = 5.0f * deltaTime;
+        float moveSpeed = 30.0f * deltaTime;
 
         if (window->IsKeyPressed(GLFW_KEY_LEFT)) {
             float angle = rotSpeed;
@@ -105,6 +100,8 @@ public:
         if (window->IsKeyPressed(GLFW_KEY_DOWN)) {
             transform.position.y -= moveSpeed;
         }
+        transform.rotation = glm::quatLookAt(glm::normalize(kOrbitTarget - transform.position),
+                                             glm::vec3(0.0f, 1.0f, 0.0f));
 
 
         if (window->IsKeyPressed(GLFW_KEY_ESCAPE)) {
@@ -113,18 +110,39 @@ public:
 
 
 
-        auto blocks = scene->GetEntitiesWithComponent<Klein::MeshRendererComponent>();
-        for (auto& block : blocks) {
-            if (block.GetComponent<Klein::TagComponent>().tag.find("Block_") != std::string::npos) {
-                auto& t = block.GetComponent<Klein::TransformComponent>();
-                t.rotation = glm::rotate(t.rotation, deltaTime * 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
-            }
+        // Stream in chunk meshes, nearest to the camera first
+        m_world->SetFocus(transform.position);
+        m_world->Update();
+
+        // Autosave; the store writes on its own thread, so this only queues snapshots
+        m_sinceSave += deltaTime;
+        if (m_sinceSave >= kAutosaveInterval) {
+            m_world->Save(*m_store);
+            m_sinceSave = 0.0f;
         }
     }
 
+    void OnShutdown() override {
+        // Removes its chunk entities, so it goes before the scene. The store
+        // finishes writing whatever is still queued before it's destroyed
+        m_world->Save(*m_store);
+        m_world.reset();
+        m_store.reset();
+    }
+
     void OnUI() override {
 
     }
+
+private:
+    static constexpr int kWorldChunksXZ = 16;  // 512 blocks across
+    static constexpr int kWorldChunksY = 4;    // 128 blocks tall
+    static constexpr float kAutosaveInterval = 30.0f;
+    inline static const glm::vec3 kOrbitTarget{0.0f, 40.0f, 0.0f};
+
+    std::unique_ptr<Klein::VoxelWorld> m_world;
+    std::unique_ptr<Klein::RegionStore> m_store;
+    float m_sinceSave = 0.0f;
 };
 
 Klein::App* Klein::CreateApp() {
@@ -0,0 +1,76 @@
+// Small camera moves must leave the shadow cascade matrices alone, otherwise the
+// static caster cache is rebuilt every frame while the camera moves.
+#include "ShadowMapper.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+    constexpr int kResolution = 2048;
+    constexpr float kShadowDistance = 150.0f;
+    constexpr float kSplitLambda = 0.75f;
+    constexpr int kSteps = 200;
+
+    // Moves the camera kSteps times by 'step' and counts, per cascade, how often
+    // the matrix changed (each change is a static cache rebuild). Also returns each
+    // cascade's half extent, read back from the light space x scale
+    void CountRebuilds(const glm::vec3& step, const glm::vec3& lightDirection, int rebuilds[], float radii[]) {
+        Klein::CameraComponent camera;
+        camera.nearClip = 0.1f;
+        camera.farClip = 500.0f;
+
+        glm::mat4 previous[Klein::ShadowMapper::kCascadeCount];
+        float splitFar[Klein::ShadowMapper::kCascadeCount];
+        glm::vec3 position(12.0f, 40.0f, -7.0f);
+        for (int i = 0; i < Klein::ShadowMapper::kCascadeCount; i++) {
+            rebuilds[i] = 0;
+        }
+
+        for (int s = 0; s <= kSteps; s++) {
+            glm::mat4 view = glm::lookAt(position, position + glm::vec3(0.3f, -0.2f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+            glm::mat4 viewProj[Klein::ShadowMapper::kCascadeCount];
+            Klein::ShadowMapper::FitCascades(view, camera, 16.0f / 9.0f, lightDirection, kResolution,
+                                             kShadowDistance, kSplitLambda, viewProj, splitFar);
+            for (int i = 0; i < Klein::ShadowMapper::kCascadeCount; i++) {
+                if (s > 0 && viewProj[i] != previous[i]) rebuilds[i]++;
+                previous[i] = viewProj[i];
+                radii[i] = 1.0f / glm::length(glm::vec3(viewProj[i][0][0], viewProj[i][1][0], viewProj[i][2][0]));
+            }
+            position += step;
+        }
+    }
+
+    bool Check(const char* name, const glm::vec3& step, const glm::vec3& lightDirection) {
+        int rebuilds[Klein::ShadowMapper::kCascadeCount];
+        float radii[Klein::ShadowMapper::kCascadeCount];
+        CountRebuilds(step, lightDirection, rebuilds, radii);
+
+        // A rebuild is only allowed where the snapped center crosses a texel border
+        // (either axis) or a depth step (the cascade radius); every other frame keeps
+        // the cache
+        float travel = glm::length(step) * (float)kSteps;
+        bool ok = true;
+        for (int i = 0; i < Klein::ShadowMapper::kCascadeCount; i++) {
+            float texelSize = 2.0f * radii[i] / (float)kResolution;
+            int allowed = 2 * (int)std::ceil(travel / texelSize) + (int)std::ceil(travel / radii[i]) + 1;
+            std::printf("%s: cascade %d rebuilt %d of %d frames (at most %d)\n", name, i, rebuilds[i], kSteps,
+                        allowed);
+            if (rebuilds[i] > allowed) ok = false;
+        }
+        return ok;
+    }
+
+} // namespace
+
+int main() {
+    glm::vec3 lightDirection = glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f));
+
+    bool ok = true;
+    ok &= Check("across the light", glm::vec3(0.001f, 0.0f, 0.0f), lightDirection);
+    ok &= Check("along the light", lightDirection * 0.001f, lightDirection);
+    ok &= Check("forwards", glm::vec3(0.0f, 0.0f, -0.001f), lightDirection);
+
+    std::printf(ok ? "PASS\n" : "FAIL\n");
+    return ok ? 0 : 1;
+}
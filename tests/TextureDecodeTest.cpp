@@ -0,0 +1,63 @@
+// CPU fallback decoding of BC1 blocks in three-colour mode (c0 <= c1), which must
+// give c0, c1, their midpoint and black; black is opaque in the RGB format and
+// transparent in the punch-through alpha format.
+#include "TextureLoader.h"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+    // One 4x4 BC1 block: c0 = pure blue, c1 = pure red (c0 < c1), and texel i
+    // uses palette index i % 4
+    Klein::TextureData MakeBlock(GLenum internalFormat) {
+        Klein::TextureData data;
+        data.width = 4;
+        data.height = 4;
+        data.internalFormat = internalFormat;
+        data.compressed = true;
+
+        const unsigned char block[8] = {
+            0x1F, 0x00,                // c0 = 0x001F (blue)
+            0x00, 0xF8,                // c1 = 0xF800 (red)
+            0xE4, 0xE4, 0xE4, 0xE4,    // Indices 0, 1, 2, 3 in every row
+        };
+        data.data.assign(block, block + sizeof(block));
+        data.levels.push_back({ 0, sizeof(block), 4, 4 });
+        return data;
+    }
+
+    bool Check(const char* name, GLenum internalFormat, unsigned char blackAlpha) {
+        Klein::TextureData data = MakeBlock(internalFormat);
+        if (!Klein::TextureLoader::Decompress(data) || data.data.size() != 16 * 4) {
+            std::printf("%s: decode failed\n", name);
+            return false;
+        }
+
+        const unsigned char expected[4][4] = {
+            { 0, 0, 255, 255 },          // c0
+            { 255, 0, 0, 255 },          // c1
+            { 127, 0, 127, 255 },        // (c0 + c1) / 2
+            { 0, 0, 0, blackAlpha },
+        };
+        bool ok = true;
+        for (int i = 0; i < 16; i++) {
+            const unsigned char* texel = data.data.data() + i * 4;
+            if (std::memcmp(texel, expected[i % 4], 4) != 0) {
+                std::printf("%s: texel %d is %u %u %u %u\n", name, i, texel[0], texel[1], texel[2], texel[3]);
+                ok = false;
+            }
+        }
+        std::printf("%s: %s\n", name, ok ? "ok" : "wrong palette");
+        return ok;
+    }
+
+} // namespace
+
+int main() {
+    bool ok = true;
+    ok &= Check("BC1 RGB", GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 255);
+    ok &= Check("BC1 RGBA", GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 0);
+
+    std::printf(ok ? "PASS\n" : "FAIL\n");
+    return ok ? 0 : 1;
+}